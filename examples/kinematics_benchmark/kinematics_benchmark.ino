@@ -0,0 +1,130 @@
+// Copyright (C) 2015 - 2020 Joseph Morgridge
+//
+// Licensed under GNU General Public License v3.0 (GPLv3) License.
+// See the LICENSE file in the project root for full license details.
+
+// Arduino example benchmarking the execution time of the main kinematics calculations of the MT-dh-serial-kinematics
+// library for a seven axis (redundant) articulated robot.
+
+#include <dh_kinematic_link.h>
+#include <dh_kinematic_chain.h>
+#include <dh_velocity_ik.h>
+#include <dh_math_utils.h>
+
+// The robots degrees of freedom (DOF).
+constexpr int kDof = 7;
+
+// The robots Denavit-Hartenberg (D-H) kinematic parameters (DH Kinematic Link instances).
+//                                        theta  d    a   alpha
+//                                        (rad) (mm) (mm) (rad)                    Axis
+mt::DhKinematicLink robot_links[kDof] = { mt::DhKinematicLink{0, 340, 0, -mt::DhMathUtils::pi/2},  // 1
+                                          mt::DhKinematicLink{0, 0,   0, mt::DhMathUtils::pi/2},   // 2
+                                          mt::DhKinematicLink{0, 400, 0, mt::DhMathUtils::pi/2},   // 3
+                                          mt::DhKinematicLink{0, 0,   0, -mt::DhMathUtils::pi/2},  // 4
+                                          mt::DhKinematicLink{0, 400, 0, -mt::DhMathUtils::pi/2},  // 5
+                                          mt::DhKinematicLink{0, 0,   0, mt::DhMathUtils::pi/2},   // 6
+                                          mt::DhKinematicLink{0, 126, 0, 0} };                     // 7
+
+// The robots kinematic model (D-H Kinematic Chain instance).
+mt::DhKinematicChain robot_kinematic_model{kDof, robot_links};
+
+// The velocity (resolved-rate) inverse kinematics solver.
+mt::DhVelocityIkSolver robot_velocity_ik{robot_kinematic_model};
+
+// A general (non-singular) robot position.
+float q_rad[kDof] = {0.1, 0.5, -0.3, 1.2, 0.4, -0.7, 0.2}; // (rad).
+
+// The commanded tool twist (vx, vy, vz, wx, wy, wz) in (mm/s) and (rad/s).
+float twist[6] = {10, -5, 3, 0.1, 0.2, -0.1};
+
+constexpr int kBaudRate = 9600;
+constexpr int kIterations = 100;
+
+// Print the average execution time of a benchmark.
+void print_result(const __FlashStringHelper* label, unsigned long total_us) {
+  Serial.print(label);
+  Serial.print(F("\t"));
+  Serial.print((float)total_us / kIterations);
+  Serial.println(F(" us"));
+}
+
+// Print the average execution time and maximum absolute error (w.r.t. the precise tier) of a sincos tier.
+void benchmark_sincos(const __FlashStringHelper* label, void (*sincos_function)(float, float&, float&)) {
+  constexpr int kSamples = 1000;
+  constexpr float kRange_rad = 4 * mt::DhMathUtils::pi; // Sweep from -2pi to 2pi.
+  float sin_value, cos_value, sin_precise, cos_precise;
+  float max_error = 0;
+  float sum = 0; // Prevents the calls being optimised away.
+
+  unsigned long start_us = micros();
+  for (int i = 0; i < kSamples; i++)
+  {
+    sincos_function(-kRange_rad / 2 + (kRange_rad * i) / kSamples, sin_value, cos_value);
+    sum += sin_value + cos_value;
+  }
+  unsigned long total_us = micros() - start_us;
+
+  for (int i = 0; i < kSamples; i++)
+  {
+    float theta = -kRange_rad / 2 + (kRange_rad * i) / kSamples;
+    sincos_function(theta, sin_value, cos_value);
+    mt::DhMathUtils::sincosPrecise(theta, sin_precise, cos_precise);
+    max_error = max(max_error, (float)max(fabs(sin_value - sin_precise), fabs(cos_value - cos_precise)));
+  }
+
+  Serial.print(label);
+  Serial.print(F("\t"));
+  Serial.print((float)total_us / kSamples);
+  Serial.print(F(" us\tmax error = "));
+  Serial.print(max_error, 8);
+  Serial.print(F("\t(checksum "));
+  Serial.print(sum);
+  Serial.println(F(")"));
+}
+
+// The main application entry point for initialisation tasks.
+void setup() {
+  // Initialise the Serial Port.
+  Serial.begin(kBaudRate);
+
+  Serial.println(F("\n...Kinematics benchmark (seven axis robot)...\n"));
+
+  float Tm[4][4];
+  float Tm_frames[kDof][4][4];
+  float J[6][mt::DhKinematicChain::maxLinks];
+  float qd_rad_per_s[kDof];
+  unsigned long start_us;
+
+  // Forward kinematics.
+  start_us = micros();
+  for (int i = 0; i < kIterations; i++) { robot_kinematic_model.fKine(Tm, q_rad); }
+  print_result(F("fKine"), micros() - start_us);
+
+  // Forward kinematics of all link frames.
+  start_us = micros();
+  for (int i = 0; i < kIterations; i++) { robot_kinematic_model.fKineFrames(Tm_frames, q_rad); }
+  print_result(F("fKineFrames"), micros() - start_us);
+
+  // Jacobian.
+  start_us = micros();
+  for (int i = 0; i < kIterations; i++) { robot_kinematic_model.jacobian(J, q_rad); }
+  print_result(F("jacobian"), micros() - start_us);
+
+  // Velocity inverse kinematics (including the Jacobian). This must fit well inside a 1 ms control tick.
+  start_us = micros();
+  for (int i = 0; i < kIterations; i++) { robot_velocity_ik.solve(qd_rad_per_s, twist, q_rad); }
+  print_result(F("velocity IK"), micros() - start_us);
+
+  // Sine and cosine accuracy tiers (error vs speed report). The library wide tier is selected with DH_SINCOS_TIER.
+  Serial.println(F("\n...sincos tiers (error vs speed)..."));
+  benchmark_sincos(F("precise"), mt::DhMathUtils::sincosPrecise);
+  benchmark_sincos(F("polynomial"), mt::DhMathUtils::sincosPolynomial);
+  benchmark_sincos(F("table"), mt::DhMathUtils::sincosTable);
+  Serial.print(F("Selected tier (DH_SINCOS_TIER) = "));
+  Serial.println(DH_SINCOS_TIER);
+
+  Serial.println(F("\n...Benchmark complete...\n"));
+}
+
+// The continuously running function for repetitive tasks.
+void loop() {}
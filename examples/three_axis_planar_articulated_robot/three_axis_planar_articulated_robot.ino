@@ -105,7 +105,10 @@ void robot_inverse_kine(mt::DhKinematicChain& robot, int configuration) {
 
   const int i1 = 0, i2 = 1, i3 = 2, i4 = 3; // Convenience array access indexes.
 
-  // Undo tool Transformations (if any).
+  // Undo base and tool Transformations (if any).
+
+  float Tm_base_inv[4][4];
+  robot.get_TmBaseInverse(Tm_base_inv);
 
   float Tm_tool_inv[4][4];
   robot.get_TmToolInverse(Tm_tool_inv);
@@ -113,8 +116,11 @@ void robot_inverse_kine(mt::DhKinematicChain& robot, int configuration) {
   float Tm_input[4][4];
   robot.get_TmCurrent(Tm_input);
 
+  float Tm_temp[4][4];
+	MatrixObj.Multiply((float*)Tm_base_inv, (float*)Tm_input, 4, 4, 4, (float*)Tm_temp);
+
   float Tm_robot[4][4];
-	MatrixObj.Multiply((float*)Tm_input, (float*)Tm_tool_inv, 4, 4, 4, (float*)Tm_robot);
+	MatrixObj.Multiply((float*)Tm_temp, (float*)Tm_tool_inv, 4, 4, 4, (float*)Tm_robot);
 
   // Extract the required D-H parameters.
 
@@ -0,0 +1,206 @@
+// Copyright (C) 2015 - 2020 Joseph Morgridge
+//
+// Licensed under GNU General Public License v3.0 (GPLv3) License.
+// See the LICENSE file in the project root for full license details.
+
+// Desktop (Linux) example of the shared memory kinematics server of the MT-dh-serial-kinematics library.
+// A server serves a three axis planar articulated robot to client processes forked from this process. The example checks
+// every result against a local kinematic model, and exercises the batching, the futex wake ups (sleeping server and
+// sleeping clients) and the client timeout paths (cancelled and abandoned requests).
+// This is not an Arduino sketch. Build and run it from this folder with e.g.
+//   g++ -O2 -std=c++17 -I../../src kinematics_server.cpp ../../src/*.cpp -o kinematics_server -pthread -lrt
+//   ./kinematics_server
+
+#include <dh_kinematic_link.h>
+#include <dh_kinematic_chain.h>
+#include <dh_kinematics_server.h>
+#include <dh_math_utils.h>
+
+#include <cmath>
+#include <cstdio>
+#include <thread>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// The robots degrees of freedom (DOF).
+constexpr int kDof = 3;
+
+// The robots Denavit-Hartenberg (D-H) kinematic parameters (DH Kinematic Link instances).
+//                                        theta  d    a   alpha
+//                                        (rad) (mm) (mm) (rad)    Axis
+mt::DhKinematicLink robot_links[kDof] = { mt::DhKinematicLink{0, 0, 150, 0},   // 1
+                                          mt::DhKinematicLink{0, 0, 100, 0},   // 2
+                                          mt::DhKinematicLink{0, 0, 0,   0} }; // 3
+
+// The shared memory object name.
+constexpr char kRegionName[] = "/dh_kinematics_example";
+
+constexpr int kNoOfClients = 4;
+constexpr int kNoOfRequests = 20000; // FK requests per client.
+constexpr int kSlowConfiguration = 3; // IK configuration served by a (simulated) slow solver.
+constexpr int kSlowSolve_us = 20000;
+
+// Inverse kinematics solution for the three axis planar articulated robot (base and tool are not applied).
+// Inputs are the robots kinematic model, with the desired transformation matrix applied, and the configuration number
+// (1 = Shoulder up, 2 = Shoulder down, kSlowConfiguration = Shoulder up after a delay, e.g. an iterative solver).
+// Output is the array of angles in radians, stored in the input robot object.
+void robot_inverse_kine(mt::DhKinematicChain& robot, int configuration) {
+  if (configuration == kSlowConfiguration) { usleep(kSlowSolve_us); }
+
+  float Tm[4][4];
+  robot.get_TmCurrent(Tm);
+  float a1 = 150, a2 = 100;
+  float px = Tm[0][3], py = Tm[1][3];
+  float c2 = (px * px + py * py - a1 * a1 - a2 * a2) / (2 * a1 * a2);
+  if (c2 < -1 || c2 > 1) { return; } // Unreachable; the joint angles are left unchanged.
+
+  float q2 = acos(c2);
+  if (configuration != 2) { q2 = -q2; }
+  float q1 = atan2(py, px) - atan2(a2 * sin(q2), a1 + a2 * cos(q2));
+  float q3 = atan2(Tm[1][0], Tm[0][0]) - q1 - q2;
+  float q[kDof] = {q1, q2, q3};
+  robot.set_qCurrent(q);
+}
+
+// Check whether two poses have the same position.
+bool same_position(float Tm1[4][4], float Tm2[4][4], float tolerance) {
+  float dx = Tm1[0][3] - Tm2[0][3], dy = Tm1[1][3] - Tm2[1][3], dz = Tm1[2][3] - Tm2[2][3];
+  return dx * dx + dy * dy + dz * dz <= tolerance * tolerance;
+}
+
+// Check whether every slot of the region is free (i.e. no request was leaked), by claiming all of them.
+bool all_slots_free(mt::DhKinematicsClient& client) {
+  mt::DhKinematicsSlot* slots[mt::DhKinematicsServer::noOfSlots];
+  int noOfClaimed = 0;
+  while (noOfClaimed < mt::DhKinematicsServer::noOfSlots && (slots[noOfClaimed] = client.acquireSlot()) != nullptr)
+  {
+    noOfClaimed++;
+  }
+  for (int k = 0; k < noOfClaimed; k++) { client.release(slots[k]); }
+  return noOfClaimed == mt::DhKinematicsServer::noOfSlots;
+}
+
+// Client process. Output is no. of failed checks (the process exit status).
+int run_client(int client_index) {
+  mt::DhSharedMemory region;
+  mt::DhKinematicsClient client;
+  if (!region.open(kRegionName) || !client.attach(region.get_data())) { return 1; }
+
+  mt::DhKinematicChain local_model{kDof, robot_links};
+  int noOfFailures = 0;
+
+  for (int k = 0; k < kNoOfRequests; k++)
+  {
+    // Forward kinematics (batched with the requests of the other clients).
+    float q_rad[kDof] = {0.0003f * k, 0.5f + 0.1f * client_index, -0.3f};
+    float Tm_server[4][4], Tm_local[4][4];
+    if (client.fKine(Tm_server, q_rad) != mt::kDhKinematicsOk) { noOfFailures++; continue; }
+    local_model.fKine(Tm_local, q_rad);
+    if (!same_position(Tm_server, Tm_local, 1e-3)) { noOfFailures++; }
+
+    // Inverse kinematics of poses that every client requests (served from the shared IK cache after the first
+    // request), checked by forward kinematics.
+    if (k % 10 == 0)
+    {
+      float q_pose_rad[kDof] = {0.01f * (k / 10 % 100), 1.0f, -0.5f};
+      float Tm_target[4][4], q_ik_rad[kDof];
+      local_model.fKine(Tm_target, q_pose_rad);
+      if (client.iKine(q_ik_rad, Tm_target, 2) != mt::kDhKinematicsOk) { noOfFailures++; continue; }
+      local_model.fKine(Tm_local, q_ik_rad);
+      if (!same_position(Tm_target, Tm_local, 0.2)) { noOfFailures++; }
+    }
+
+    // Jacobian.
+    if (k % 100 == 0)
+    {
+      float J[6][mt::DhKinematicsClient::maxLinks];
+      if (client.jacobian(J, q_rad) != mt::kDhKinematicsOk) { noOfFailures++; }
+    }
+
+    // Pause now and then, so the server runs out of requests and sleeps (woken by the next submission).
+    if (k % 1000 == 999) { usleep(2000); }
+  }
+
+  // A slow request: the client spins briefly and then sleeps until the server wakes it.
+  float Tm_target[4][4] = {{1, 0, 0, 180}, {0, 1, 0, 100 + 10.0f * client_index}, {0, 0, 1, 0}, {0, 0, 0, 1}};
+  float q_ik_rad[kDof];
+  if (client.iKine(q_ik_rad, Tm_target, kSlowConfiguration) != mt::kDhKinematicsOk) { noOfFailures++; }
+
+  // Unreachable target.
+  Tm_target[0][3] = 400;
+  if (client.iKine(q_ik_rad, Tm_target, 1) != mt::kDhKinematicsErrorIk) { noOfFailures++; }
+
+  return noOfFailures;
+}
+
+int main() {
+  int noOfFailures = 0;
+
+  // Create the region and the server (before forking, so the clients attach to an initialized region).
+  mt::DhSharedMemory::remove(kRegionName);
+  mt::DhSharedMemory region;
+  if (!region.create(kRegionName, mt::DhKinematicsServer::get_regionSize()))
+  {
+    printf("Could not create the shared memory region\n");
+    return 1;
+  }
+  mt::DhKinematicChain robot_kinematic_model{kDof, robot_links};
+  mt::DhKinematicsServer server{robot_kinematic_model, robot_inverse_kine, region.get_data()};
+
+  // Fork the clients (before any thread is started).
+  pid_t clients[kNoOfClients];
+  for (int c = 0; c < kNoOfClients; c++)
+  {
+    clients[c] = fork();
+    if (clients[c] == 0) { _exit(run_client(c)); }
+  }
+
+  std::thread server_thread([&server]() { server.run(); });
+
+  for (int c = 0; c < kNoOfClients; c++)
+  {
+    int status = 0;
+    waitpid(clients[c], &status, 0);
+    int client_failures = WIFEXITED(status) ? WEXITSTATUS(status) : 1;
+    printf("Client %d: %d failed checks\n", c, client_failures);
+    noOfFailures += client_failures;
+  }
+
+  mt::DhKinematicsClient client;
+  client.attach(region.get_data());
+
+  // Abandoned request: the client gives up while the server is still solving; the server frees the slot afterwards.
+  client.set_timeout(kSlowSolve_us / 4000);
+  float Tm_target[4][4] = {{1, 0, 0, 150}, {0, 1, 0, 150}, {0, 0, 1, 0}, {0, 0, 0, 1}};
+  float q_rad[kDof] = {0, 0, 0};
+  int status = client.iKine(q_rad, Tm_target, kSlowConfiguration);
+  printf("Abandoned request status: %d (expected %d)\n", status, mt::kDhKinematicsErrorTimeout);
+  if (status != mt::kDhKinematicsErrorTimeout) { noOfFailures++; }
+  usleep(2 * kSlowSolve_us);
+  if (!all_slots_free(client)) { printf("Abandoned slot was not freed\n"); noOfFailures++; }
+
+  mt::DhKinematicsStats stats;
+  server.get_stats(stats);
+  server.stop();
+  server_thread.join();
+
+  // Cancelled request: no server is running, so the client takes its request back.
+  float Tm_output[4][4];
+  status = client.fKine(Tm_output, q_rad);
+  printf("Cancelled request status: %d (expected %d)\n", status, mt::kDhKinematicsErrorTimeout);
+  if (status != mt::kDhKinematicsErrorTimeout) { noOfFailures++; }
+  if (!all_slots_free(client)) { printf("Cancelled slot was not freed\n"); noOfFailures++; }
+
+  printf("\nRequests: %lu in %lu batches (%.2f per batch)\n", (unsigned long)stats.noOfRequests,
+         (unsigned long)stats.noOfBatches, (double)stats.noOfRequests / stats.noOfBatches);
+  printf("Latency: mean %.1f us, max %.1f us\n", stats.totalLatency / 1e3 / stats.noOfRequests, stats.maxLatency / 1e3);
+  printf("Throughput: %.0f requests/s\n", stats.noOfRequests / (stats.elapsedTime / 1e9));
+  printf("Latency histogram (us):");
+  for (int b = 0; b < 16; b++) { printf(" %lu", (unsigned long)stats.latencyHistogram[b]); }
+  printf("\nIK cache: %lu hits, %lu misses\n", (unsigned long)server.get_ikCache().get_noOfHits(),
+         (unsigned long)server.get_ikCache().get_noOfMisses());
+
+  mt::DhSharedMemory::remove(kRegionName);
+  printf("\n%s (%d failed checks)\n", (noOfFailures == 0) ? "PASSED" : "FAILED", noOfFailures);
+  return (noOfFailures == 0) ? 0 : 1;
+}
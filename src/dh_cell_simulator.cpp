@@ -0,0 +1,331 @@
+// Copyright (C) 2015 - 2020 Joseph Morgridge
+//
+// Licensed under GNU General Public License v3.0 (GPLv3) License.
+// See the LICENSE file in the project root for full license details.
+
+#include "dh_cell_simulator.h"
+
+#include "dh_kinematic_chain.h"
+#include "dh_time_parameterization.h"
+
+#if !USING_ARDUINO
+
+#include <chrono>
+using namespace std;
+
+namespace mt {
+
+namespace {
+
+// No. of yields a worker spins for the next step before it sleeps.
+const int workerSpinCount = 20000;
+
+// Check whether two chains have identical links (and so can share a batch kernel).
+bool sameLinks(DhKinematicChain& chain1, DhKinematicChain& chain2) {
+  int noOfLinks = chain1.get_noOfLinks();
+  if (chain2.get_noOfLinks() != noOfLinks) { return false; }
+
+  DhKinematicLink links1[DhKinematicChain::maxLinks], links2[DhKinematicChain::maxLinks];
+  chain1.get_links(links1);
+  chain2.get_links(links2);
+  for (int i = 0; i < noOfLinks; i++)
+  {
+    if (links1[i].get_theta() != links2[i].get_theta() || links1[i].get_d() != links2[i].get_d() ||
+        links1[i].get_a() != links2[i].get_a() || links1[i].get_alpha() != links2[i].get_alpha())
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+} // namespace
+
+DhCellSimulator::~DhCellSimulator() { stopWorkers(); }
+
+// Cell
+
+int DhCellSimulator::add_robot(DhKinematicChain& chainInput, DhTrajectoryEvaluator* programInput) {
+  if (noOfRobots == maxRobots) { return -1; }
+
+  int robot = noOfRobots;
+  chains[robot] = &chainInput;
+  programs[robot] = programInput;
+  poolIndex[robot] = -1; // Not laid out yet.
+  noOfRobots++;
+
+  rebuildLayout();
+  return robot;
+}
+
+void DhCellSimulator::set_program(int robot, DhTrajectoryEvaluator* programInput) {
+  programs[robot] = programInput;
+  startProgram(robot);
+}
+
+int DhCellSimulator::get_noOfRobots() { return noOfRobots; }
+
+int DhCellSimulator::get_noOfGroups() { return noOfGroups; }
+
+void DhCellSimulator::set_noOfThreads(int noOfThreadsInput) {
+  if (noOfThreadsInput < 1) { noOfThreadsInput = 1; }
+  if (noOfThreadsInput > maxThreads) { noOfThreadsInput = maxThreads; }
+
+  stopWorkers();
+  noOfThreads = noOfThreadsInput;
+  startWorkers();
+}
+
+void DhCellSimulator::rebuildLayout() {
+  // Keep the joint angles and state of the robots laid out so far.
+  float q[maxRobots][maxLinks];
+  bool running[maxRobots];
+  for (int r = 0; r < noOfRobots; r++)
+  {
+    if (poolIndex[r] < 0) { continue; }
+    int noOfLinks = chains[r]->get_noOfLinks();
+    for (int j = 0; j < noOfLinks; j++) { q[r][j] = qPool[qOffset[poolIndex[r]] + j]; }
+    running[r] = poolRunning[poolIndex[r]];
+  }
+
+  // Group the robots with identical links (the first robot of a group evaluates it).
+  int robotGroup[maxRobots];
+  noOfGroups = 0;
+  for (int r = 0; r < noOfRobots; r++)
+  {
+    robotGroup[r] = -1;
+    for (int g = 0; g < noOfGroups && robotGroup[r] < 0; g++)
+    {
+      if (sameLinks(*chains[r], *chains[groupKernel[g]])) { robotGroup[r] = g; }
+    }
+    if (robotGroup[r] < 0)
+    {
+      groupKernel[noOfGroups] = r;
+      robotGroup[r] = noOfGroups++;
+    }
+  }
+
+  // Lay the robots out in group order (in order of addition within a group), and split each group into work units.
+  int p = 0;
+  int offset = 0;
+  noOfUnits = 0;
+  for (int g = 0; g < noOfGroups; g++)
+  {
+    for (int r = 0; r < noOfRobots; r++)
+    {
+      if (robotGroup[r] != g) { continue; }
+
+      if (p == 0 || poolGroup[p - 1] != g || unitCount[noOfUnits - 1] == unitSize)
+      {
+        unitFirst[noOfUnits] = p;
+        unitCount[noOfUnits++] = 0;
+      }
+      unitCount[noOfUnits - 1]++;
+
+      bool isNew = poolIndex[r] < 0;
+      poolRobot[p] = r;
+      poolGroup[p] = g;
+      qOffset[p] = offset;
+      poolIndex[r] = p;
+      offset += chains[r]->get_noOfLinks();
+
+      transformRevisions[r] = chains[r]->get_transformRevision() - 1; // Forces an update at the new pool position.
+      if (isNew)
+      {
+        startProgram(r);
+      }
+      else
+      {
+        int noOfLinks = chains[r]->get_noOfLinks();
+        for (int j = 0; j < noOfLinks; j++) { qPool[offset - noOfLinks + j] = q[r][j]; }
+        poolRunning[p] = running[r];
+      }
+      p++;
+    }
+  }
+
+  // Evaluate the poses.
+  for (int r = 0; r < noOfRobots; r++) { updateTransforms(r); }
+  for (int u = 0; u < noOfUnits; u++)
+  {
+    int first = unitFirst[u];
+    chains[groupKernel[poolGroup[first]]]->fKineBatch(&TmPool[first], &qPool[qOffset[first]], unitCount[u],
+                                                      &TmBasePool[first], &TmToolPool[first]);
+  }
+}
+
+void DhCellSimulator::startProgram(int robot) {
+  int p = poolIndex[robot];
+  programStarts[robot] = time;
+  finishTimes[robot] = -1;
+  if (programs[robot] != nullptr)
+  {
+    programs[robot]->reset();
+    programs[robot]->next(0, &qPool[qOffset[p]]);
+    poolRunning[p] = true;
+  }
+  else
+  {
+    chains[robot]->get_qCurrent(&qPool[qOffset[p]]);
+    poolRunning[p] = false;
+  }
+}
+
+void DhCellSimulator::updateTransforms(int robot) {
+  uint32_t revision = chains[robot]->get_transformRevision();
+  if (revision == transformRevisions[robot]) { return; }
+
+  int p = poolIndex[robot];
+  chains[robot]->get_TmBase(TmBasePool[p]);
+  chains[robot]->get_TmTool(TmToolPool[p]);
+  transformRevisions[robot] = revision;
+}
+
+// Simulation
+
+void DhCellSimulator::reset() {
+  time = 0;
+  for (int r = 0; r < noOfRobots; r++) { startProgram(r); }
+  rebuildLayout(); // Evaluates the start poses.
+  reset_stats();
+}
+
+void DhCellSimulator::processUnit(int unit) {
+  int first = unitFirst[unit];
+  int count = unitCount[unit];
+  for (int p = first; p < first + count; p++)
+  {
+    DhTrajectoryEvaluator* program = programs[poolRobot[p]];
+    if (poolRunning[p]) { poolRunning[p] = program->next(stepDt, &qPool[qOffset[p]]); }
+  }
+
+  // One batch kernel call for the unit (all robots of a unit are in the same group).
+  chains[groupKernel[poolGroup[first]]]->fKineBatch(&TmPool[first], &qPool[qOffset[first]], count,
+                                                    &TmBasePool[first], &TmToolPool[first]);
+}
+
+void DhCellSimulator::processUnits() {
+  int unit;
+  while ((unit = nextUnit.fetch_add(1)) < noOfUnits)
+  {
+    processUnit(unit);
+    noOfUnitsDone.fetch_add(1);
+  }
+}
+
+void DhCellSimulator::workerLoop() {
+  uint32_t generation = stepGeneration.load();
+  while (true)
+  {
+    // Spin briefly (steps normally follow each other closely), then sleep until the next step.
+    int spin = 0;
+    while (stepGeneration.load() == generation && !poolStopping.load() && spin < workerSpinCount)
+    {
+      this_thread::yield();
+      spin++;
+    }
+    if (stepGeneration.load() == generation && !poolStopping.load())
+    {
+      unique_lock<mutex> lock(poolMutex);
+      noOfSleepingWorkers++;
+      poolCondition.wait(lock, [&]() { return stepGeneration.load() != generation || poolStopping.load(); });
+      noOfSleepingWorkers--;
+    }
+
+    if (poolStopping.load()) { return; }
+    generation = stepGeneration.load();
+    processUnits();
+  }
+}
+
+void DhCellSimulator::startWorkers() {
+  for (int t = 1; t < noOfThreads; t++) { workers[t] = thread(&DhCellSimulator::workerLoop, this); }
+}
+
+void DhCellSimulator::stopWorkers() {
+  {
+    lock_guard<mutex> lock(poolMutex);
+    poolStopping.store(true);
+  }
+  poolCondition.notify_all();
+  for (int t = 1; t < noOfThreads; t++)
+  {
+    if (workers[t].joinable()) { workers[t].join(); }
+  }
+  poolStopping.store(false);
+}
+
+bool DhCellSimulator::step(float dt) {
+  auto startTime = chrono::steady_clock::now();
+
+  for (int r = 0; r < noOfRobots; r++) { updateTransforms(r); }
+
+  // Publish the step (the stores are ordered before the generation increment), work on it and wait for the workers.
+  stepDt = dt;
+  noOfUnitsDone.store(0);
+  nextUnit.store(0);
+  if (noOfThreads > 1)
+  {
+    stepGeneration.fetch_add(1);
+    lock_guard<mutex> lock(poolMutex);
+    if (noOfSleepingWorkers > 0) { poolCondition.notify_all(); }
+  }
+  processUnits();
+  while (noOfUnitsDone.load() < noOfUnits) { this_thread::yield(); }
+
+  // Program completion, in robot order.
+  time += dt;
+  bool running = false;
+  for (int r = 0; r < noOfRobots; r++)
+  {
+    if (poolRunning[poolIndex[r]]) { running = true; }
+    else if (finishTimes[r] < 0 && programs[r] != nullptr) { finishTimes[r] = programStarts[r] + programs[r]->get_time(); }
+  }
+
+  double stepTime = chrono::duration<double>(chrono::steady_clock::now() - startTime).count();
+  stats.noOfSteps++;
+  stats.simulatedTime += dt;
+  stats.wallTime += stepTime;
+  stats.lastStepTime = stepTime;
+  if (stepTime > stats.maxStepTime) { stats.maxStepTime = stepTime; }
+  stats.realTimeFactor = (stats.wallTime > 0) ? stats.simulatedTime / stats.wallTime : 0;
+  return running;
+}
+
+long DhCellSimulator::run(float dt, long maxSteps) {
+  long noOfSteps = 0;
+  while (noOfSteps < maxSteps)
+  {
+    noOfSteps++;
+    if (!step(dt)) { break; }
+  }
+  return noOfSteps;
+}
+
+double DhCellSimulator::get_time() { return time; }
+
+double DhCellSimulator::get_finishTime(int robot) { return finishTimes[robot]; }
+
+void DhCellSimulator::get_robotQ(int robot, float qOutput[]) {
+  int p = poolIndex[robot];
+  int noOfLinks = chains[robot]->get_noOfLinks();
+  for (int j = 0; j < noOfLinks; j++) { qOutput[j] = qPool[qOffset[p] + j]; }
+}
+
+void DhCellSimulator::get_robotTm(int robot, float TmOutput[4][4]) {
+  int p = poolIndex[robot];
+  for (int r = 0; r < 4; r++)
+  {
+    for (int c = 0; c < 4; c++) { TmOutput[r][c] = TmPool[p][r][c]; }
+  }
+}
+
+// Statistics
+
+void DhCellSimulator::get_stats(DhCellStats& statsOutput) { statsOutput = stats; }
+
+void DhCellSimulator::reset_stats() { stats = DhCellStats(); }
+
+} // namespace mt
+
+#endif
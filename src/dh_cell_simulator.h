@@ -0,0 +1,210 @@
+// Copyright (C) 2015 - 2020 Joseph Morgridge
+//
+// Licensed under GNU General Public License v3.0 (GPLv3) License.
+// See the LICENSE file in the project root for full license details.
+
+#ifndef DH_CELL_SIMULATOR_H_
+#define DH_CELL_SIMULATOR_H_
+
+#include "dh_kinematic_chain.h"
+#include "dh_time_parameterization.h"
+
+#if __has_include(<Arduino.h>)
+#include <Arduino.h>
+#define USING_ARDUINO 1
+#else
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#define USING_ARDUINO 0
+#endif
+
+// Max. no. of robots in a simulated cell. It can be changed for the whole library by defining it in the build flags
+// e.g. -DDH_CELL_MAX_ROBOTS=128.
+#ifndef DH_CELL_MAX_ROBOTS
+#define DH_CELL_MAX_ROBOTS 64
+#endif
+
+// The cell simulator runs on a thread pool (desktop platforms).
+#if !USING_ARDUINO
+
+namespace mt {
+
+// Cell simulation statistics.
+struct DhCellStats {
+  uint64_t noOfSteps = 0;
+  double simulatedTime = 0; // (s).
+  double wallTime = 0;      // Sum of the step times (s).
+  double maxStepTime = 0;   // (s).
+  double lastStepTime = 0;  // (s).
+  double realTimeFactor = 0; // Simulated time / wall time.
+};
+
+// Class to encapsulate a multi-robot cell simulator, e.g. to estimate the cycle time of a cell.
+// Each robot is a DhKinematicChain (with its own D-H table, base and tool) running a program (DhTrajectoryEvaluator).
+// The robots are advanced in lockstep: every step evaluates each program and then the tool-tip pose of each robot.
+// Robots with identical links are grouped, and the joint angles, base/tool matrices and poses are held in pooled arrays
+// in group order, so each group is evaluated with one batch kernel (DhKinematicChain::fKineBatch(...) with per-robot
+// base and tool) over contiguous memory. Each step is split into fixed work units (blocks of robots of a group) that are
+// shared by a persistent thread pool; every unit writes only its own robots, so the results are identical for any number
+// of threads. The chains are only read (the base and tool are picked up when they change).
+class DhCellSimulator {
+
+ public:
+
+  // General Constants
+  static const int maxLinks = DhKinematicChain::maxLinks;
+  static const int maxRobots = DH_CELL_MAX_ROBOTS;
+  static const int maxThreads = 16;
+  static const int unitSize = 8; // Max. robots per work unit (batch kernel call).
+
+ private:
+
+  // Robot Parameters (in order of addition)
+  int noOfRobots = 0;
+  DhKinematicChain* chains[maxRobots];
+  DhTrajectoryEvaluator* programs[maxRobots];
+  uint32_t transformRevisions[maxRobots];
+  int poolIndex[maxRobots];  // Position of each robot in the pooled arrays.
+  double programStarts[maxRobots]; // Simulated time the program started (s).
+  double finishTimes[maxRobots];   // Simulated time the program finished (s), -1 while running.
+
+  // Pooled Layout (in group order)
+  int poolRobot[maxRobots];   // Robot at each pool position.
+  int poolGroup[maxRobots];   // Group of each pool position.
+  int qOffset[maxRobots];     // Offset of the joint angles of each pool position in qPool.
+  bool poolRunning[maxRobots];
+  float qPool[maxRobots * maxLinks]; // Joint angles, packed per group (stride = no. of links of the group).
+  float TmBasePool[maxRobots][4][4];
+  float TmToolPool[maxRobots][4][4];
+  float TmPool[maxRobots][4][4]; // Tool-tip poses w.r.t. the world frame.
+
+  // Groups and Work Units
+  int noOfGroups = 0;
+  int groupKernel[maxRobots]; // Robot whose chain evaluates the group.
+  int noOfUnits = 0;
+  int unitFirst[maxRobots];   // First pool position of each unit.
+  int unitCount[maxRobots];
+
+  // Simulation State
+  double time = 0;
+  float stepDt = 0;
+  DhCellStats stats;
+
+  // Thread Pool
+  int noOfThreads = 1;
+  std::thread workers[maxThreads];
+  std::mutex poolMutex;
+  std::condition_variable poolCondition;
+  int noOfSleepingWorkers = 0; // Workers spin on stepGeneration for a while after each step, then sleep.
+  std::atomic<bool> poolStopping{false};
+  std::atomic<uint32_t> stepGeneration{0};
+  std::atomic<int> nextUnit{0};
+  std::atomic<int> noOfUnitsDone{0};
+
+  // Rebuild the groups, the pooled layout and the work units (e.g. after a robot is added), and evaluate the poses.
+  // The joint angles of the robots are kept.
+  void rebuildLayout();
+
+  // Set the start joint angles of a robot (its program at time 0, or the chain current joint angles).
+  void startProgram(int robot);
+
+  // Copy the base and tool of a robot into the pooled arrays.
+  void updateTransforms(int robot);
+
+  // Evaluate a work unit: advance the programs and evaluate the poses of its robots.
+  void processUnit(int unit);
+
+  // Take and evaluate work units until there are none left in the current step.
+  void processUnits();
+
+  // Worker thread main loop.
+  void workerLoop();
+
+  // Start or stop the worker threads.
+  void startWorkers();
+  void stopWorkers();
+
+ public:
+
+  // Constructors
+
+  DhCellSimulator() = default;
+  DhCellSimulator(const DhCellSimulator&) = delete;
+  DhCellSimulator& operator=(const DhCellSimulator&) = delete;
+  ~DhCellSimulator();
+
+  // Cell Methods
+
+  // Add a robot to the cell. The chain and program are NOT copied and must outlive the simulator.
+  // Inputs are the robots kinematic model (its base places it in the cell) and program (nullptr to hold the current
+  // joint angles of the chain).
+  // Output is robot index, or -1 if the cell is full.
+  int add_robot(DhKinematicChain& chainInput, DhTrajectoryEvaluator* programInput);
+
+  // Set the program of a robot. The program starts at the current simulated time (and again on reset()).
+  // Inputs are robot index and program (nullptr to hold the current joint angles of the chain).
+  void set_program(int robot, DhTrajectoryEvaluator* programInput);
+
+  // Get no. of robots.
+  int get_noOfRobots();
+
+  // Get no. of groups of robots with identical links (i.e. no. of batch kernels per step).
+  int get_noOfGroups();
+
+  // Set no. of threads (1 runs on the calling thread only). Results are identical for any number of threads.
+  // Input is no. of threads (1 to maxThreads).
+  void set_noOfThreads(int noOfThreadsInput);
+
+  // Simulation Methods
+
+  // Restart every program and the simulated time, and reset the statistics.
+  void reset();
+
+  // Advance every robot by one time step in lockstep.
+  // Input is time step in s.
+  // Output is true while any program is still running.
+  bool step(float dt);
+
+  // Advance the cell until every program has finished, e.g. to find the cell cycle time (get_time()).
+  // Inputs are time step in s and max. no. of steps.
+  // Output is no. of steps taken.
+  long run(float dt, long maxSteps);
+
+  // Get simulated time.
+  // Output is time in s.
+  double get_time();
+
+  // Get the simulated time at which a robot program finished, i.e. the robots cycle time.
+  // Input is robot index.
+  // Output is time in s, or -1 if the program is still running.
+  double get_finishTime(int robot);
+
+  // Get the joint angles of a robot after the last step.
+  // Inputs are robot index and array to store output.
+  // Array size must match number of links of the robot.
+  // Output is angles in rad.
+  void get_robotQ(int robot, float qOutput[]);
+
+  // Get the tool-tip pose of a robot after the last step.
+  // Inputs are robot index and 4 x 4 array to store output.
+  // Output is transformation matrix w.r.t. the world frame.
+  void get_robotTm(int robot, float TmOutput[4][4]);
+
+  // Statistics Methods
+
+  // Get the simulation statistics (per-step timing and real time factor).
+  // Input is statistics object to store output.
+  void get_stats(DhCellStats& statsOutput);
+
+  // Reset the simulation statistics.
+  void reset_stats();
+};
+
+} // namespace mt
+
+#endif
+
+#endif // DH_CELL_SIMULATOR_H_
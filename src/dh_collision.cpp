@@ -0,0 +1,529 @@
+// Copyright (C) 2015 - 2020 Joseph Morgridge
+//
+// Licensed under GNU General Public License v3.0 (GPLv3) License.
+// See the LICENSE file in the project root for full license details.
+
+#include "dh_collision.h"
+
+#include "dh_kinematic_chain.h"
+
+#if USING_ARDUINO
+#include <Arduino.h>
+#else
+#include <cmath>
+using namespace std;
+#endif
+
+namespace mt {
+
+namespace {
+
+float clamp01(float value) {
+  if (value < 0) { return 0; }
+  if (value > 1) { return 1; }
+  return value;
+}
+
+float dot3(const float u[3], const float v[3]) {
+  return u[0] * v[0] + u[1] * v[1] + u[2] * v[2];
+}
+
+void capsuleBox(const DhCapsule& capsule, float boxMin[3], float boxMax[3]) {
+  for (int k = 0; k < 3; k++)
+  {
+    float lo = capsule.p0[k] < capsule.p1[k] ? capsule.p0[k] : capsule.p1[k];
+    float hi = capsule.p0[k] < capsule.p1[k] ? capsule.p1[k] : capsule.p0[k];
+    boxMin[k] = lo - capsule.radius;
+    boxMax[k] = hi + capsule.radius;
+  }
+}
+
+bool boxesOverlap(const float aMin[3], const float aMax[3], const float bMin[3], const float bMax[3]) {
+  return (aMin[0] <= bMax[0]) && (bMin[0] <= aMax[0]) &&
+         (aMin[1] <= bMax[1]) && (bMin[1] <= aMax[1]) &&
+         (aMin[2] <= bMax[2]) && (bMin[2] <= aMax[2]);
+}
+
+// Gap between two boxes (0 if overlapping), a lower bound of the distance between any geometry inside them.
+float boxesGap(const float aMin[3], const float aMax[3], const float bMin[3], const float bMax[3]) {
+  float gapSquared = 0;
+  for (int k = 0; k < 3; k++)
+  {
+    float gap = 0;
+    if (aMin[k] > bMax[k]) { gap = aMin[k] - bMax[k]; }
+    else if (bMin[k] > aMax[k]) { gap = bMin[k] - aMax[k]; }
+    gapSquared += gap * gap;
+  }
+  return sqrt(gapSquared);
+}
+
+} // namespace
+
+DhCollisionModel::DhCollisionModel(DhKinematicChain& chainInput):
+chain(chainInput) {
+  for (int i = 0; i < maxLinks; i++)
+  {
+    linkHasCapsule[i] = false;
+    allowedPairs[i] = 0;
+  }
+
+  for (int i = 0; i < maxLinks - 1; i++)
+  {
+    set_allowedPair(i, i + 1, true);
+  }
+}
+
+void DhCollisionModel::set_linkCapsule(int index, float p0Input[3], float p1Input[3], float radius) {
+  for (int k = 0; k < 3; k++)
+  {
+    linkCapsules[index].p0[k] = p0Input[k];
+    linkCapsules[index].p1[k] = p1Input[k];
+  }
+  linkCapsules[index].radius = radius;
+  linkHasCapsule[index] = true;
+}
+
+void DhCollisionModel::set_linkSphere(int index, float centreInput[3], float radius) {
+  set_linkCapsule(index, centreInput, centreInput, radius);
+}
+
+void DhCollisionModel::clear_linkGeometry(int index) { linkHasCapsule[index] = false; }
+
+void DhCollisionModel::set_allowedPair(int index1, int index2, bool allowed) {
+  if (allowed)
+  {
+    allowedPairs[index1] |= (1u << index2);
+    allowedPairs[index2] |= (1u << index1);
+  }
+  else
+  {
+    allowedPairs[index1] &= ~(1u << index2);
+    allowedPairs[index2] &= ~(1u << index1);
+  }
+}
+
+bool DhCollisionModel::get_allowedPair(int index1, int index2) {
+  return (allowedPairs[index1] & (1u << index2)) != 0;
+}
+
+int DhCollisionModel::add_obstacleCapsule(float p0Input[3], float p1Input[3], float radius) {
+  if (noOfObstacles >= maxObstacles) { return -1; }
+
+  DhCapsule& obstacle = obstacles[noOfObstacles];
+  for (int k = 0; k < 3; k++)
+  {
+    obstacle.p0[k] = p0Input[k];
+    obstacle.p1[k] = p1Input[k];
+  }
+  obstacle.radius = radius;
+  bvhValid = false;
+  return noOfObstacles++;
+}
+
+int DhCollisionModel::add_obstacleSphere(float centreInput[3], float radius) {
+  return add_obstacleCapsule(centreInput, centreInput, radius);
+}
+
+void DhCollisionModel::clear_obstacles() {
+  noOfObstacles = 0;
+  noOfBvhNodes = 0;
+  bvhValid = false;
+}
+
+int DhCollisionModel::get_noOfObstacles() { return noOfObstacles; }
+
+void DhCollisionModel::buildObstacleBvh() {
+  noOfBvhNodes = 0;
+  for (int i = 0; i < noOfObstacles; i++)
+  {
+    obstacleOrder[i] = i;
+  }
+  if (noOfObstacles > 0) { buildBvhNode(0, noOfObstacles); }
+  bvhValid = true;
+}
+
+int DhCollisionModel::buildBvhNode(int first, int count) {
+  int nodeIndex = noOfBvhNodes++;
+  BvhNode& node = bvhNodes[nodeIndex];
+
+  // Bound all obstacles in the range.
+  capsuleBox(obstacles[obstacleOrder[first]], node.boxMin, node.boxMax);
+  for (int i = first + 1; i < first + count; i++)
+  {
+    float boxMin[3], boxMax[3];
+    capsuleBox(obstacles[obstacleOrder[i]], boxMin, boxMax);
+    for (int k = 0; k < 3; k++)
+    {
+      if (boxMin[k] < node.boxMin[k]) { node.boxMin[k] = boxMin[k]; }
+      if (boxMax[k] > node.boxMax[k]) { node.boxMax[k] = boxMax[k]; }
+    }
+  }
+
+  if (count <= maxObstaclesPerLeaf)
+  {
+    node.left = -1;
+    node.right = -1;
+    node.first = first;
+    node.count = count;
+    return nodeIndex;
+  }
+
+  // Split along the longest axis at the median obstacle centre (insertion sort; the obstacle set is small).
+  int axis = 0;
+  float extent = node.boxMax[0] - node.boxMin[0];
+  for (int k = 1; k < 3; k++)
+  {
+    if (node.boxMax[k] - node.boxMin[k] > extent) { extent = node.boxMax[k] - node.boxMin[k]; axis = k; }
+  }
+
+  for (int i = first + 1; i < first + count; i++)
+  {
+    int key = obstacleOrder[i];
+    float keyCentre = obstacles[key].p0[axis] + obstacles[key].p1[axis];
+    int j = i - 1;
+    while (j >= first && (obstacles[obstacleOrder[j]].p0[axis] + obstacles[obstacleOrder[j]].p1[axis]) > keyCentre)
+    {
+      obstacleOrder[j + 1] = obstacleOrder[j];
+      j--;
+    }
+    obstacleOrder[j + 1] = key;
+  }
+
+  int half = count / 2;
+  int left = buildBvhNode(first, half);
+  int right = buildBvhNode(first + half, count - half);
+  node.left = left;
+  node.right = right;
+  node.count = 0;
+  return nodeIndex;
+}
+
+void DhCollisionModel::transformCapsule(const DhCapsule& capsuleInput, float TmInput[4][4], DhCapsule& capsuleOutput) {
+  for (int r = 0; r < 3; r++)
+  {
+    capsuleOutput.p0[r] = TmInput[r][0] * capsuleInput.p0[0] + TmInput[r][1] * capsuleInput.p0[1] +
+                          TmInput[r][2] * capsuleInput.p0[2] + TmInput[r][3];
+    capsuleOutput.p1[r] = TmInput[r][0] * capsuleInput.p1[0] + TmInput[r][1] * capsuleInput.p1[1] +
+                          TmInput[r][2] * capsuleInput.p1[2] + TmInput[r][3];
+  }
+  capsuleOutput.radius = capsuleInput.radius;
+}
+
+int DhCollisionModel::checkCapsuleAgainstObstacles(const DhCapsule& capsuleInput) {
+  if (noOfObstacles == 0) { return -1; }
+  if (!bvhValid) { buildObstacleBvh(); }
+
+  float boxMin[3], boxMax[3];
+  capsuleBox(capsuleInput, boxMin, boxMax);
+
+  int stack[maxBvhNodes];
+  int stackSize = 0;
+  stack[stackSize++] = 0;
+
+  while (stackSize > 0)
+  {
+    const BvhNode& node = bvhNodes[stack[--stackSize]];
+    if (!boxesOverlap(boxMin, boxMax, node.boxMin, node.boxMax)) { continue; }
+
+    if (node.left < 0)
+    {
+      for (int i = node.first; i < node.first + node.count; i++)
+      {
+        if (capsulesOverlap(capsuleInput, obstacles[obstacleOrder[i]])) { return obstacleOrder[i]; }
+      }
+    }
+    else
+    {
+      stack[stackSize++] = node.right;
+      stack[stackSize++] = node.left;
+    }
+  }
+
+  return -1;
+}
+
+bool DhCollisionModel::checkCollision(float qInput[], DhCollisionHit* hitOutput) {
+  float TmFrames[maxLinks][4][4];
+  chain.fKineFrames(TmFrames, qInput);
+  return checkCollisionFrames(TmFrames, hitOutput);
+}
+
+bool DhCollisionModel::checkCollisionFrames(float TmFramesInput[][4][4], DhCollisionHit* hitOutput) {
+  // Environment first; a static obstacle hit is the most common rejection for planners.
+  if (checkEnvironmentCollisionFrames(TmFramesInput, hitOutput)) { return true; }
+  return checkSelfCollisionFrames(TmFramesInput, hitOutput);
+}
+
+bool DhCollisionModel::checkSelfCollisionFrames(float TmFramesInput[][4][4], DhCollisionHit* hitOutput) {
+  int noOfLinks = chain.get_noOfLinks();
+  DhCapsule worldCapsules[maxLinks];
+
+  for (int i = 0; i < noOfLinks; i++)
+  {
+    if (linkHasCapsule[i]) { transformCapsule(linkCapsules[i], TmFramesInput[i], worldCapsules[i]); }
+  }
+
+  for (int i = 0; i < noOfLinks; i++)
+  {
+    if (!linkHasCapsule[i]) { continue; }
+
+    for (int j = i + 1; j < noOfLinks; j++)
+    {
+      if (!linkHasCapsule[j] || (allowedPairs[i] & (1u << j))) { continue; }
+
+      if (capsulesOverlap(worldCapsules[i], worldCapsules[j]))
+      {
+        if (hitOutput != nullptr)
+        {
+          hitOutput->linkIndex = i;
+          hitOutput->otherLinkIndex = j;
+          hitOutput->obstacleIndex = -1;
+        }
+        return true;
+      }
+    }
+  }
+
+  return false;
+}
+
+bool DhCollisionModel::checkEnvironmentCollisionFrames(float TmFramesInput[][4][4], DhCollisionHit* hitOutput) {
+  int noOfLinks = chain.get_noOfLinks();
+
+  for (int i = 0; i < noOfLinks; i++)
+  {
+    if (!linkHasCapsule[i]) { continue; }
+
+    DhCapsule worldCapsule;
+    transformCapsule(linkCapsules[i], TmFramesInput[i], worldCapsule);
+
+    int obstacleIndex = checkCapsuleAgainstObstacles(worldCapsule);
+    if (obstacleIndex >= 0)
+    {
+      if (hitOutput != nullptr)
+      {
+        hitOutput->linkIndex = i;
+        hitOutput->otherLinkIndex = -1;
+        hitOutput->obstacleIndex = obstacleIndex;
+      }
+      return true;
+    }
+  }
+
+  return false;
+}
+
+float DhCollisionModel::capsuleObstacleDistance(const DhCapsule& capsuleInput, float maxDistance, int& obstacleIndexOutput) {
+  obstacleIndexOutput = -1;
+  if (noOfObstacles == 0) { return maxDistance; }
+  if (!bvhValid) { buildObstacleBvh(); }
+
+  float boxMin[3], boxMax[3];
+  capsuleBox(capsuleInput, boxMin, boxMax);
+
+  int stack[maxBvhNodes];
+  int stackSize = 0;
+  stack[stackSize++] = 0;
+  float distance = maxDistance;
+
+  while (stackSize > 0)
+  {
+    const BvhNode& node = bvhNodes[stack[--stackSize]];
+    if (boxesGap(boxMin, boxMax, node.boxMin, node.boxMax) >= distance) { continue; }
+
+    if (node.left < 0)
+    {
+      for (int i = node.first; i < node.first + node.count; i++)
+      {
+        const DhCapsule& obstacle = obstacles[obstacleOrder[i]];
+        float d = sqrt(segmentDistanceSquared(capsuleInput.p0, capsuleInput.p1, obstacle.p0, obstacle.p1)) -
+                  capsuleInput.radius - obstacle.radius;
+        if (d < distance)
+        {
+          distance = d;
+          obstacleIndexOutput = obstacleOrder[i];
+        }
+      }
+    }
+    else
+    {
+      stack[stackSize++] = node.right;
+      stack[stackSize++] = node.left;
+    }
+  }
+
+  return distance;
+}
+
+float DhCollisionModel::conservativeStep(float TmFramesInput[][4][4], const float motionBounds[], DhCollisionHit& hitOutput) {
+  int noOfLinks = chain.get_noOfLinks();
+  DhCapsule worldCapsules[maxLinks];
+  float step = INFINITY;
+
+  // Environment.
+  for (int i = 0; i < noOfLinks; i++)
+  {
+    if (!linkHasCapsule[i]) { continue; }
+    transformCapsule(linkCapsules[i], TmFramesInput[i], worldCapsules[i]);
+
+    // Obstacles the link cannot reach within the current step do not limit it, so they are pruned.
+    float maxDistance = (motionBounds[i] > 0) ? step * motionBounds[i] : 0;
+    if (maxDistance < continuousTolerance) { maxDistance = continuousTolerance; }
+    int obstacleIndex;
+    float distance = capsuleObstacleDistance(worldCapsules[i], maxDistance, obstacleIndex);
+    if (distance <= continuousTolerance)
+    {
+      hitOutput.linkIndex = i;
+      hitOutput.otherLinkIndex = -1;
+      hitOutput.obstacleIndex = obstacleIndex;
+      return 0;
+    }
+    if (obstacleIndex >= 0 && motionBounds[i] > 0) { step = distance / motionBounds[i]; }
+  }
+
+  // Self.
+  for (int i = 0; i < noOfLinks; i++)
+  {
+    if (!linkHasCapsule[i]) { continue; }
+
+    for (int j = i + 1; j < noOfLinks; j++)
+    {
+      if (!linkHasCapsule[j] || (allowedPairs[i] & (1u << j))) { continue; }
+
+      float distance = sqrt(segmentDistanceSquared(worldCapsules[i].p0, worldCapsules[i].p1,
+                                                   worldCapsules[j].p0, worldCapsules[j].p1)) -
+                       worldCapsules[i].radius - worldCapsules[j].radius;
+      if (distance <= continuousTolerance)
+      {
+        hitOutput.linkIndex = i;
+        hitOutput.otherLinkIndex = j;
+        hitOutput.obstacleIndex = -1;
+        return 0;
+      }
+
+      // Both links may move towards each other.
+      float bound = motionBounds[i] + motionBounds[j];
+      if (bound > 0 && distance / bound < step) { step = distance / bound; }
+    }
+  }
+
+  return step;
+}
+
+void DhCollisionModel::set_continuousTolerance(float toleranceInput, int maxStepsInput) {
+  continuousTolerance = toleranceInput;
+  maxContinuousSteps = maxStepsInput;
+}
+
+bool DhCollisionModel::checkContinuousCollision(float q0Input[], float q1Input[], DhCollisionHit* hitOutput, float* tOutput) {
+  int noOfLinks = chain.get_noOfLinks();
+  DhKinematicLink links[maxLinks];
+  chain.get_links(links);
+
+  // Motion bound of each link per unit motion parameter: joint j rotates link i (j <= i) by |dq_j|, and any point of
+  // the link geometry is at most (sum of the link lengths from joint j to link i + geometry extent) from its axis.
+  // Link k moves its frame origin by d_k along the previous z axis and a_k along its x axis.
+  float motionBounds[maxLinks];
+  for (int i = 0; i < noOfLinks; i++)
+  {
+    float extent = 0;
+    if (linkHasCapsule[i])
+    {
+      float extent0 = sqrt(dot3(linkCapsules[i].p0, linkCapsules[i].p0));
+      float extent1 = sqrt(dot3(linkCapsules[i].p1, linkCapsules[i].p1));
+      extent = (extent0 > extent1) ? extent0 : extent1;
+    }
+
+    float bound = 0;
+    float radius = extent;
+    for (int j = i; j >= 0; j--)
+    {
+      radius += sqrt(links[j].get_a() * links[j].get_a() + links[j].get_d() * links[j].get_d());
+      bound += fabs(q1Input[j] - q0Input[j]) * radius;
+    }
+    motionBounds[i] = bound;
+  }
+
+  float q[maxLinks];
+  float TmFrames[maxLinks][4][4];
+  DhCollisionHit hit;
+  float t = 0;
+
+  for (int n = 0; n < maxContinuousSteps; n++)
+  {
+    for (int i = 0; i < noOfLinks; i++) { q[i] = q0Input[i] + t * (q1Input[i] - q0Input[i]); }
+    chain.fKineFrames(TmFrames, q);
+
+    float step = conservativeStep(TmFrames, motionBounds, hit);
+    if (step <= 0) { break; }
+
+    // The clearances cover the whole step, so the segment is certified up to t + step.
+    t += step;
+    if (t >= 1) { return false; }
+  }
+
+  // In contact, or not certified within the max. no. of steps (hit indexes are then -1).
+  if (hitOutput != nullptr) { *hitOutput = hit; }
+  if (tOutput != nullptr) { *tOutput = t; }
+  return true;
+}
+
+int DhCollisionModel::checkContinuousCollisionPath(float qPathInput[], int noOfPoints, DhCollisionHit* hitOutput) {
+  int noOfLinks = chain.get_noOfLinks();
+  for (int p = 0; p + 1 < noOfPoints; p++)
+  {
+    if (checkContinuousCollision(&qPathInput[p * noOfLinks], &qPathInput[(p + 1) * noOfLinks], hitOutput)) { return p; }
+  }
+  return -1;
+}
+
+float DhCollisionModel::segmentDistanceSquared(const float p0[3], const float p1[3], const float q0[3], const float q1[3]) {
+  // Closest points of two segments. Algorithm from:
+  // Ericson, C. (2005) Real-Time Collision Detection. Section 5.1.9.
+  const float epsilon = 1e-9;
+  float d1[3] = {p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2]};
+  float d2[3] = {q1[0] - q0[0], q1[1] - q0[1], q1[2] - q0[2]};
+  float r[3] = {p0[0] - q0[0], p0[1] - q0[1], p0[2] - q0[2]};
+  float a = dot3(d1, d1);
+  float e = dot3(d2, d2);
+  float f = dot3(d2, r);
+  float s = 0, t = 0;
+
+  if (a <= epsilon && e <= epsilon)
+  {
+    // Both segments are points.
+  }
+  else if (a <= epsilon)
+  {
+    t = clamp01(f / e);
+  }
+  else
+  {
+    float c = dot3(d1, r);
+    if (e <= epsilon)
+    {
+      s = clamp01(-c / a);
+    }
+    else
+    {
+      float b = dot3(d1, d2);
+      float denom = a * e - b * b;
+      s = (denom > epsilon) ? clamp01((b * f - c * e) / denom) : 0;
+      t = (b * s + f) / e;
+      if (t < 0) { t = 0; s = clamp01(-c / a); }
+      else if (t > 1) { t = 1; s = clamp01((b - c) / a); }
+    }
+  }
+
+  float dx = (p0[0] + d1[0] * s) - (q0[0] + d2[0] * t);
+  float dy = (p0[1] + d1[1] * s) - (q0[1] + d2[1] * t);
+  float dz = (p0[2] + d1[2] * s) - (q0[2] + d2[2] * t);
+  return (dx * dx + dy * dy + dz * dz);
+}
+
+bool DhCollisionModel::capsulesOverlap(const DhCapsule& capsule1, const DhCapsule& capsule2) {
+  float radiusSum = capsule1.radius + capsule2.radius;
+  return segmentDistanceSquared(capsule1.p0, capsule1.p1, capsule2.p0, capsule2.p1) <= radiusSum * radiusSum;
+}
+
+} // namespace mt
@@ -0,0 +1,219 @@
+// Copyright (C) 2015 - 2020 Joseph Morgridge
+//
+// Licensed under GNU General Public License v3.0 (GPLv3) License.
+// See the LICENSE file in the project root for full license details.
+
+#ifndef DH_COLLISION_H_
+#define DH_COLLISION_H_
+
+#include "dh_kinematic_chain.h"
+
+#if __has_include(<Arduino.h>)
+#include <Arduino.h>
+#define USING_ARDUINO 1
+#else
+#define USING_ARDUINO 0
+#endif
+
+namespace mt {
+
+// Capsule (sphere-swept line segment) geometry.
+// A sphere is a capsule with both end points at the centre.
+struct DhCapsule {
+  float p0[3] = {0, 0, 0}; // Segment start point (x, y, z).
+  float p1[3] = {0, 0, 0}; // Segment end point (x, y, z).
+  float radius = 0;        // Swept sphere radius.
+};
+
+// Details of the first collision found.
+// Indexes not involved in the collision are set to -1.
+struct DhCollisionHit {
+  int linkIndex = -1;      // Index of the (first) colliding link.
+  int otherLinkIndex = -1; // Index of the other colliding link (self-collision).
+  int obstacleIndex = -1;  // Index of the colliding obstacle (environment collision).
+};
+
+// Class to encapsulate the collision geometry of a robot (link chain/series) and its static environment.
+// Link geometry is attached to the link frames and evaluated using the per-link frames from the forward kinematics pass
+// of the DhKinematicChain (i.e. the link frames are NOT recomputed by a separate library).
+class DhCollisionModel {
+
+ public:
+
+  // General Constants
+  static const int maxLinks = DhKinematicChain::maxLinks;
+  static const int maxObstacles = 32; // Maximum number of static obstacles.
+
+ private:
+
+  // Bounding volume hierarchy (BVH) node (axis aligned bounding box).
+  struct BvhNode {
+    float boxMin[3];
+    float boxMax[3];
+    int left = -1;  // Left child node index (-1 if leaf).
+    int right = -1; // Right child node index (-1 if leaf).
+    int first = 0;  // Index of first obstacle in obstacleOrder (leaf only).
+    int count = 0;  // Number of obstacles (leaf only).
+  };
+
+  static const int maxBvhNodes = 2 * maxObstacles - 1;
+  static const int maxObstaclesPerLeaf = 2;
+
+  // Robot Parameters
+  DhKinematicChain& chain;
+  DhCapsule linkCapsules[maxLinks]; // Link geometry w.r.t. the link frames.
+  bool linkHasCapsule[maxLinks];
+  unsigned int allowedPairs[maxLinks]; // Allowed (i.e. not checked) self-collision pair matrix. Bit j of row i is pair (i, j).
+
+  // Environment Parameters
+  int noOfObstacles = 0;
+  DhCapsule obstacles[maxObstacles]; // Obstacle geometry w.r.t. the world frame.
+  int obstacleOrder[maxObstacles];   // Obstacle indexes sorted into BVH leaf order.
+  int noOfBvhNodes = 0;
+  BvhNode bvhNodes[maxBvhNodes];
+  bool bvhValid = false;
+
+  // Continuous Collision Parameters
+  float continuousTolerance = 0.1; // Min. clearance for a segment to be certified collision free.
+  int maxContinuousSteps = 1000;
+
+  // Build a BVH node (and its children) from a range of obstacles in obstacleOrder.
+  // Output is node index.
+  int buildBvhNode(int first, int count);
+
+  // Transform link geometry to the world frame.
+  void transformCapsule(const DhCapsule& capsuleInput, float TmInput[4][4], DhCapsule& capsuleOutput);
+
+  // Check a world frame capsule against the obstacle BVH.
+  // Output is index of first colliding obstacle or -1 if none.
+  int checkCapsuleAgainstObstacles(const DhCapsule& capsuleInput);
+
+  // Calculate the distance from a world frame capsule to the nearest obstacle, using the BVH. Obstacles at or beyond
+  // the max. distance are pruned.
+  // Output is distance (negative if overlapping, max. distance if no obstacle is closer) and obstacle index (-1 if none).
+  float capsuleObstacleDistance(const DhCapsule& capsuleInput, float maxDistance, int& obstacleIndexOutput);
+
+  // Calculate the conservative advancement step at the given link frames: the largest motion parameter step for which
+  // no link can reach an obstacle or another link, from the clearances and the link motion bounds.
+  // Inputs are link frames, motion bound of each link (max. displacement of its geometry per unit motion parameter)
+  // and hit details to store output.
+  // Output is step (infinite if nothing can collide), or 0 if a clearance is within the continuous tolerance (the hit
+  // details are then set).
+  float conservativeStep(float TmFramesInput[][4][4], const float motionBounds[], DhCollisionHit& hitOutput);
+
+ public:
+
+  // Constructors
+
+  // Adjacent links are allowed (not checked) by default since their geometry normally overlaps at the joints.
+  DhCollisionModel(DhKinematicChain& chainInput);
+
+  // Link Geometry Methods
+
+  // Attach capsule geometry to a link.
+  // Inputs are link index, capsule end points (x, y, z) w.r.t. the link frame and radius.
+  // Index must be in range 0 to (no. of links - 1).
+  void set_linkCapsule(int index, float p0Input[3], float p1Input[3], float radius);
+
+  // Attach sphere geometry to a link.
+  // Inputs are link index, sphere centre (x, y, z) w.r.t. the link frame and radius.
+  // Index must be in range 0 to (no. of links - 1).
+  void set_linkSphere(int index, float centreInput[3], float radius);
+
+  // Remove the geometry attached to a link.
+  // Index must be in range 0 to (no. of links - 1).
+  void clear_linkGeometry(int index);
+
+  // Set whether a self-collision pair is allowed i.e. never checked.
+  // Inputs are link indexes and allowed flag.
+  void set_allowedPair(int index1, int index2, bool allowed);
+
+  // Get whether a self-collision pair is allowed.
+  // Inputs are link indexes.
+  // Output is allowed flag.
+  bool get_allowedPair(int index1, int index2);
+
+  // Environment Methods
+
+  // Add a static capsule obstacle.
+  // Inputs are capsule end points (x, y, z) w.r.t. the world frame and radius.
+  // Output is obstacle index or -1 if the obstacle set is full.
+  // The BVH is rebuilt on the next check.
+  int add_obstacleCapsule(float p0Input[3], float p1Input[3], float radius);
+
+  // Add a static sphere obstacle.
+  // Inputs are sphere centre (x, y, z) w.r.t. the world frame and radius.
+  // Output is obstacle index or -1 if the obstacle set is full.
+  int add_obstacleSphere(float centreInput[3], float radius);
+
+  // Remove all obstacles.
+  void clear_obstacles();
+
+  // Get number of obstacles.
+  int get_noOfObstacles();
+
+  // Build the obstacle BVH. This is done automatically on the first check after the obstacle set changes,
+  // but can be called in advance to keep the cost out of time critical code.
+  void buildObstacleBvh();
+
+  // Collision Checking Methods
+  // All checks return on the first collision found (early exit), so rejecting a colliding sample is cheap.
+
+  // Check for self and environment collisions given the joint angles.
+  // Inputs are array of joint angles in rad and optional hit details to store output (nullptr if not required).
+  // Output is true if in collision.
+  bool checkCollision(float qInput[], DhCollisionHit* hitOutput = nullptr);
+
+  // Check for self and environment collisions given the link frames.
+  // Inputs are array of 4 x 4 link frames w.r.t. the world frame (e.g. from DhKinematicChain::fKineFrames(...)),
+  // and optional hit details to store output (nullptr if not required).
+  // Output is true if in collision.
+  bool checkCollisionFrames(float TmFramesInput[][4][4], DhCollisionHit* hitOutput = nullptr);
+
+  // Check for self collisions only given the link frames.
+  // Inputs and output as checkCollisionFrames(...).
+  bool checkSelfCollisionFrames(float TmFramesInput[][4][4], DhCollisionHit* hitOutput = nullptr);
+
+  // Check for environment collisions only given the link frames.
+  // Inputs and output as checkCollisionFrames(...).
+  bool checkEnvironmentCollisionFrames(float TmFramesInput[][4][4], DhCollisionHit* hitOutput = nullptr);
+
+  // Continuous Collision Checking Methods
+  // Discrete checks at trajectory samples miss thin obstacles at high speed. The continuous checks certify the whole
+  // straight joint space segment between two configurations by conservative advancement: at each step, the clearance of
+  // every link (to the obstacles and the other links) is divided by an upper bound of the link motion speed derived from
+  // the D-H parameters (link lengths and offsets, and the joint deltas), and the segment is advanced by the smallest such
+  // step. Hence a segment far from obstacles is certified with a few forward kinematics evaluations.
+
+  // Set the min. clearance for a segment to be certified collision free (contact within this clearance is reported as a
+  // collision), and the max. no. of advancement steps (a segment that needs more steps is reported as a collision).
+  // Inputs are tolerance in length units (e.g. mm) and max. no. of steps.
+  void set_continuousTolerance(float toleranceInput, int maxStepsInput);
+
+  // Check for self and environment collisions along the straight joint space segment between two configurations.
+  // Inputs are arrays of start and end joint angles in rad, optional hit details and optional variable to store the
+  // motion parameter (0 to 1) of the collision (nullptr if not required).
+  // Output is true if in collision (or not certified), false if the whole segment is collision free.
+  bool checkContinuousCollision(float q0Input[], float q1Input[], DhCollisionHit* hitOutput = nullptr, float* tOutput = nullptr);
+
+  // Check for collisions along a joint trajectory (straight joint space segments between consecutive points).
+  // Inputs are joint trajectory (noOfPoints x no. of links, row-major, rad), no. of points and optional hit details.
+  // Output is index of the first point of the first colliding segment, or -1 if the whole trajectory is collision free.
+  int checkContinuousCollisionPath(float qPathInput[], int noOfPoints, DhCollisionHit* hitOutput = nullptr);
+
+  // Geometry Functions
+
+  // Calculate the square of the minimum distance between two line segments in 3D.
+  // Inputs are segment end points (x, y, z).
+  // Output is distance^2.
+  static float segmentDistanceSquared(const float p0[3], const float p1[3], const float q0[3], const float q1[3]);
+
+  // Check whether two capsules overlap.
+  // Inputs are capsules in the same frame.
+  // Output is true if overlapping.
+  static bool capsulesOverlap(const DhCapsule& capsule1, const DhCapsule& capsule2);
+};
+
+} // namespace mt
+
+#endif // DH_COLLISION_H_
@@ -0,0 +1,55 @@
+// Copyright (C) 2015 - 2020 Joseph Morgridge
+//
+// Licensed under GNU General Public License v3.0 (GPLv3) License.
+// See the LICENSE file in the project root for full license details.
+
+#include "dh_dual.h"
+
+#include "dh_kinematic_chain.h"
+#include "dh_kinematic_link.h"
+
+#if USING_ARDUINO
+#include <Arduino.h>
+#else
+#include <cmath>
+using namespace std;
+#endif
+
+namespace mt {
+
+// The Dual overloads must not hide the plain scalar functions from unqualified calls in namespace mt (the pattern used
+// throughout the library).
+static_assert(sizeof(sin(0.0f) + cos(0.0f) + sqrt(0.0f) + fabs(0.0f) + atan2(0.0f, 1.0f)) > 0,
+              "plain scalar math must resolve in namespace mt with dh_dual.h included");
+
+void fKineWithJointDerivatives(float TmOutput[4][4], float dTmOutput[][4][4], DhKinematicChain& chain, float qInput[]) {
+  const int maxLinks = DhKinematicChain::maxLinks;
+  typedef Dual<maxLinks> DualType;
+
+  int noOfLinks = chain.get_noOfLinks();
+  DhKinematicLink links[maxLinks];
+  chain.get_links(links);
+
+  DualType q[maxLinks], d[maxLinks], a[maxLinks], alpha[maxLinks];
+  for (int i = 0; i < noOfLinks; i++)
+  {
+    q[i] = DualType::variable(qInput[i], i);
+    d[i] = links[i].get_d();
+    a[i] = links[i].get_a();
+    alpha[i] = links[i].get_alpha();
+  }
+
+  DualType Tm[4][4];
+  dhFKine(Tm, noOfLinks, q, d, a, alpha);
+
+  for (int r = 0; r < 4; r++)
+  {
+    for (int c = 0; c < 4; c++)
+    {
+      TmOutput[r][c] = Tm[r][c].value;
+      for (int i = 0; i < noOfLinks; i++) { dTmOutput[i][r][c] = Tm[r][c].tangent[i]; }
+    }
+  }
+}
+
+} // namespace mt
@@ -0,0 +1,194 @@
+// Copyright (C) 2015 - 2020 Joseph Morgridge
+//
+// Licensed under GNU General Public License v3.0 (GPLv3) License.
+// See the LICENSE file in the project root for full license details.
+
+#ifndef DH_DUAL_H_
+#define DH_DUAL_H_
+
+#include "dh_kinematic_link.h"
+#include "dh_kinematic_chain.h"
+
+#if __has_include(<Arduino.h>)
+#include <Arduino.h>
+#define USING_ARDUINO 1
+#else
+#include <cmath>
+#define USING_ARDUINO 0
+#endif
+
+// Forward-mode automatic differentiation.
+// Dual<N, T> is a scalar type that carries a value and its partial derivatives w.r.t. N variables (the tangent vector).
+// Evaluating a function templated on the scalar type (e.g. dhFKine(...)) with Dual inputs yields the exact result and
+// all N partial derivatives together in a single pass, instead of N + 1 passes of finite differences.
+// The tangent width is a compile time constant, hence there is no dynamic memory allocation.
+namespace mt {
+
+// The Dual type and its functions are in a nested namespace, so the elementary function templates (sin, sqrt, etc.) do
+// not hide the plain scalar functions from unqualified calls in namespace mt. They are found by argument dependent lookup.
+namespace dual {
+
+template <int N, typename T = float>
+struct Dual {
+  typedef T value_type;
+
+  T value;      // Function value.
+  T tangent[N]; // Partial derivatives w.r.t. each variable.
+
+  // Constant (all partial derivatives are 0).
+  Dual(T valueInput = T(0)): value(valueInput) {
+    for (int i = 0; i < N; i++) { tangent[i] = T(0); }
+  }
+
+  // Independent variable with index in range 0 to (N - 1) (partial derivative w.r.t. itself is 1).
+  static Dual variable(T valueInput, int index) {
+    Dual x(valueInput);
+    x.tangent[index] = T(1);
+    return x;
+  }
+
+  Dual& operator+=(const Dual& b) { *this = *this + b; return *this; }
+  Dual& operator-=(const Dual& b) { *this = *this - b; return *this; }
+  Dual& operator*=(const Dual& b) { *this = *this * b; return *this; }
+  Dual& operator/=(const Dual& b) { *this = *this / b; return *this; }
+};
+
+// Arithmetic. Mixed operations with a plain scalar treat the scalar as a constant.
+
+template <int N, typename T>
+inline Dual<N, T> operator+(const Dual<N, T>& a, const Dual<N, T>& b) {
+  Dual<N, T> c(a.value + b.value);
+  for (int i = 0; i < N; i++) { c.tangent[i] = a.tangent[i] + b.tangent[i]; }
+  return c;
+}
+
+template <int N, typename T>
+inline Dual<N, T> operator-(const Dual<N, T>& a, const Dual<N, T>& b) {
+  Dual<N, T> c(a.value - b.value);
+  for (int i = 0; i < N; i++) { c.tangent[i] = a.tangent[i] - b.tangent[i]; }
+  return c;
+}
+
+template <int N, typename T>
+inline Dual<N, T> operator-(const Dual<N, T>& a) {
+  Dual<N, T> c(-a.value);
+  for (int i = 0; i < N; i++) { c.tangent[i] = -a.tangent[i]; }
+  return c;
+}
+
+template <int N, typename T>
+inline Dual<N, T> operator*(const Dual<N, T>& a, const Dual<N, T>& b) {
+  Dual<N, T> c(a.value * b.value);
+  for (int i = 0; i < N; i++) { c.tangent[i] = a.tangent[i] * b.value + a.value * b.tangent[i]; }
+  return c;
+}
+
+template <int N, typename T>
+inline Dual<N, T> operator/(const Dual<N, T>& a, const Dual<N, T>& b) {
+  T inverse = T(1) / b.value;
+  Dual<N, T> c(a.value * inverse);
+  for (int i = 0; i < N; i++) { c.tangent[i] = (a.tangent[i] - c.value * b.tangent[i]) * inverse; }
+  return c;
+}
+
+// The scalar parameter is not deduced (Dual<N, T>::value_type), so any arithmetic scalar (e.g. a double literal with
+// Dual<N, float>) converts to T.
+
+template <int N, typename T>
+inline Dual<N, T> operator+(const Dual<N, T>& a, typename Dual<N, T>::value_type b) { return a + Dual<N, T>(b); }
+template <int N, typename T>
+inline Dual<N, T> operator+(typename Dual<N, T>::value_type a, const Dual<N, T>& b) { return Dual<N, T>(a) + b; }
+template <int N, typename T>
+inline Dual<N, T> operator-(const Dual<N, T>& a, typename Dual<N, T>::value_type b) { return a - Dual<N, T>(b); }
+template <int N, typename T>
+inline Dual<N, T> operator-(typename Dual<N, T>::value_type a, const Dual<N, T>& b) { return Dual<N, T>(a) - b; }
+template <int N, typename T>
+inline Dual<N, T> operator/(const Dual<N, T>& a, typename Dual<N, T>::value_type b) { return a / Dual<N, T>(b); }
+template <int N, typename T>
+inline Dual<N, T> operator/(typename Dual<N, T>::value_type a, const Dual<N, T>& b) { return Dual<N, T>(a) / b; }
+
+template <int N, typename T>
+inline Dual<N, T> operator*(const Dual<N, T>& a, typename Dual<N, T>::value_type b) {
+  Dual<N, T> c(a.value * b);
+  for (int i = 0; i < N; i++) { c.tangent[i] = a.tangent[i] * b; }
+  return c;
+}
+
+template <int N, typename T>
+inline Dual<N, T> operator*(typename Dual<N, T>::value_type a, const Dual<N, T>& b) { return b * a; }
+
+// Comparisons (on the value only).
+
+template <int N, typename T> inline bool operator<(const Dual<N, T>& a, const Dual<N, T>& b) { return a.value < b.value; }
+template <int N, typename T> inline bool operator>(const Dual<N, T>& a, const Dual<N, T>& b) { return a.value > b.value; }
+template <int N, typename T>
+inline bool operator<(const Dual<N, T>& a, typename Dual<N, T>::value_type b) { return a.value < b; }
+template <int N, typename T>
+inline bool operator>(const Dual<N, T>& a, typename Dual<N, T>::value_type b) { return a.value > b; }
+template <int N, typename T> inline bool operator==(const Dual<N, T>& a, const Dual<N, T>& b) { return a.value == b.value; }
+
+// Elementary functions (found by argument dependent lookup from generic code).
+
+// Scale the tangent of x by the derivative of a function at x, with value y.
+template <int N, typename T>
+inline Dual<N, T> chainRule(const Dual<N, T>& x, T y, T dydx) {
+  Dual<N, T> c(y);
+  for (int i = 0; i < N; i++) { c.tangent[i] = x.tangent[i] * dydx; }
+  return c;
+}
+
+template <int N, typename T>
+inline void sincos(const Dual<N, T>& x, Dual<N, T>& sinOutput, Dual<N, T>& cosOutput) {
+  T s = ::sin(x.value), c = ::cos(x.value);
+  sinOutput = chainRule(x, s, c);
+  cosOutput = chainRule(x, c, -s);
+}
+
+// Single precision uses the (tiered) library sincos, as the plain float kinematics.
+template <int N>
+inline void sincos(const Dual<N, float>& x, Dual<N, float>& sinOutput, Dual<N, float>& cosOutput) {
+  float s, c;
+  DhMathUtils::sincos(x.value, s, c);
+  sinOutput = chainRule(x, s, c);
+  cosOutput = chainRule(x, c, -s);
+}
+
+template <int N, typename T>
+inline Dual<N, T> sin(const Dual<N, T>& x) { return chainRule(x, T(::sin(x.value)), T(::cos(x.value))); }
+
+template <int N, typename T>
+inline Dual<N, T> cos(const Dual<N, T>& x) { return chainRule(x, T(::cos(x.value)), T(-::sin(x.value))); }
+
+template <int N, typename T>
+inline Dual<N, T> sqrt(const Dual<N, T>& x) {
+  T y = ::sqrt(x.value);
+  return chainRule(x, y, (y > T(0)) ? T(0.5) / y : T(0));
+}
+
+template <int N, typename T>
+inline Dual<N, T> atan2(const Dual<N, T>& y, const Dual<N, T>& x) {
+  T r2 = x.value * x.value + y.value * y.value;
+  Dual<N, T> c(T(::atan2(y.value, x.value)));
+  for (int i = 0; i < N; i++) { c.tangent[i] = (x.value * y.tangent[i] - y.value * x.tangent[i]) / r2; }
+  return c;
+}
+
+template <int N, typename T>
+inline Dual<N, T> fabs(const Dual<N, T>& x) { return (x.value < T(0)) ? -x : x; }
+
+} // namespace dual
+
+using dual::Dual;
+
+// Forward kinematics with derivatives.
+
+// Calculate the forward kinematics and its partial derivatives w.r.t. every joint angle in a single pass.
+// Inputs are 4 x 4 array to store output, array of 4 x 4 arrays to store the derivatives (1 per link),
+// the robots kinematic model and array of joint angles in rad.
+// Derivative array size must match number of links.
+// Outputs are transformation matrix and d(Tm)/d(q_i) (w.r.t. the D-H base frame, as DhKinematicChain::fKine(...)).
+void fKineWithJointDerivatives(float TmOutput[4][4], float dTmOutput[][4][4], DhKinematicChain& chain, float qInput[]);
+
+} // namespace mt
+
+#endif // DH_DUAL_H_
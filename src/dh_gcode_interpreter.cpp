@@ -0,0 +1,504 @@
+// Copyright (C) 2015 - 2020 Joseph Morgridge
+//
+// Licensed under GNU General Public License v3.0 (GPLv3) License.
+// See the LICENSE file in the project root for full license details.
+
+#include "dh_gcode_interpreter.h"
+
+#include "dh_kinematic_chain.h"
+#include "dh_math_utils.h"
+#include "dh_memory_barrier.h"
+
+#if USING_ARDUINO
+#include <Arduino.h>
+#else
+#include <cmath>
+using namespace std;
+#endif
+
+namespace mt {
+
+DhGcodeInterpreter::DhGcodeInterpreter(DhKinematicChain& chainInput, DhInverseKinematicsCallback inverseKinematicsInput,
+                                       int configurationInput):
+chain(chainInput), inverseKinematics(inverseKinematicsInput), configuration(configurationInput) {
+  noOfLinks = chain.get_noOfLinks();
+}
+
+void DhGcodeInterpreter::set_acceleration(float accelerationInput) { acceleration = accelerationInput; }
+
+void DhGcodeInterpreter::set_junctionDeviation(float junctionDeviationInput) { junctionDeviation = junctionDeviationInput; }
+
+void DhGcodeInterpreter::set_arcTolerance(float arcToleranceInput) { arcTolerance = arcToleranceInput; }
+
+void DhGcodeInterpreter::set_rapidFeedRate(float rapidFeedRateInput) { rapidSpeed = rapidFeedRateInput / 60.0; }
+
+void DhGcodeInterpreter::set_ikTolerance(float ikToleranceInput) { ikTolerance = ikToleranceInput; }
+
+void DhGcodeInterpreter::set_samplePeriod(float samplePeriodInput) { samplePeriod = samplePeriodInput; }
+
+void DhGcodeInterpreter::set_position(float poseInput[6]) {
+  for (int k = 0; k < 6; k++)
+  {
+    position[k] = poseInput[k];
+    plannerEnd[k] = poseInput[k];
+    setpointPose[k] = poseInput[k];
+  }
+}
+
+int DhGcodeInterpreter::write(const char* data, int length) {
+  int accepted = 0;
+  for (; accepted < length; accepted++)
+  {
+    char c = data[accepted];
+    if (discardingLine)
+    {
+      if (c == '\n') { discardingLine = false; }
+      continue;
+    }
+    if (inputCount == inputBufferSize) { break; }
+
+    input[inputHead] = c;
+    inputHead = (inputHead + 1) % inputBufferSize;
+    inputCount++;
+    if (c == '\n') { noOfInputLines++; }
+  }
+  return accepted;
+}
+
+int DhGcodeInterpreter::get_inputSpace() { return inputBufferSize - inputCount; }
+
+void DhGcodeInterpreter::skipLine() {
+  while (inputCount > 0)
+  {
+    char c = input[inputTail];
+    inputTail = (inputTail + 1) % inputBufferSize;
+    inputCount--;
+    if (c == '\n')
+    {
+      noOfInputLines--;
+      break;
+    }
+  }
+}
+
+int DhGcodeInterpreter::readWord(char& letterOutput, float& valueOutput) {
+  // Skip white space and comments.
+  bool inComment = false;
+  while (true)
+  {
+    char c = input[inputTail];
+    if (c == '\n') { return 0; } // The end of line is consumed by skipLine().
+    if (c == ';') { return 0; }
+    if (c == '(') { inComment = true; }
+    if (!inComment && c != ' ' && c != '\t' && c != '\r') { break; }
+    if (c == ')') { inComment = false; }
+    inputTail = (inputTail + 1) % inputBufferSize;
+    inputCount--;
+  }
+
+  // Letter.
+  char letter = input[inputTail];
+  if (letter >= 'a' && letter <= 'z') { letter = letter - 'a' + 'A'; }
+  if (letter < 'A' || letter > 'Z') { return -1; }
+  inputTail = (inputTail + 1) % inputBufferSize;
+  inputCount--;
+
+  // Number (optional sign, digits and decimal point), accumulated in place.
+  float value = 0, scale = 1, sign = 1;
+  int noOfDigits = 0;
+  bool fraction = false;
+  char c = input[inputTail];
+  if (c == '-' || c == '+')
+  {
+    sign = (c == '-') ? -1 : 1;
+    inputTail = (inputTail + 1) % inputBufferSize;
+    inputCount--;
+  }
+  while (true)
+  {
+    c = input[inputTail];
+    if (c >= '0' && c <= '9')
+    {
+      if (fraction) { scale *= 0.1; value += (c - '0') * scale; }
+      else { value = value * 10 + (c - '0'); }
+      noOfDigits++;
+    }
+    else if (c == '.' && !fraction)
+    {
+      fraction = true;
+    }
+    else
+    {
+      break;
+    }
+    inputTail = (inputTail + 1) % inputBufferSize;
+    inputCount--;
+  }
+  if (noOfDigits == 0) { return -1; }
+
+  letterOutput = letter;
+  valueOutput = sign * value;
+  return 1;
+}
+
+void DhGcodeInterpreter::parseLine() {
+  lineNumber++;
+
+  float words[6]; // X, Y, Z, A, B, C.
+  bool hasWord[6] = {false, false, false, false, false, false};
+  float ij[2] = {0, 0};
+  bool hasIj = false;
+  int newMotionMode = motionMode;
+  int lineError = kDhGcodeOk;
+
+  char letter;
+  float value;
+  int result;
+  while ((result = readWord(letter, value)) == 1)
+  {
+    switch (letter)
+    {
+      case 'G':
+      {
+        int code = (int)value;
+        if (code != value) { lineError = kDhGcodeErrorUnsupported; break; }
+        switch (code)
+        {
+          case 0: case 1: case 2: case 3: { newMotionMode = code; break; }
+          case 17: { break; } // XY plane (the only plane supported).
+          case 20: { unitScale = 25.4; break; }
+          case 21: { unitScale = 1; break; }
+          case 90: { relative = false; break; }
+          case 91: { relative = true; break; }
+          default: { lineError = kDhGcodeErrorUnsupported; break; }
+        }
+        break;
+      }
+      case 'X': { words[0] = value; hasWord[0] = true; break; }
+      case 'Y': { words[1] = value; hasWord[1] = true; break; }
+      case 'Z': { words[2] = value; hasWord[2] = true; break; }
+      case 'A': { words[3] = value; hasWord[3] = true; break; }
+      case 'B': { words[4] = value; hasWord[4] = true; break; }
+      case 'C': { words[5] = value; hasWord[5] = true; break; }
+      case 'I': { ij[0] = value; hasIj = true; break; }
+      case 'J': { ij[1] = value; hasIj = true; break; }
+      case 'F': { feedSpeed = value / 60.0; break; } // Scaled by the units below.
+      case 'N': case 'M': case 'S': case 'T': { break; } // Line numbers, and machine/spindle/tool words (not applicable).
+      default: { lineError = kDhGcodeErrorUnsupported; break; }
+    }
+  }
+  if (result < 0) { lineError = kDhGcodeErrorSyntax; }
+  skipLine();
+
+  motionMode = newMotionMode;
+  if (lineError != kDhGcodeOk)
+  {
+    error = lineError;
+    errorLine = lineNumber;
+    return;
+  }
+
+  // Resolve the target pose after all words are read, since the modal words (G20/G21, G90/G91) apply to the whole line.
+  float target[6];
+  bool hasAxisWord = false;
+  for (int k = 0; k < 6; k++)
+  {
+    target[k] = position[k];
+    if (!hasWord[k]) { continue; }
+    float scaledValue = (k < 3) ? words[k] * unitScale : words[k]; // (mm) or (deg).
+    target[k] = relative ? position[k] + scaledValue : scaledValue;
+    hasAxisWord = true;
+  }
+  ij[0] *= unitScale;
+  ij[1] *= unitScale;
+
+  if (hasAxisWord && !queueMove(target, ij, hasIj))
+  {
+    error = kDhGcodeErrorUnsupported;
+    errorLine = lineNumber;
+  }
+}
+
+bool DhGcodeInterpreter::queueMove(float target[6], float ijOffset[2], bool hasIj) {
+  float nominalSpeed = (motionMode == 0) ? rapidSpeed : feedSpeed * unitScale; // (mm/s).
+
+  if (motionMode == 0 || motionMode == 1)
+  {
+    planSegment(target, nominalSpeed);
+  }
+  else
+  {
+    if (!hasIj) { return false; } // Radius (R) format arcs are not supported.
+
+    float cx = position[0] + ijOffset[0];
+    float cy = position[1] + ijOffset[1];
+    float radius = sqrt(ijOffset[0] * ijOffset[0] + ijOffset[1] * ijOffset[1]);
+    float endRadius = sqrt((target[0] - cx) * (target[0] - cx) + (target[1] - cy) * (target[1] - cy));
+    if (radius <= 0 || fabs(endRadius - radius) > 0.05 + 0.002 * radius) { return false; } // End point not on the arc.
+
+    float startAngle = atan2(position[1] - cy, position[0] - cx);
+    float sweep = atan2(target[1] - cy, target[0] - cx) - startAngle;
+    const float twoPi = 2.0 * DhMathUtils::pi;
+    if (motionMode == 2 && sweep >= 0) { sweep -= twoPi; } // Clockwise (a full circle if the end point is the start point).
+    if (motionMode == 3 && sweep <= 0) { sweep += twoPi; } // Counter-clockwise.
+
+    // Segment angle for the chord tolerance.
+    float maxSegmentAngle = (arcTolerance < radius) ? 2 * acos(1 - arcTolerance / radius) : DhMathUtils::pi / 2;
+    int noOfSegments = (int)ceil(fabs(sweep) / maxSegmentAngle);
+    if (noOfSegments < 1) { noOfSegments = 1; }
+
+    arcCentre[0] = cx;
+    arcCentre[1] = cy;
+    arcRadius = radius;
+    arcAngle = startAngle;
+    arcAngleStep = sweep / noOfSegments;
+    for (int k = 0; k < 4; k++) { arcStep[k] = (target[2 + k] - position[2 + k]) / noOfSegments; }
+    for (int k = 0; k < 6; k++) { arcEnd[k] = target[k]; }
+    arcSpeed = nominalSpeed;
+    arcSegmentsRemaining = noOfSegments;
+    emitArcSegments();
+  }
+
+  for (int k = 0; k < 6; k++) { position[k] = target[k]; }
+  return true;
+}
+
+void DhGcodeInterpreter::emitArcSegments() {
+  while (arcSegmentsRemaining > 0 && plannerCount < plannerSize)
+  {
+    float target[6];
+    if (arcSegmentsRemaining == 1)
+    {
+      for (int k = 0; k < 6; k++) { target[k] = arcEnd[k]; } // Exact end point.
+    }
+    else
+    {
+      arcAngle += arcAngleStep;
+      float sinAngle, cosAngle;
+      DhMathUtils::sincos(arcAngle, sinAngle, cosAngle);
+      target[0] = arcCentre[0] + arcRadius * cosAngle;
+      target[1] = arcCentre[1] + arcRadius * sinAngle;
+      for (int k = 0; k < 4; k++) { target[2 + k] = plannerEnd[2 + k] + arcStep[k]; }
+    }
+    planSegment(target, arcSpeed);
+    arcSegmentsRemaining--;
+  }
+}
+
+void DhGcodeInterpreter::planSegment(float target[6], float nominalSpeed) {
+  float delta[6];
+  float lengthSquared = 0;
+  for (int k = 0; k < 6; k++)
+  {
+    delta[k] = target[k] - plannerEnd[k];
+    lengthSquared += delta[k] * delta[k];
+  }
+  float length = sqrt(lengthSquared);
+  if (length < 1e-6) { return; } // Zero length move.
+
+  DhGcodeBlock& block = blocks[plannerHead];
+  for (int k = 0; k < 6; k++)
+  {
+    block.start[k] = plannerEnd[k];
+    block.unitVector[k] = delta[k] / length;
+    plannerEnd[k] = target[k];
+  }
+  block.length = length;
+  block.nominalSpeed = nominalSpeed;
+
+  // Junction speed limit: the max. speed at which the path could follow a circle of radius r tangent to both segments,
+  // with the circle deviating by the junction deviation from the corner, under the path acceleration:
+  // v^2 = a * r, r = junctionDeviation * sin(theta/2) / (1 - sin(theta/2)).
+  block.maxEntrySpeedSq = 0; // Start from rest.
+  if (plannerCount > 0)
+  {
+    DhGcodeBlock& previous = blocks[(plannerHead + plannerSize - 1) % plannerSize];
+    float cosTheta = 0; // Cosine of the angle between the reversed previous direction and the new direction.
+    for (int k = 0; k < 6; k++) { cosTheta -= previous.unitVector[k] * block.unitVector[k]; }
+
+    float maxSpeedSq = (nominalSpeed < previous.nominalSpeed) ? nominalSpeed * nominalSpeed : previous.nominalSpeed * previous.nominalSpeed;
+    if (cosTheta < -0.999999)
+    {
+      block.maxEntrySpeedSq = maxSpeedSq; // Straight line.
+    }
+    else if (cosTheta < 0.999999)
+    {
+      float sinHalfTheta = sqrt(0.5 * (1.0 - cosTheta));
+      float junctionSpeedSq = acceleration * junctionDeviation * sinHalfTheta / (1.0 - sinHalfTheta);
+      block.maxEntrySpeedSq = (junctionSpeedSq < maxSpeedSq) ? junctionSpeedSq : maxSpeedSq;
+    }
+  }
+  block.entrySpeedSq = block.maxEntrySpeedSq;
+
+  plannerHead = (plannerHead + 1) % plannerSize;
+  plannerCount++;
+  recalculatePlan();
+}
+
+void DhGcodeInterpreter::recalculatePlan() {
+  // The executing block (at the tail) is not replanned; the generator tracks its exit speed each sample.
+  // Backward pass: every block must be able to decelerate to the next entry speed (0 after the last block).
+  float nextEntrySpeedSq = 0;
+  for (int k = plannerCount - 1; k >= 1; k--)
+  {
+    DhGcodeBlock& block = blocks[(plannerTail + k) % plannerSize];
+    float reachable = nextEntrySpeedSq + 2 * acceleration * block.length;
+    block.entrySpeedSq = (block.maxEntrySpeedSq < reachable) ? block.maxEntrySpeedSq : reachable;
+    nextEntrySpeedSq = block.entrySpeedSq;
+  }
+
+  // Forward pass: every block must be reachable by accelerating from the current state of the executing block.
+  float exitSpeedSqMax = speed * speed + 2 * acceleration * (blocks[plannerTail].length - blockDistance);
+  for (int k = 1; k < plannerCount; k++)
+  {
+    DhGcodeBlock& block = blocks[(plannerTail + k) % plannerSize];
+    if (block.entrySpeedSq > exitSpeedSqMax) { block.entrySpeedSq = exitSpeedSqMax; }
+    exitSpeedSqMax = block.entrySpeedSq + 2 * acceleration * block.length;
+  }
+}
+
+bool DhGcodeInterpreter::generateSetpoint() {
+  if (plannerCount == 0) { return false; }
+
+  // Speed for this sample: accelerate towards the nominal speed, limited so the block exit speed can still be reached.
+  DhGcodeBlock* block = &blocks[plannerTail];
+  float exitSpeedSq = (plannerCount > 1) ? blocks[(plannerTail + 1) % plannerSize].entrySpeedSq : 0;
+  float remaining = block->length - blockDistance;
+  float newSpeed = speed + acceleration * samplePeriod;
+  if (newSpeed > block->nominalSpeed) { newSpeed = block->nominalSpeed; }
+  // Braking limit after this sample, v1^2 = exit^2 + 2a (remaining - (v + v1) dt / 2), solved for v1.
+  float adt = acceleration * samplePeriod;
+  float discriminant = adt * adt - 4 * (adt * speed - exitSpeedSq - 2 * acceleration * remaining);
+  float brakingSpeed = (discriminant > 0) ? 0.5 * (sqrt(discriminant) - adt) : 0;
+  if (newSpeed > brakingSpeed) { newSpeed = (brakingSpeed > 0) ? brakingSpeed : 0; }
+
+  float step = 0.5 * (speed + newSpeed) * samplePeriod;
+  if (exitSpeedSq == 0 && remaining < 0.5 * acceleration * samplePeriod * samplePeriod) { step = remaining; } // Stop.
+  speed = newSpeed;
+  blockDistance += step;
+
+  // Move on to the following block(s), carrying over the distance beyond the end of the block.
+  float pose[6];
+  while (blockDistance >= block->length)
+  {
+    blockDistance -= block->length;
+    for (int k = 0; k < 6; k++) { pose[k] = block->start[k] + block->unitVector[k] * block->length; }
+    plannerTail = (plannerTail + 1) % plannerSize;
+    plannerCount--;
+    if (plannerCount == 0)
+    {
+      blockDistance = 0;
+      speed = 0;
+      block = nullptr;
+      break;
+    }
+    block = &blocks[plannerTail];
+  }
+  if (block != nullptr)
+  {
+    for (int k = 0; k < 6; k++) { pose[k] = block->start[k] + block->unitVector[k] * blockDistance; }
+  }
+
+  // Inverse kinematics of the sample. Check that the joint angles were updated and reach the sample (the snapshot count
+  // changes on every forward kinematics update, and the snapshot pose is the forward kinematics of the new joint angles;
+  // a failed IK leaves the joint angles unchanged while the current transformation matrix already holds the target).
+  float qBefore[maxLinks], q[maxLinks], Tm[4][4];
+  uint32_t countBefore = chain.get_snapshot(qBefore, Tm);
+  chain.set_TmCurrentOrientation(DhMathUtils::deg2rad(pose[3]), DhMathUtils::deg2rad(pose[4]), DhMathUtils::deg2rad(pose[5]), 1);
+  chain.set_TmCurrentPosition(pose[0], pose[1], pose[2]);
+  inverseKinematics(chain, configuration);
+
+  uint32_t countAfter = chain.get_snapshot(q, Tm);
+  float dx = Tm[0][3] - pose[0], dy = Tm[1][3] - pose[1], dz = Tm[2][3] - pose[2];
+  if (countAfter == countBefore || !(dx * dx + dy * dy + dz * dz <= ikTolerance * ikTolerance))
+  {
+    // Withhold the setpoint and halt, so execution stops at the last valid setpoint instead of holding stale joints.
+    chain.set_qCurrent(qBefore); // The chain holds the pose of the latest generated setpoint again.
+    error = kDhGcodeErrorIk;
+    errorLine = lineNumber;
+    halted = true;
+    return false;
+  }
+
+  for (int k = 0; k < 6; k++) { setpointPose[k] = pose[k]; }
+  // The slot was released by the execution side (tail) before it is written, and the setpoint is written before it is
+  // published (head). The barriers keep the plain setpoint accesses between the index accesses (ISRs, multi-core boards).
+  int head = setpointHead;
+  dhMemoryBarrier();
+  for (int i = 0; i < noOfLinks; i++) { setpoints[head][i] = q[i]; }
+  dhMemoryBarrier();
+  setpointHead = (head + 1) % setpointBufferSize; // Publish after the setpoint is written.
+  return true;
+}
+
+void DhGcodeInterpreter::service() {
+  if (inputCount == inputBufferSize && noOfInputLines == 0)
+  {
+    // Line too long for the input buffer; drop it.
+    inputHead = inputTail = inputCount = 0;
+    discardingLine = true;
+    lineNumber++;
+    error = kDhGcodeErrorLineTooLong;
+    errorLine = lineNumber;
+  }
+
+  while (!halted && (setpointHead + 1) % setpointBufferSize != setpointTail)
+  {
+    // Parsing and planning stages; keep the look-ahead planner full.
+    while (plannerCount < plannerSize)
+    {
+      if (arcSegmentsRemaining > 0) { emitArcSegments(); }
+      else if (noOfInputLines > 0) { parseLine(); }
+      else { break; }
+    }
+
+    // Setpoint generation and IK stage.
+    if (!generateSetpoint()) { break; }
+  }
+}
+
+bool DhGcodeInterpreter::popSetpoint(float qOutput[]) {
+  int tail = setpointTail;
+  if (tail == setpointHead) { return false; }
+  dhMemoryBarrier(); // Read the setpoint after its publication is seen.
+  for (int i = 0; i < noOfLinks; i++)
+  {
+    qOutput[i] = setpoints[tail][i]; // (rad).
+  }
+  dhMemoryBarrier();
+  setpointTail = (tail + 1) % setpointBufferSize; // Release the slot after the setpoint is read.
+  return true;
+}
+
+int DhGcodeInterpreter::get_noOfSetpoints() {
+  return (setpointHead - setpointTail + setpointBufferSize) % setpointBufferSize;
+}
+
+bool DhGcodeInterpreter::isIdle() { return noOfInputLines == 0 && arcSegmentsRemaining == 0 && plannerCount == 0; }
+
+bool DhGcodeInterpreter::isHalted() { return halted; }
+
+void DhGcodeInterpreter::resume() {
+  inputHead = inputTail = inputCount = 0;
+  noOfInputLines = 0;
+  discardingLine = false;
+  arcSegmentsRemaining = 0;
+  plannerHead = plannerTail = plannerCount = 0;
+  blockDistance = 0;
+  speed = 0;
+  for (int k = 0; k < 6; k++)
+  {
+    position[k] = setpointPose[k];
+    plannerEnd[k] = setpointPose[k];
+  }
+  halted = false;
+}
+
+int DhGcodeInterpreter::get_error(int& lineNumberOutput) {
+  int lastError = error;
+  lineNumberOutput = errorLine;
+  error = kDhGcodeOk;
+  return lastError;
+}
+
+} // namespace mt
@@ -0,0 +1,237 @@
+// Copyright (C) 2015 - 2020 Joseph Morgridge
+//
+// Licensed under GNU General Public License v3.0 (GPLv3) License.
+// See the LICENSE file in the project root for full license details.
+
+#ifndef DH_GCODE_INTERPRETER_H_
+#define DH_GCODE_INTERPRETER_H_
+
+#include "dh_kinematic_chain.h"
+
+#if __has_include(<Arduino.h>)
+#include <Arduino.h>
+#define USING_ARDUINO 1
+#else
+#include <atomic>
+#include <cstdint>
+#define USING_ARDUINO 0
+#endif
+
+// Buffer sizes of the G-code interpreter. They can be changed for the whole library by defining them in the build flags
+// e.g. -DDH_GCODE_PLANNER_SIZE=32 (smaller buffers reduce RAM usage on small boards, larger buffers increase look-ahead).
+#ifndef DH_GCODE_INPUT_BUFFER_SIZE
+#define DH_GCODE_INPUT_BUFFER_SIZE 128 // Input characters.
+#endif
+#ifndef DH_GCODE_PLANNER_SIZE
+#define DH_GCODE_PLANNER_SIZE 8 // Linear segments (blocks) in the look-ahead planner.
+#endif
+#ifndef DH_GCODE_SETPOINT_BUFFER_SIZE
+#define DH_GCODE_SETPOINT_BUFFER_SIZE 8 // Joint setpoints (max. 255).
+#endif
+
+namespace mt {
+
+// Interpreter error codes.
+constexpr int kDhGcodeOk = 0;
+constexpr int kDhGcodeErrorSyntax = 1;      // Malformed word.
+constexpr int kDhGcodeErrorUnsupported = 2; // Unsupported G/M code, word or arc.
+constexpr int kDhGcodeErrorLineTooLong = 3; // Line longer than the input buffer.
+constexpr int kDhGcodeErrorIk = 4;          // Inverse kinematics did not produce valid joint angles.
+
+// Linear segment (block) in the look-ahead planner. Poses are (x, y, z) in mm and (a, b, c) in deg.
+struct DhGcodeBlock {
+  float start[6];
+  float unitVector[6];   // Unit direction of the segment in pose space.
+  float length;          // Segment length in pose space (mm or deg).
+  float nominalSpeed;    // Programmed speed (mm/s or deg/s).
+  float maxEntrySpeedSq; // Max. entry speed^2 from the junction with the previous segment.
+  float entrySpeedSq;    // Planned entry speed^2.
+};
+
+// Class to encapsulate a streaming G-code interpreter which feeds the kinematics pipeline.
+// Supported subset: G0/G1 (linear), G2/G3 (circular arcs in the XY plane with I, J centre offsets), G20/G21 (inch/mm),
+// G90/G91 (absolute/relative), F (feed rate per minute), X/Y/Z (mm) and A/B/C (deg; rotations about the x, y and z axes
+// applied in the order X, Y, Z, as set_TmCurrentOrientation(...) order 1). Comments in () or after ; are ignored.
+// The interpreter is a pipeline of fixed size buffers, so there is no dynamic memory allocation:
+//   input ring buffer -> tokenizer -> look-ahead planner -> setpoint generator + IK -> setpoint buffer -> execution.
+// Lines are tokenized in place from the input ring buffer. Arcs are split into linear segments within a chord tolerance.
+// The planner blends consecutive segments (junction deviation speed limits with forward/backward acceleration passes),
+// and the setpoint generator samples the planned trajectory at a fixed period and solves the IK of each sample.
+// service() runs the parsing, planning and IK stages ahead of execution, which only pops the ready joint setpoints
+// (e.g. from a timer interrupt or a control thread). service() and popSetpoint(...) may be called from different
+// contexts (single producer, single consumer); all other methods must be called from the service() context.
+// NOTE: The kinematic model (chain) holds the pose of the latest generated setpoint, not of the executing setpoint.
+// The junction speed limits follow the Grbl "junction deviation" cornering algorithm (Jeon, S.K. 2011).
+class DhGcodeInterpreter {
+
+ public:
+
+  // General Constants
+  static const int maxLinks = DhKinematicChain::maxLinks;
+  static const int inputBufferSize = DH_GCODE_INPUT_BUFFER_SIZE;
+  static const int plannerSize = DH_GCODE_PLANNER_SIZE;
+  static const int setpointBufferSize = DH_GCODE_SETPOINT_BUFFER_SIZE;
+
+ private:
+
+  // General Parameters
+  DhKinematicChain& chain;
+  DhInverseKinematicsCallback inverseKinematics;
+  int configuration;
+  int noOfLinks = 0;
+
+  // Motion Parameters
+  float acceleration = 500;       // (mm/s^2 or deg/s^2).
+  float junctionDeviation = 0.05; // (mm).
+  float arcTolerance = 0.01;      // Max. chord error (mm).
+  float rapidSpeed = 100;         // G0 speed (mm/s or deg/s).
+  float samplePeriod = 0.01;      // Setpoint period (s).
+  float ikTolerance = 0.1;        // Max. position error of the IK solution (mm).
+
+  // Input Ring Buffer
+  char input[inputBufferSize];
+  int inputHead = 0, inputTail = 0, inputCount = 0;
+  int noOfInputLines = 0; // Complete lines in the input buffer.
+  bool discardingLine = false; // Dropping the rest of a line that was too long.
+
+  // Modal State
+  int motionMode = 0; // 0, 1, 2 or 3 (G0 to G3).
+  bool relative = false; // G91.
+  float unitScale = 1; // G20 (25.4) or G21 (1).
+  float feedSpeed = 10; // (mm/s).
+  float position[6] = {0, 0, 0, 0, 0, 0}; // Programmed end pose of the last parsed move.
+  int lineNumber = 0; // Lines parsed.
+  int error = kDhGcodeOk; // Last error.
+  int errorLine = 0; // Line of the last error.
+  bool halted = false; // Stopped by an IK failure until resume().
+
+  // Pending Arc (split into segments as planner space becomes available)
+  int arcSegmentsRemaining = 0;
+  float arcCentre[2];
+  float arcRadius, arcAngle, arcAngleStep;
+  float arcStep[4]; // Z, A, B, C increment per segment.
+  float arcEnd[6];
+  float arcSpeed;
+
+  // Look-Ahead Planner (blocks[plannerTail] is executing)
+  DhGcodeBlock blocks[plannerSize];
+  int plannerHead = 0, plannerTail = 0, plannerCount = 0;
+  float plannerEnd[6] = {0, 0, 0, 0, 0, 0}; // End pose of the last planned block.
+
+  // Setpoint Generator (on blocks[plannerTail])
+  float blockDistance = 0; // Distance travelled along the executing block.
+  float speed = 0;         // Current speed.
+  float setpointPose[6] = {0, 0, 0, 0, 0, 0}; // Pose of the latest generated setpoint.
+
+  // Setpoint Buffer
+  float setpoints[setpointBufferSize][maxLinks];
+#if USING_ARDUINO
+  volatile uint8_t setpointHead = 0, setpointTail = 0; // Single byte indexes are atomic on AVR (ordered by dhMemoryBarrier()).
+#else
+  std::atomic<int> setpointHead{0}, setpointTail{0};
+#endif
+
+  // Tokenize and execute the next line in the input buffer.
+  void parseLine();
+
+  // Read the next word (letter and number) of the current line from the input buffer.
+  // Output is 1 if a word was read, 0 at the end of the line, -1 on a syntax error (the rest of the line is skipped).
+  int readWord(char& letterOutput, float& valueOutput);
+
+  // Consume input up to and including the end of the current line.
+  void skipLine();
+
+  // Queue a move to the specified pose, splitting arcs as required. Output is true on success.
+  bool queueMove(float target[6], float ijOffset[2], bool hasIj);
+
+  // Add a linear segment to the planner. The planner must not be full.
+  void planSegment(float target[6], float nominalSpeed);
+
+  // Recalculate the planned entry speeds (backward and forward passes).
+  void recalculatePlan();
+
+  // Emit pending arc segments while there is space in the planner.
+  void emitArcSegments();
+
+  // Generate the next joint setpoint. Output is true if a setpoint was generated.
+  bool generateSetpoint();
+
+ public:
+
+  // Constructors
+
+  DhGcodeInterpreter(DhKinematicChain& chainInput, DhInverseKinematicsCallback inverseKinematicsInput, int configurationInput);
+
+  // Configuration Methods
+
+  // Set the path acceleration.
+  // Input is acceleration in mm/s^2 (or deg/s^2 for orientation only moves).
+  void set_acceleration(float accelerationInput);
+
+  // Set the junction deviation (cornering tolerance); larger values allow faster cornering.
+  // Input is junction deviation in mm.
+  void set_junctionDeviation(float junctionDeviationInput);
+
+  // Set the arc chord tolerance.
+  // Input is max. chord error in mm.
+  void set_arcTolerance(float arcToleranceInput);
+
+  // Set the G0 (rapid) speed.
+  // Input is speed in mm/min.
+  void set_rapidFeedRate(float rapidFeedRateInput);
+
+  // Set the max. position error of the IK solution before kDhGcodeErrorIk is reported (and the interpreter halts).
+  // Input is tolerance in mm.
+  void set_ikTolerance(float ikToleranceInput);
+
+  // Set the setpoint sample period.
+  // Input is period in s.
+  void set_samplePeriod(float samplePeriodInput);
+
+  // Set the current pose (e.g. at start up). The planner must be idle.
+  // Input is pose (x, y, z in mm and a, b, c in deg).
+  void set_position(float poseInput[6]);
+
+  // Pipeline Methods
+
+  // Write G-code characters to the input buffer.
+  // Inputs are characters and no. of characters.
+  // Output is no. of characters accepted (less than the number given if the input buffer is full).
+  int write(const char* data, int length);
+
+  // Get free space in the input buffer.
+  // Output is no. of characters.
+  int get_inputSpace();
+
+  // Run the parsing, planning and IK stages until the setpoint buffer is full or no more input is available.
+  // Call continuously (e.g. from loop()).
+  void service();
+
+  // Pop the next joint setpoint (execution side). Setpoints are spaced by the sample period.
+  // Input is array to store output.
+  // Array size must match number of links.
+  // Output is joint angles in rad. Returns true if a setpoint was available.
+  bool popSetpoint(float qOutput[]);
+
+  // Get no. of joint setpoints ready for execution.
+  int get_noOfSetpoints();
+
+  // Get whether all input has been executed up to the setpoint buffer (no input lines, arcs or planned blocks remain).
+  bool isIdle();
+
+  // Get whether the interpreter halted because the IK of a setpoint failed (kDhGcodeErrorIk). The failed setpoint and
+  // everything after it are withheld, so execution stops at the last valid setpoint; service() does nothing until resume().
+  bool isHalted();
+
+  // Discard all buffered input, arcs and planned blocks and resume from the pose of the last valid setpoint (e.g. after
+  // a halt). Setpoints already in the setpoint buffer are kept.
+  void resume();
+
+  // Get the last error code (kDhGcodeOk if none) and clear it.
+  // Input is variable to store the line number (1 based) of the error.
+  int get_error(int& lineNumberOutput);
+};
+
+} // namespace mt
+
+#endif // DH_GCODE_INTERPRETER_H_
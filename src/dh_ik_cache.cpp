@@ -0,0 +1,153 @@
+// Copyright (C) 2015 - 2020 Joseph Morgridge
+//
+// Licensed under GNU General Public License v3.0 (GPLv3) License.
+// See the LICENSE file in the project root for full license details.
+
+#include "dh_ik_cache.h"
+
+#include "dh_kinematic_chain.h"
+#include "dh_math_utils.h"
+
+#if USING_ARDUINO
+#include <Arduino.h>
+#else
+#include <cmath>
+using namespace std;
+#endif
+
+namespace mt {
+
+namespace {
+
+// FNV-1a hash of the key.
+uint32_t hashKey(int32_t key[8]) {
+  uint32_t hash = 2166136261u;
+  for (int k = 0; k < 8; k++)
+  {
+    uint32_t value = (uint32_t)key[k];
+    for (int b = 0; b < 4; b++)
+    {
+      hash ^= (value >> (8 * b)) & 0xFF;
+      hash *= 16777619u;
+    }
+  }
+  return hash;
+}
+
+int32_t quantize(float value, float step) { return (int32_t)floor(value / step + 0.5); }
+
+} // namespace
+
+DhIkCache::DhIkCache(DhInverseKinematicsCallback inverseKinematicsInput, DhIkCacheEntry entriesInput[], int capacityInput):
+inverseKinematics(inverseKinematicsInput), entries(entriesInput), capacity(capacityInput) {
+  clear();
+}
+
+void DhIkCache::set_tolerance(float positionToleranceInput, float orientationToleranceInput) {
+  positionTolerance = positionToleranceInput;
+  orientationTolerance = orientationToleranceInput;
+  clear();
+}
+
+void DhIkCache::set_ikTolerance(float ikToleranceInput) { ikTolerance = ikToleranceInput; }
+
+void DhIkCache::clear() {
+  for (int i = 0; i < capacity; i++)
+  {
+    entries[i].valid = 0;
+    entries[i].referenced = 0;
+  }
+}
+
+uint32_t DhIkCache::get_noOfHits() { return noOfHits; }
+
+uint32_t DhIkCache::get_noOfMisses() { return noOfMisses; }
+
+void DhIkCache::makeKey(float Tm[4][4], int configuration, int32_t keyOutput[8]) {
+  for (int r = 0; r < 3; r++) { keyOutput[r] = quantize(Tm[r][3], positionTolerance); }
+
+  float quat[4];
+  DhMathUtils::tr2quat(Tm, quat); // w >= 0, so that the key is unique.
+
+  // A rotation of angle theta changes the quaternion components by about theta / 2.
+  float step = 0.5 * orientationTolerance;
+  for (int k = 0; k < 4; k++) { keyOutput[3 + k] = quantize(quat[k], step); }
+  keyOutput[7] = configuration;
+}
+
+bool DhIkCache::solve(DhKinematicChain& robot, int configuration) {
+  // Invalidate all entries if the base or tool transformation matrix has changed.
+  if (!hasRevision || robot.get_transformRevision() != transformRevision)
+  {
+    clear();
+    transformRevision = robot.get_transformRevision();
+    hasRevision = true;
+  }
+
+  float TmTarget[4][4];
+  robot.get_TmCurrent(TmTarget);
+  int32_t key[8];
+  makeKey(TmTarget, configuration, key);
+
+  // Look up the whole probe window (entries can be removed, so an empty slot does not end the probe sequence).
+  int start = hashKey(key) % (uint32_t)capacity;
+  int noOfProbes = (maxProbes < capacity) ? maxProbes : capacity;
+  int emptySlot = -1;
+  for (int p = 0; p < noOfProbes; p++)
+  {
+    DhIkCacheEntry& entry = entries[(start + p) % capacity];
+    if (!entry.valid)
+    {
+      if (emptySlot < 0) { emptySlot = (start + p) % capacity; }
+      continue;
+    }
+
+    bool match = true;
+    for (int k = 0; k < 8; k++) { match &= (entry.key[k] == key[k]); }
+    if (!match) { continue; }
+
+    if (robot.set_qCurrent(entry.q))
+    {
+      entry.referenced = 1;
+      noOfHits++;
+      return true;
+    }
+    entry.valid = 0; // No longer within the joint limits.
+    if (emptySlot < 0) { emptySlot = (start + p) % capacity; }
+    break;
+  }
+  noOfMisses++;
+
+  // Solve, and check that the joint angles were updated and reach the target (the snapshot count changes on every
+  // forward kinematics update, and the snapshot pose is the forward kinematics of the new joint angles).
+  float q[maxLinks], Tm[4][4];
+  uint32_t countBefore = robot.get_snapshot(q, Tm);
+  inverseKinematics(robot, configuration);
+  uint32_t countAfter = robot.get_snapshot(q, Tm);
+  if (countAfter == countBefore) { return false; }
+  float dx = Tm[0][3] - TmTarget[0][3], dy = Tm[1][3] - TmTarget[1][3], dz = Tm[2][3] - TmTarget[2][3];
+  if (!(dx * dx + dy * dy + dz * dz <= ikTolerance * ikTolerance)) { return false; }
+
+  // Insert into an empty slot, or evict within the probe window (clock algorithm: referenced entries get a second chance).
+  // The first lap clears the referenced bits, so the second lap over the same window always finds a victim. Both laps
+  // must stay within the probe window, as lookups only probe the window of the key.
+  int slot = emptySlot;
+  for (int lap = 0; slot < 0 && lap < 2; lap++)
+  {
+    for (int p = 0; slot < 0 && p < noOfProbes; p++)
+    {
+      int index = (start + p) % capacity;
+      if (entries[index].referenced && lap == 0) { entries[index].referenced = 0; }
+      else { slot = index; }
+    }
+  }
+
+  DhIkCacheEntry& entry = entries[slot];
+  for (int k = 0; k < 8; k++) { entry.key[k] = key[k]; }
+  for (int i = 0; i < robot.get_noOfLinks(); i++) { entry.q[i] = q[i]; }
+  entry.valid = 1;
+  entry.referenced = 0;
+  return true;
+}
+
+} // namespace mt
@@ -0,0 +1,99 @@
+// Copyright (C) 2015 - 2020 Joseph Morgridge
+//
+// Licensed under GNU General Public License v3.0 (GPLv3) License.
+// See the LICENSE file in the project root for full license details.
+
+#ifndef DH_IK_CACHE_H_
+#define DH_IK_CACHE_H_
+
+#include "dh_kinematic_chain.h"
+
+#if __has_include(<Arduino.h>)
+#include <Arduino.h>
+#define USING_ARDUINO 1
+#else
+#include <cstdint>
+#define USING_ARDUINO 0
+#endif
+
+namespace mt {
+
+// IK cache entry. Entries are allocated by the caller, so the cache performs no dynamic memory allocation.
+struct DhIkCacheEntry {
+  int32_t key[8]; // Quantized position (x, y, z), orientation quaternion (w, x, y, z) and configuration number.
+  float q[DhKinematicChain::maxLinks]; // Cached joint angles in rad.
+  uint8_t valid = 0;
+  uint8_t referenced = 0; // Clock (second chance) eviction bit.
+};
+
+// Class to encapsulate a memoization layer in front of a robot specific inverse kinematics solution.
+// Targets are keyed by their position and orientation (quaternion) quantized to a configurable tolerance, and the
+// configuration number. Hence, a cached solution is returned for any target in the same quantization cell, i.e. within
+// about the tolerance of the target it was solved for; use a tolerance finer than the required accuracy.
+// The cache is a fixed capacity open-addressed hash table with bounded linear probing and clock (second chance) eviction
+// within the probe window. It is cleared automatically when the base or tool transformation matrix of the chain changes
+// (e.g. setToolTransformPosition(...) or setZoffset(...)).
+class DhIkCache {
+
+ public:
+
+  // General Constants
+  static const int maxLinks = DhKinematicChain::maxLinks;
+  static const int maxProbes = 8; // Probe window length.
+
+ private:
+
+  // General Parameters
+  DhInverseKinematicsCallback inverseKinematics;
+  DhIkCacheEntry* entries;
+  int capacity;
+
+  // Cache Parameters
+  float positionTolerance = 0.01;   // Position quantization step (mm).
+  float orientationTolerance = 1e-4; // Orientation quantization step (rad).
+  float ikTolerance = 0.1; // Max. position error of an IK solution to be cached (mm).
+  uint32_t transformRevision = 0; // Chain base/tool revision the entries were solved for.
+  bool hasRevision = false;
+  uint32_t noOfHits = 0;
+  uint32_t noOfMisses = 0;
+
+  // Quantize the target transformation matrix and configuration number.
+  void makeKey(float Tm[4][4], int configuration, int32_t keyOutput[8]);
+
+ public:
+
+  // Constructors
+
+  DhIkCache(DhInverseKinematicsCallback inverseKinematicsInput, DhIkCacheEntry entriesInput[], int capacityInput);
+
+  // Configuration Methods
+
+  // Set the quantization tolerances. The cache is cleared.
+  // Inputs are position tolerance in mm and orientation tolerance in rad.
+  void set_tolerance(float positionToleranceInput, float orientationToleranceInput);
+
+  // Set the max. position error of an IK solution for it to be cached (solutions that miss the target are not cached).
+  // Input is tolerance in mm.
+  void set_ikTolerance(float ikToleranceInput);
+
+  // Remove all cached solutions.
+  void clear();
+
+  // Cache Methods
+
+  // Solve the inverse kinematics (same usage as the IK callback), from the cache if possible.
+  // Inputs are the robots kinematic model (DhKinematicChain object), with the desired transformation matrix applied
+  // (position and orientation), and the configuration number.
+  // Output is the joint angles, stored in the input robot object. Returns true if the solution reaches the target.
+  bool solve(DhKinematicChain& robot, int configuration);
+
+  // Get no. of cache hits.
+  uint32_t get_noOfHits();
+
+  // Get no. of cache misses.
+  uint32_t get_noOfMisses();
+};
+
+} // namespace mt
+
+#endif // DH_IK_CACHE_H_
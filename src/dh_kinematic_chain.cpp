@@ -6,24 +6,35 @@
 #include "dh_kinematic_chain.h"
 
 #include "dh_kinematic_link.h"
+#include "dh_mat.h"
 #include "dh_math_utils.h"
+#include "dh_memory_barrier.h"
 #include "MatrixMath.h"
 
 #if USING_ARDUINO
 #include <Arduino.h>
 #else
+#include <cmath>
 #include <iostream>
 using namespace std;
 #endif
 
 namespace mt {
 
+namespace {
+
+// View a (decayed) 4 x 4 array parameter as a 4 x 4 array for the fixed size matrix kernels.
+inline float (&asTm(float (*Tm)[4]))[4][4] { return *reinterpret_cast<float (*)[4][4]>(Tm); }
+
+} // namespace
+
 DhKinematicChain::DhKinematicChain(int noOflinksInput, DhKinematicLink linksInput[]) {	
 	noOfLinks = noOflinksInput;
 	for (int i = 0; i < noOfLinks; i++)
 	{
 		links[i] = linksInput[i];
 	}
+	clear_jointLimits();
 }
 
 #if USING_ARDUINO
@@ -91,18 +102,24 @@ void DhKinematicChain::get_links(DhKinematicLink linksOutput[]) {
 	}
 }
 
-void DhKinematicChain::set_qCurrent(float qCurrentInput[]) {
+bool DhKinematicChain::set_qCurrent(float qCurrentInput[]) {
+	if (!withinPositionLimits(qCurrentInput)) { return false; }
+
 	for (int i = 0; i < noOfLinks; i++)
 	{
 		qCurrent[i] = qCurrentInput[i]; // (rad).
 	}
 
 	fKineWithBaseAndTool(); // Calculate/update TmCurrent.
+	return true;
 }
 
-void DhKinematicChain::set_qCurrentValue(int index, float qValue) {
+bool DhKinematicChain::set_qCurrentValue(int index, float qValue) {
+	if (!(qValue >= qMin[index] && qValue <= qMax[index])) { return false; }
+
 	qCurrent[index] = qValue; // (rad).
 	fKineWithBaseAndTool(); // Calculate/update TmCurrent.
+	return true;
 }
 
 void DhKinematicChain::get_qCurrent(float qCurrentOutput[]) {
@@ -120,6 +137,37 @@ void DhKinematicChain::get_TmCurrent(float TmCurrentOutput[4][4]) {
 	MatrixObj.Copy((float*)TmCurrent, 4, 4, (float*)TmCurrentOutput);
 }
 
+void DhKinematicChain::publishSnapshot() {
+	int slot = snapshotPublished ^ 1;
+	DhSnapshotSequence sequence = snapshotSequence[slot];
+
+	snapshotSequence[slot] = sequence + 1; // Odd; slot being written.
+	dhMemoryBarrier();
+	for (int i = 0; i < noOfLinks; i++) { snapshotQ[slot][i] = qCurrent[i]; }
+	matCopy(TmCurrent, snapshotTm[slot]);
+	snapshotCount[slot] = ++noOfSnapshots;
+	dhMemoryBarrier();
+	snapshotSequence[slot] = sequence + 2; // Even; slot consistent.
+	snapshotPublished = slot;
+}
+
+uint32_t DhKinematicChain::get_snapshot(float qOutput[], float TmOutput[4][4]) {
+	while (true)
+	{
+		int slot = snapshotPublished;
+		DhSnapshotSequence sequenceStart = snapshotSequence[slot];
+		dhMemoryBarrier();
+		if (sequenceStart & 1) { continue; } // Being written (the writer has lapped the reader).
+
+		for (int i = 0; i < noOfLinks; i++) { qOutput[i] = snapshotQ[slot][i]; } // (rad).
+		matCopy(snapshotTm[slot], asTm(TmOutput));
+		uint32_t count = snapshotCount[slot];
+
+		dhMemoryBarrier();
+		if (snapshotSequence[slot] == sequenceStart) { return count; }
+	}
+}
+
 void DhKinematicChain::set_TmCurrentPosition(float pxInput, float pyInput, float pzInput) {
 	TmCurrent[i1][i4] = pxInput;
 	TmCurrent[i2][i4] = pyInput;
@@ -127,6 +175,10 @@ void DhKinematicChain::set_TmCurrentPosition(float pxInput, float pyInput, float
 	TmCurrent[i4][i4] = 1.0;
 }
 
+void DhKinematicChain::set_TmCurrent(float TmCurrentInput[4][4]) {
+	matCopy(asTm(TmCurrentInput), TmCurrent);
+}
+
 void DhKinematicChain::get_TmCurrentPosition(float TmCurrentPosOutput[3]) {
 	TmCurrentPosOutput[i1] = TmCurrent[i1][i4];
 	TmCurrentPosOutput[i2] = TmCurrent[i2][i4];
@@ -162,48 +214,412 @@ void DhKinematicChain::set_TmCurrentOrientation(float thetaX, float thetaY, floa
 	TmCurrent[i4][i4] = p4;
 }
 
+bool DhKinematicChain::get_TmCurrentOrientation(float& thetaXOutput, float& thetaYOutput, float& thetaZOutput, int order) {
+	switch (order)
+	{
+		case 1: // X,Y,Z
+		{
+			return DhMathUtils::tr2xyz(TmCurrent, thetaXOutput, thetaYOutput, thetaZOutput);
+		}
+
+		case 2: // Z,Y,X
+		{
+			return DhMathUtils::tr2zyx(TmCurrent, thetaZOutput, thetaYOutput, thetaXOutput);
+		}
+	}
+	return false;
+}
+
 void DhKinematicChain::multiply_TmCurrentByTm(float TmInput[4][4]) {
 	float TmTemp[4][4];
 
 	// Multiply robot T (TmCurrent) by TmInput and store result temporarily (TmTemp),
 	// and copy result from temporary location (TmTemp) to robot T (TmCurrent).
-	MatrixObj.Multiply((float*)TmCurrent, (float*)TmInput, 4, 4, 4, (float*)TmTemp);
-	MatrixObj.Copy((float*)TmTemp, 4, 4, (float*)TmCurrent);
+	matMultiply(TmCurrent, asTm(TmInput), TmTemp);
+	matCopy(TmTemp, TmCurrent);
 }
 
-void DhKinematicChain::fKine(float TmOutput[4][4], float qInput[]) {
-	float Tm[4][4] = { {1, 0, 0, 0},
-										 {0, 1, 0, 0},
-										 {0, 0, 1, 0},
-										 {0, 0, 0, 1} };
+void DhKinematicChain::fKineFromTm(float TmStart[4][4], float TmOutput[4][4], float qInput[], float TmFramesOutput[][4][4]) {
 	float TmLink[4][4];
-	float TmTemp[4][4];
+	float TmBuffers[2][4][4];
+	float (*Tm)[4] = TmStart; // Cumulated Tm.
 
 	for (int i = 0; i < noOfLinks; i++)
 	{
 		// Get transformation matrix Tm of current link (TmLink),
-		// Multiply cumulated Tm by Tm of current link (TmLink) and store result temporarily (TmTemp),
-		// and copy result from temporary location (TmTemp) to cumulated Tm.
+		// and multiply cumulated Tm by Tm of current link (TmLink) directly into the next buffer (or the frame output if required).
+		// The buffers are alternated rather than copied after each link.
+		float (&TmNext)[4][4] = (TmFramesOutput != nullptr) ? TmFramesOutput[i] : TmBuffers[i % 2];
 		links[i].get_Tm(TmLink, qInput[i]);
-		MatrixObj.Multiply((float*)Tm, (float*)TmLink, 4, 4, 4, (float*)TmTemp);
-		MatrixObj.Copy((float*)TmTemp, 4, 4, (float*)Tm);
+		matMultiply(asTm(Tm), TmLink, TmNext);
+		Tm = TmNext;
 	}
 
-	MatrixObj.Copy((float*)Tm, 4, 4, (float*)TmOutput); // Return the final result.
+	matCopy(asTm(Tm), asTm(TmOutput)); // Return the final result.
+}
+
+void DhKinematicChain::fKine(float TmOutput[4][4], float qInput[]) {
+	float TmIdentity[4][4] = { {1, 0, 0, 0},
+														 {0, 1, 0, 0},
+														 {0, 0, 1, 0},
+														 {0, 0, 0, 1} };
+	fKineFromTm(TmIdentity, TmOutput, qInput, nullptr);
+}
+
+void DhKinematicChain::fKineFrames(float TmFramesOutput[][4][4], float qInput[]) {
+	float Tm[4][4];
+	fKineFromTm(TmBase, Tm, qInput, TmFramesOutput);
 }
 
 void DhKinematicChain::fKineWithBaseAndTool() {
-	fKine(TmCurrent, qCurrent);
 	float TmTemp[4][4];
-	// Multiply robot T (TmCurrent) by tool T (TmTool) and store result temporarily (TmTemp),
-	// and copy result from temporary location (TmTemp) to robot T (TmCurrent).
-	MatrixObj.Multiply((float*)TmCurrent, (float*)TmTool, 4, 4, 4, (float*)TmTemp);
-	MatrixObj.Copy((float*)TmTemp, 4, 4, (float*)TmCurrent);
+	// Calculate robot T starting from the base T (TmBase) and store result temporarily (TmTemp),
+	// and multiply by tool T (TmTool) to obtain robot T (TmCurrent).
+	fKineFromTm(TmBase, TmTemp, qCurrent, nullptr);
+	matMultiply(TmTemp, TmTool, TmCurrent);
+	publishSnapshot();
+}
+
+void DhKinematicChain::fKineBatch(float TmOutput[][4][4], float qPathInput[], int noOfPoints) {
+	float TmTemp[4][4];
+	for (int k = 0; k < noOfPoints; k++)
+	{
+		fKineFromTm(TmBase, TmTemp, &qPathInput[k * noOfLinks], nullptr);
+		matMultiply(TmTemp, TmTool, TmOutput[k]);
+	}
+}
+
+void DhKinematicChain::fKineBatch(float TmOutput[][4][4], float qPathInput[], int noOfPoints, float TmBasesInput[][4][4],
+                                  float TmToolsInput[][4][4]) {
+	float TmTemp[4][4];
+	for (int k = 0; k < noOfPoints; k++)
+	{
+		fKineFromTm(TmBasesInput[k], TmTemp, &qPathInput[k * noOfLinks], nullptr);
+		matMultiply(TmTemp, TmToolsInput[k], TmOutput[k]);
+	}
+}
+
+void DhKinematicChain::jacobian(float JOutput[6][maxLinks], float qInput[], DhSingularityMetrics* metricsOutput) {
+	float TmFrames[maxLinks][4][4];
+	fKineFrames(TmFrames, qInput);
+	jacobianFromFrames(JOutput, TmFrames);
+
+	if (metricsOutput != nullptr) { singularityMetrics(*metricsOutput, JOutput); }
+}
+
+void DhKinematicChain::jacobianFromFrames(float JOutput[6][maxLinks], float TmFramesInput[][4][4]) {
+	// Tool-tip position (last frame multiplied by the tool transformation matrix).
+	float pe[3];
+	for (int r = 0; r < 3; r++)
+	{
+		pe[r] = TmFramesInput[noOfLinks - 1][r][i1] * TmTool[i1][i4] + TmFramesInput[noOfLinks - 1][r][i2] * TmTool[i2][i4] +
+						TmFramesInput[noOfLinks - 1][r][i3] * TmTool[i3][i4] + TmFramesInput[noOfLinks - 1][r][i4];
+	}
+
+	for (int i = 0; i < maxLinks; i++)
+	{
+		if (i >= noOfLinks)
+		{
+			for (int r = 0; r < 6; r++) { JOutput[r][i] = 0; }
+			continue;
+		}
+
+		// Joint i rotates about the z-axis of the previous frame (the base frame for the first joint).
+		float (*TmPrevious)[4] = (i == 0) ? TmBase : TmFramesInput[i - 1];
+		float z[3] = {TmPrevious[i1][i3], TmPrevious[i2][i3], TmPrevious[i3][i3]};
+		float dp[3] = {pe[i1] - TmPrevious[i1][i4], pe[i2] - TmPrevious[i2][i4], pe[i3] - TmPrevious[i3][i4]};
+
+		// Linear velocity part is z x (pe - p), angular velocity part is z.
+		JOutput[0][i] = z[i2] * dp[i3] - z[i3] * dp[i2];
+		JOutput[1][i] = z[i3] * dp[i1] - z[i1] * dp[i3];
+		JOutput[2][i] = z[i1] * dp[i2] - z[i2] * dp[i1];
+		JOutput[3][i] = z[i1];
+		JOutput[4][i] = z[i2];
+		JOutput[5][i] = z[i3];
+	}
+}
+
+void DhKinematicChain::singularityMetrics(DhSingularityMetrics& metricsOutput, float JInput[6][maxLinks]) {
+	// Gram matrix of the smaller dimension; its eigenvalues are the squared singular values.
+	const int n = 6;
+	int noOfSingularValues = (noOfLinks < n) ? noOfLinks : n;
+	float G[n][n];
+	for (int r = 0; r < n; r++)
+	{
+		for (int c = 0; c <= r; c++)
+		{
+			float value = 0;
+			if (noOfLinks >= n)
+			{
+				for (int k = 0; k < noOfLinks; k++) { value += JInput[r][k] * JInput[c][k]; } // J J^T.
+			}
+			else if (r < noOfLinks)
+			{
+				for (int k = 0; k < n; k++) { value += JInput[k][r] * JInput[k][c]; } // J^T J.
+			}
+			G[r][c] = value;
+			G[c][r] = value;
+		}
+	}
+
+	float eigenvalues[n];
+	symmetricEigenvalues(G, eigenvalues);
+
+	float manipulability = 1;
+	for (int i = 0; i < noOfSingularValues; i++)
+	{
+		float sigma = (eigenvalues[i] > 0) ? sqrt(eigenvalues[i]) : 0;
+		manipulability *= sigma;
+		eigenvalues[i] = sigma;
+	}
+	float sigmaMin = eigenvalues[noOfSingularValues - 1];
+
+	metricsOutput.manipulability = manipulability;
+	metricsOutput.minSingularValue = sigmaMin;
+	metricsOutput.conditionNumber = (sigmaMin > 0) ? eigenvalues[0] / sigmaMin : INFINITY;
+}
+
+int DhKinematicChain::singularityMetricsBatch(DhSingularityMetrics metricsOutput[], float qPathInput[], int noOfPoints, float minSingularValueThreshold) {
+	int firstSingularIndex = -1;
+	float J[6][maxLinks];
+	for (int p = 0; p < noOfPoints; p++)
+	{
+		jacobian(J, &qPathInput[p * noOfLinks], &metricsOutput[p]);
+		if (firstSingularIndex < 0 && metricsOutput[p].minSingularValue < minSingularValueThreshold) { firstSingularIndex = p; }
+	}
+	return firstSingularIndex;
+}
+
+void DhKinematicChain::set_jointLimits(int index, float qMinInput, float qMaxInput, float qdMaxInput, float qddMaxInput) {
+	qMin[index] = qMinInput; // (rad).
+	qMax[index] = qMaxInput; // (rad).
+	qdMax[index] = qdMaxInput; // (rad/s).
+	qddMax[index] = qddMaxInput; // (rad/s^2).
+}
+
+void DhKinematicChain::set_positionLimits(float qMinInput[], float qMaxInput[]) {
+	for (int i = 0; i < noOfLinks; i++)
+	{
+		qMin[i] = qMinInput[i]; // (rad).
+		qMax[i] = qMaxInput[i]; // (rad).
+	}
+}
+
+void DhKinematicChain::set_velocityLimits(float qdMaxInput[]) {
+	for (int i = 0; i < noOfLinks; i++)
+	{
+		qdMax[i] = qdMaxInput[i]; // (rad/s).
+	}
+}
+
+void DhKinematicChain::set_accelerationLimits(float qddMaxInput[]) {
+	for (int i = 0; i < noOfLinks; i++)
+	{
+		qddMax[i] = qddMaxInput[i]; // (rad/s^2).
+	}
+}
+
+void DhKinematicChain::clear_jointLimits() {
+	for (int i = 0; i < maxLinks; i++)
+	{
+		qMin[i] = -INFINITY;
+		qMax[i] = INFINITY;
+		qdMax[i] = INFINITY;
+		qddMax[i] = INFINITY;
+	}
+}
+
+void DhKinematicChain::get_positionLimits(float qMinOutput[], float qMaxOutput[]) {
+	for (int i = 0; i < noOfLinks; i++)
+	{
+		qMinOutput[i] = qMin[i]; // (rad).
+		qMaxOutput[i] = qMax[i]; // (rad).
+	}
+}
+
+void DhKinematicChain::get_velocityLimits(float qdMaxOutput[]) {
+	for (int i = 0; i < noOfLinks; i++)
+	{
+		qdMaxOutput[i] = qdMax[i]; // (rad/s).
+	}
+}
+
+void DhKinematicChain::get_accelerationLimits(float qddMaxOutput[]) {
+	for (int i = 0; i < noOfLinks; i++)
+	{
+		qddMaxOutput[i] = qddMax[i]; // (rad/s^2).
+	}
+}
+
+bool DhKinematicChain::withinPositionLimits(float qInput[]) {
+	bool within = true;
+	for (int i = 0; i < noOfLinks; i++)
+	{
+		within &= (qInput[i] >= qMin[i]) & (qInput[i] <= qMax[i]); // Also false for NaN.
+	}
+	return within;
+}
+
+bool DhKinematicChain::normalizeJointAngles(float qInputOutput[]) {
+	const float twoPi = 2.0 * DhMathUtils::pi;
+	bool within = true;
+	for (int i = 0; i < noOfLinks; i++)
+	{
+		// Equivalent angle nearest the current joint angle, then step towards the limits if required.
+		float q = qInputOutput[i] + twoPi * round((qCurrent[i] - qInputOutput[i]) / twoPi);
+		if (q > qMax[i]) { q -= twoPi; }
+		if (q < qMin[i]) { q += twoPi; }
+
+		if (q >= qMin[i] && q <= qMax[i])
+		{
+			qInputOutput[i] = q; // (rad).
+		}
+		else
+		{
+			qInputOutput[i] = DhMathUtils::wrapToPi(qInputOutput[i]); // (rad).
+			within = false;
+		}
+	}
+	return within;
+}
+
+int DhKinematicChain::validateTrajectory(float qPathInput[], int noOfPoints, float dt, int firstViolationOutput[]) {
+	// The trajectory is scanned in blocks. Within a block, per joint min/max (and max |difference|) values are reduced
+	// without branches; only a block containing a violation is rescanned to locate the first violating point.
+	const int blockSize = 16;
+	bool checkDerivatives = dt > 0;
+	float dqMax[maxLinks], ddqMax[maxLinks];
+	for (int j = 0; j < noOfLinks; j++)
+	{
+		firstViolationOutput[j] = -1;
+		dqMax[j] = qdMax[j] * dt; // Max. change between consecutive points (rad).
+		ddqMax[j] = qddMax[j] * dt * dt; // Max. second difference (rad).
+	}
+
+	int noOfPendingJoints = noOfLinks;
+	for (int start = 0; start < noOfPoints && noOfPendingJoints > 0; start += blockSize)
+	{
+		int end = (start + blockSize < noOfPoints) ? start + blockSize : noOfPoints;
+
+		float blockMin[maxLinks], blockMax[maxLinks], blockDq[maxLinks], blockDdq[maxLinks];
+		for (int j = 0; j < noOfLinks; j++)
+		{
+			blockMin[j] = INFINITY;
+			blockMax[j] = -INFINITY;
+			blockDq[j] = 0;
+			blockDdq[j] = 0;
+		}
+
+		for (int p = start; p < end; p++)
+		{
+			float* q = &qPathInput[p * noOfLinks];
+			for (int j = 0; j < noOfLinks; j++)
+			{
+				blockMin[j] = (q[j] < blockMin[j]) ? q[j] : blockMin[j];
+				blockMax[j] = (q[j] > blockMax[j]) ? q[j] : blockMax[j];
+			}
+			if (checkDerivatives && p > 0)
+			{
+				float* qPrevious = q - noOfLinks;
+				for (int j = 0; j < noOfLinks; j++)
+				{
+					float dq = fabs(q[j] - qPrevious[j]);
+					blockDq[j] = (dq > blockDq[j]) ? dq : blockDq[j];
+				}
+			}
+			if (checkDerivatives && p > 0 && p < noOfPoints - 1)
+			{
+				float* qPrevious = q - noOfLinks;
+				float* qNext = q + noOfLinks;
+				for (int j = 0; j < noOfLinks; j++)
+				{
+					float ddq = fabs(qNext[j] - 2 * q[j] + qPrevious[j]);
+					blockDdq[j] = (ddq > blockDdq[j]) ? ddq : blockDdq[j];
+				}
+			}
+		}
+
+		for (int j = 0; j < noOfLinks; j++)
+		{
+			if (firstViolationOutput[j] >= 0) { continue; }
+			bool violated = !(blockMin[j] >= qMin[j] && blockMax[j] <= qMax[j]);
+			violated |= checkDerivatives && (blockDq[j] > dqMax[j] || blockDdq[j] > ddqMax[j]);
+			if (!violated) { continue; }
+
+			// Locate the first violating point in the block.
+			for (int p = start; p < end; p++)
+			{
+				float q = qPathInput[p * noOfLinks + j];
+				bool pointViolated = !(q >= qMin[j] && q <= qMax[j]);
+				if (checkDerivatives && p > 0)
+				{
+					float qPrevious = qPathInput[(p - 1) * noOfLinks + j];
+					pointViolated |= fabs(q - qPrevious) > dqMax[j];
+					if (p < noOfPoints - 1)
+					{
+						float qNext = qPathInput[(p + 1) * noOfLinks + j];
+						pointViolated |= fabs(qNext - 2 * q + qPrevious) > ddqMax[j];
+					}
+				}
+				if (pointViolated)
+				{
+					firstViolationOutput[j] = p;
+					noOfPendingJoints--;
+					break;
+				}
+			}
+		}
+	}
+
+	int firstViolation = -1;
+	for (int j = 0; j < noOfLinks; j++)
+	{
+		if (firstViolationOutput[j] >= 0 && (firstViolation < 0 || firstViolationOutput[j] < firstViolation))
+		{
+			firstViolation = firstViolationOutput[j];
+		}
+	}
+	return firstViolation;
+}
+
+void DhKinematicChain::updateTmBaseInverse() {
+	MatrixObj.Copy((float*)TmBase, 4, 4, (float*)TmBaseInv);
+	MatrixObj.Invert((float*)TmBaseInv, 4);
+	transformRevision++;
+}
+
+void DhKinematicChain::setBaseTransform(float TmBaseInput[4][4]) {
+	MatrixObj.Copy((float*)TmBaseInput, 4, 4, (float*)TmBase);
+	updateTmBaseInverse();
+	fKineWithBaseAndTool();
+}
+
+void DhKinematicChain::setBaseTransformToIdentity() {
+	for (int i = 0; i < 4; i++)
+	{
+		for (int j = 0; j < 4; j++)
+		{
+			TmBase[i][j] = (i == j) ? 1.0 : 0.0;
+		}
+	}
+	updateTmBaseInverse();
+	fKineWithBaseAndTool();
+}
+
+uint32_t DhKinematicChain::get_transformRevision() { return transformRevision; }
+
+void DhKinematicChain::get_TmBase(float TmBaseOutput[4][4]) {
+	MatrixObj.Copy((float*)TmBase, 4, 4, (float*)TmBaseOutput);
+}
+
+void DhKinematicChain::get_TmBaseInverse(float TmBaseInverseOutput[4][4]) {
+	MatrixObj.Copy((float*)TmBaseInv, 4, 4, (float*)TmBaseInverseOutput);
 }
 
 void DhKinematicChain::updateTmToolInverse() {
 	MatrixObj.Copy((float*)TmTool, 4, 4, (float*)TmToolInv);
 	MatrixObj.Invert((float*)TmToolInv, 4);
+	transformRevision++;
 }
 
 void DhKinematicChain::get_TmTool(float TmToolOutput[4][4]) {
@@ -12,17 +12,39 @@
 #include <Arduino.h>
 #define USING_ARDUINO 1
 #else
+#include <cstdint>
 #define USING_ARDUINO 0
 #endif
 
 namespace mt {
 
+// Sequence counter of the published pose snapshots.
+#if defined(__AVR__)
+typedef uint8_t DhSnapshotSequence; // Single byte accesses are atomic on AVR.
+#else
+typedef uint32_t DhSnapshotSequence;
+#endif
+
+// Singularity proximity metrics of a Jacobian, from its singular values (sigma).
+// The linear velocity rows are in length units per rad and the angular velocity rows in rad per rad, so the metrics
+// depend on the length units used for the D-H parameters.
+struct DhSingularityMetrics {
+  float manipulability;   // Yoshikawa index; product of the singular values (sqrt(det(J J^T)) for chains with 6 or more links).
+  float conditionNumber;  // sigma max / sigma min; infinite at a singularity.
+  float minSingularValue; // sigma min; 0 at a singularity.
+};
+
 // Class to encapsulate the robot serial link parameters and methods.
 class DhKinematicChain {
+ public:
+
+  // General Constants
+  static const int maxLinks = 7; // Maximum number of links in the chain/series.
+
+ private:
 
   // General Parameters
   static const int i1 = 0, i2 = 1, i3 = 2, i4 = 3; // Convenience array access indexes.
-  static const int maxLinks = 7;
 
   // Link Chain/Series Parameters
   int noOfLinks = 0;
@@ -33,6 +55,28 @@ class DhKinematicChain {
   float qCurrent[maxLinks]; // Current absolute angular positions of the joints (i.e. w.r.t D-H 0-position NOT home position or start position).
   float TmCurrent[4][4];    // Current transformation matrix (with/without tool).
 
+  // Pose Snapshot Parameters
+  // Double-buffered seqlock: the writer fills the slot that is not published, so a reader copying the published slot is
+  // only disturbed (and retries) if the writer publishes twice during the copy. Sequences are odd while a slot is written.
+  float snapshotQ[2][maxLinks];
+  float snapshotTm[2][4][4];
+  uint32_t snapshotCount[2] = {0, 0}; // No. of poses published when the slot was written.
+  volatile DhSnapshotSequence snapshotSequence[2] = {0, 0};
+  volatile uint8_t snapshotPublished = 0; // Slot index of the latest snapshot.
+  uint32_t noOfSnapshots = 0;
+
+  // Revision of the base and tool transformation matrices (incremented on every change), e.g. to invalidate cached IK solutions.
+  uint32_t transformRevision = 0;
+
+  // Publish qCurrent and TmCurrent as the latest pose snapshot (single writer).
+  void publishSnapshot();
+
+  // Joint Limit Parameters (unlimited by default)
+  float qMin[maxLinks];   // Joint position lower limits (rad).
+  float qMax[maxLinks];   // Joint position upper limits (rad).
+  float qdMax[maxLinks];  // Joint velocity limits (rad/s).
+  float qddMax[maxLinks]; // Joint acceleration limits (rad/s^2).
+
   // Tool Parameters
   float zOffset = 0;
   float TmTool[4][4] = { {1, 0, 0, 0          },
@@ -44,6 +88,22 @@ class DhKinematicChain {
                             {0, 0, 1, 0},
                             {0, 0, 0, 1} }; // Tool transformation matrix inverse; for use in inverse kinematics calculations.
 
+  // Base Parameters
+  float TmBase[4][4] = { {1, 0, 0, 0},
+                         {0, 1, 0, 0},
+                         {0, 0, 1, 0},
+                         {0, 0, 0, 1} }; // Base transformation matrix (pose of the D-H base frame w.r.t. the world frame).
+  float TmBaseInv[4][4] = { {1, 0, 0, 0},
+                            {0, 1, 0, 0},
+                            {0, 0, 1, 0},
+                            {0, 0, 0, 1} }; // Base transformation matrix inverse; for use in inverse kinematics calculations.
+
+  // Calculate the forward kinematics starting from the specified transformation matrix.
+  // The start transformation matrix is folded into the first link i.e. no separate multiplication by the identity matrix.
+  // Inputs are start transformation matrix, 4 x 4 array to store output, array of joint angles in rad, and
+  // optional array of 4 x 4 arrays (1 per link) to store the intermediate frames (nullptr if not required).
+  void fKineFromTm(float TmStart[4][4], float TmOutput[4][4], float qInput[], float TmFramesOutput[][4][4]);
+
  public:
 
   // Constructors
@@ -78,12 +138,14 @@ class DhKinematicChain {
   // Set current joint angles.
   // Input is array of angles in rad.
   // Array size must match number of links.
-  void set_qCurrent(float qCurrentInput[]);
+  // Output is true on success, false if any angle is outside the joint position limits (the joint angles are then unchanged).
+  bool set_qCurrent(float qCurrentInput[]);
 
   // Set a single joint angle.
   // Input is joint index and angle in rad.
   // Index must be in range 0 to (no. of links - 1).
-  void set_qCurrentValue(int index, float qValue);
+  // Output is true on success, false if the angle is outside the joint position limits (the joint angle is then unchanged).
+  bool set_qCurrentValue(int index, float qValue);
 
   // Get current joint angles.
   // Input is array to store output. 
@@ -102,6 +164,22 @@ class DhKinematicChain {
   // Output is transformation matrix.
   void get_TmCurrent(float TmCurrentOutput[4][4]);
 
+  // Set current transformation matrix, e.g. the target of an inverse kinematics solution.
+  // Input is transformation matrix in a 4 x 4 array.
+  // The pose of the end-effector (or tool-tip if a tool is applied) is changed!. USE WITH CAUTION.
+  void set_TmCurrent(float TmCurrentInput[4][4]);
+
+  // Get a consistent snapshot of the current joint angles and transformation matrix (with base and tool).
+  // A snapshot is published every time the forward kinematics of the current joint angles are updated (e.g. by
+  // set_qCurrent(...)), so the pose can be read from another thread, core or the main loop while a single writer
+  // (e.g. a control ISR) updates the joint angles. The reader never disables interrupts or takes a lock, and the
+  // writer never blocks; the reader retries only if the writer publishes twice during the copy.
+  // Inputs are array and 4 x 4 array to store output.
+  // Array size must match number of links.
+  // Outputs are angles in rad and transformation matrix. Returns the no. of poses published so far (e.g. to detect new
+  // poses), or 0 if no pose has been published yet (the outputs are then undefined).
+  uint32_t get_snapshot(float qOutput[], float TmOutput[4][4]);
+
   // Set position vector in current transformation matrix.
   // Inputs is position (x, y, z).
   // The position of the end-effector (or tool-tip if a tool is applied) is changed!. USE WITH CAUTION.
@@ -129,18 +207,161 @@ class DhKinematicChain {
   // base (0, 0, 0) and oriented as per the base frame in the D-H coordinate system.
   void set_TmCurrentOrientation(float thetaX, float thetaY, float thetaZ, int order);
 
+  // Get orientation (rotation matrix) in current transformation matrix as successive rotations; the inverse of
+  // set_TmCurrentOrientation(...). See DhMathUtils::tr2xyz(...) and DhMathUtils::tr2zyx(...).
+  // Inputs are variables to store output and order option (as set_TmCurrentOrientation(...)).
+  // Outputs are angles in rad. Returns true if in gimbal lock.
+  bool get_TmCurrentOrientation(float& thetaXOutput, float& thetaYOutput, float& thetaZOutput, int order);
+
   // Multiply current transformation matrix by specified transformation matrix.
   // Input is transformation matrix in a 4 x 4 array.
   void multiply_TmCurrentByTm(float TmInput[4][4]);
 
   // Calculate the forward kinematics (transformation matrix) given the joint angles.
   // Inputs are 4 x 4 array to store output and array of joint angles in rad. 
-  // Output is transformation matrix.
+  // Output is transformation matrix (w.r.t. the D-H base frame i.e. the base and tool transformation matrices are NOT applied).
   void fKine(float TmOutput[4][4], float qInput[]);
 
-  // Update the forward kinematics (transformation matrix) to include the tool transformation matrix.
+  // Calculate the forward kinematics of every link frame (transformation matrices) given the joint angles, in a single pass.
+  // Inputs are array of 4 x 4 arrays to store output and array of joint angles in rad.
+  // Output array size must match number of links.
+  // Output is the transformation matrix of each link frame w.r.t. the world frame (i.e. including the base transformation
+  // matrix but NOT the tool transformation matrix). The last frame is the end-effector frame without the tool.
+  // Useful for visualisation and collision checking.
+  void fKineFrames(float TmFramesOutput[][4][4], float qInput[]);
+
+  // Update the forward kinematics (transformation matrix) to include the base and tool transformation matrices.
   void fKineWithBaseAndTool();
 
+  // Calculate the forward kinematics over a joint trajectory, e.g. for requests batched from several clients.
+  // Inputs are array of 4 x 4 arrays to store output (1 per point), joint trajectory (noOfPoints x no. of links,
+  // row-major, rad) and no. of points.
+  // Output is the transformation matrix of the end-effector (or tool-tip if a tool is applied) at each point w.r.t. the
+  // world frame i.e. the base and tool transformation matrices are applied. The current joint angles are unchanged.
+  void fKineBatch(float TmOutput[][4][4], float qPathInput[], int noOfPoints);
+
+  // Calculate the forward kinematics of several robots with the same links as this chain (but their own base and tool),
+  // e.g. a batch kernel for a cell of identical robots.
+  // Inputs are array of 4 x 4 arrays to store output, joint angles (noOfPoints x no. of links, row-major, rad), no. of
+  // points (robots), and arrays of 4 x 4 base and tool transformation matrices (1 per point).
+  // Output is the transformation matrix of each tool-tip w.r.t. the world frame. The current joint angles are unchanged.
+  void fKineBatch(float TmOutput[][4][4], float qPathInput[], int noOfPoints, float TmBasesInput[][4][4], float TmToolsInput[][4][4]);
+
+  // Calculate the geometric Jacobian of the end-effector (or tool-tip if a tool is applied) given the joint angles.
+  // Inputs are 6 x maxLinks array to store output and array of joint angles in rad.
+  // Output is Jacobian w.r.t. the world frame. Rows are linear velocity (x, y, z) then angular velocity (x, y, z).
+  // Column i relates to joint i; columns beyond the number of links are set to 0.
+  // Optionally, the singularity metrics of the Jacobian are computed in the same pass (nullptr if not required).
+  void jacobian(float JOutput[6][maxLinks], float qInput[], DhSingularityMetrics* metricsOutput = nullptr);
+
+  // Calculate the geometric Jacobian from the link frames, e.g. to reuse the frames of a forward kinematics evaluation.
+  // Inputs are 6 x maxLinks array to store output and link frames (fKineFrames(...) output).
+  // Output is Jacobian. See jacobian(...).
+  void jacobianFromFrames(float JOutput[6][maxLinks], float TmFramesInput[][4][4]);
+
+  // Calculate the singularity metrics of a Jacobian.
+  // Inputs are metrics object to store output and Jacobian (e.g. from jacobian(...)).
+  // The singular values are computed from J J^T (or J^T J for chains with fewer than 6 links) by Jacobi rotation.
+  void singularityMetrics(DhSingularityMetrics& metricsOutput, float JInput[6][maxLinks]);
+
+  // Calculate the singularity metrics over a joint trajectory in a single sweep, e.g. to find singular stretches of a program.
+  // Inputs are array to store output (1 per point), joint trajectory (noOfPoints x no. of links, row-major, rad),
+  // no. of points and minimum singular value threshold.
+  // Output is index of the first point with a minimum singular value below the threshold, or -1 if there is none.
+  int singularityMetricsBatch(DhSingularityMetrics metricsOutput[], float qPathInput[], int noOfPoints, float minSingularValueThreshold);
+
+  // Joint Limit Methods
+
+  // Set the limits of a single joint.
+  // Inputs are joint index, position limits in rad, velocity limit in rad/s and acceleration limit in rad/s^2.
+  // Index must be in range 0 to (no. of links - 1).
+  void set_jointLimits(int index, float qMinInput, float qMaxInput, float qdMaxInput, float qddMaxInput);
+
+  // Set joint position limits.
+  // Inputs are arrays of lower and upper limits in rad.
+  // Array sizes must match number of links.
+  void set_positionLimits(float qMinInput[], float qMaxInput[]);
+
+  // Set joint velocity limits.
+  // Input is array of velocity limits in rad/s.
+  // Array size must match number of links.
+  void set_velocityLimits(float qdMaxInput[]);
+
+  // Set joint acceleration limits.
+  // Input is array of acceleration limits in rad/s^2.
+  // Array size must match number of links.
+  void set_accelerationLimits(float qddMaxInput[]);
+
+  // Remove all joint limits.
+  void clear_jointLimits();
+
+  // Get joint position limits.
+  // Inputs are arrays to store output.
+  // Array sizes must match number of links.
+  // Outputs are lower and upper limits in rad.
+  void get_positionLimits(float qMinOutput[], float qMaxOutput[]);
+
+  // Get joint velocity limits.
+  // Input is array to store output.
+  // Array size must match number of links.
+  // Output is velocity limits in rad/s.
+  void get_velocityLimits(float qdMaxOutput[]);
+
+  // Get joint acceleration limits.
+  // Input is array to store output.
+  // Array size must match number of links.
+  // Output is acceleration limits in rad/s^2.
+  void get_accelerationLimits(float qddMaxOutput[]);
+
+  // Check whether joint angles are within the joint position limits.
+  // Input is array of angles in rad.
+  // Array size must match number of links.
+  // Output is true if all angles are within the limits.
+  bool withinPositionLimits(float qInput[]);
+
+  // Normalise joint angles (in place) by adding/subtracting multiples of 2pi, e.g. angles from atan3(...) in [0, 2pi].
+  // Each angle is mapped to the equivalent angle nearest the current joint angle that is within the joint position limits.
+  // Input is array of angles in rad AND array to store output.
+  // Array size must match number of links.
+  // Output is normalised angles. Returns true if all angles could be mapped within the limits; angles that cannot are
+  // mapped to [-pi, pi).
+  bool normalizeJointAngles(float qInputOutput[]);
+
+  // Validate a joint trajectory against the joint position, velocity and acceleration limits in a single sweep.
+  // Velocities and accelerations are estimated by finite differences of consecutive points.
+  // Inputs are joint trajectory (noOfPoints x no. of links, row-major, rad), no. of points, time step between points in s
+  // (0 to check positions only) and array to store output.
+  // Output array size must match number of links.
+  // Output is index of the first violating point for each joint (-1 if none). A velocity violation is reported at the
+  // second point of the difference and an acceleration violation at the middle point.
+  // Returns index of the first violating point of any joint, or -1 if the trajectory is valid.
+  int validateTrajectory(float qPathInput[], int noOfPoints, float dt, int firstViolationOutput[]);
+
+  // Base Methods
+
+  // Update inverse of base transformation matrix.
+  void updateTmBaseInverse();
+
+  // Set base transformation matrix. In other words, define where the robot base is located in the world (e.g. the cell).
+  // Input is transformation matrix in a 4 x 4 array.
+  void setBaseTransform(float TmBaseInput[4][4]);
+
+  // Set base transformation matrix to the identity matrix. In other words, the D-H base frame is the world frame.
+  void setBaseTransformToIdentity();
+
+  // Get base transformation matrix.
+  // Input is 4 x 4 array to store output. Output is transformation matrix.
+  void get_TmBase(float TmBaseOutput[4][4]);
+
+  // Get the revision of the base and tool transformation matrices. It changes whenever either of them is set.
+  // Output is revision number.
+  uint32_t get_transformRevision();
+
+  // Get inverse of base transformation matrix.
+  // Input is 4 x 4 array to store output.
+  // Output is transformation matrix.
+  void get_TmBaseInverse(float TmBaseInverseOutput[4][4]);
+
   // Tool Methods
 
   // Update inverse of tool transformation matrix.
@@ -176,6 +397,12 @@ class DhKinematicChain {
   void setToolTransformPositionToZero();
 };
 
+// Inverse kinematics callback (robot specific inverse kinematics solution).
+// Inputs are the robots kinematic model (DhKinematicChain object), with the desired transformation matrix applied
+// (position and orientation), and the configuration number.
+// The callback must store the joint angles in the input robot object (e.g. using set_qCurrent(...)).
+typedef void (*DhInverseKinematicsCallback)(DhKinematicChain& robot, int configuration);
+
 } // namespace mt
 
 #endif // DH_KINEMATIC_CHAIN_H_
\ No newline at end of file
@@ -5,6 +5,7 @@
  
 #include "dh_kinematic_link.h"
 
+#include "dh_math_utils.h"
 #include "MatrixMath.h"
 
 #if USING_ARDUINO
@@ -44,19 +45,19 @@ void DhKinematicLink::print_link() {
 #endif
 
 void DhKinematicLink::get_Tm(float TmOutput[4][4], float qInput) {
-	theta = qInput; // (rad).
-
-	float sina = sin(alpha), cosa = cos(alpha);
-	float sint = sin(theta), cost = cos(theta);
-
-	float Tm[4][4] = { {cost, -sint * cosa, sint * sina,  a * cost},
-										 {sint, cost * cosa,  -cost * sina, a * sint},
-										 {0,    sina,         cosa,         d       },
-										 {0,    0,            0,            1       } };
+	// NOTE: The link angle (theta) member is not updated so that links can be evaluated concurrently.
+	float Tm[4][4];
+	dhLinkTm(Tm, qInput, d, a, alpha); // (rad).
 
 	MatrixObj.Copy((float*)Tm, 4, 4, (float*)TmOutput);
 }
 
+float DhKinematicLink::get_theta() { return theta; }
+
+float DhKinematicLink::get_d() { return d; }
+
 float DhKinematicLink::get_a() { return a; }
 
+float DhKinematicLink::get_alpha() { return alpha; }
+
 } // namespace mt
\ No newline at end of file
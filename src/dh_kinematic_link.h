@@ -6,6 +6,9 @@
 #ifndef DH_KINEMATIC_LINK_H_
 #define DH_KINEMATIC_LINK_H_
 
+#include "dh_mat.h"
+#include "dh_math_utils.h"
+
 #if __has_include(<Arduino.h>)
 #include <Arduino.h>
 #define USING_ARDUINO 1
@@ -15,6 +18,49 @@
 
 namespace mt {
 
+// Calculate the D-H link transformation matrix for any scalar type T (e.g. float or Dual<N> for derivatives).
+// Inputs are 4 x 4 array to store output, joint angle (link angle) in rad, and link offset, length and twist.
+// Output is link transformation matrix.
+template <typename T>
+inline void dhLinkTm(T (&TmOutput)[4][4], T q, T d, T a, T alpha) {
+  using DhMathUtils::sincos; // Other scalar types provide an overload found by argument dependent lookup.
+  T sina, cosa, sint, cost;
+  sincos(alpha, sina, cosa);
+  sincos(q, sint, cost);
+
+  TmOutput[0][0] = cost; TmOutput[0][1] = -sint * cosa; TmOutput[0][2] = sint * sina;  TmOutput[0][3] = a * cost;
+  TmOutput[1][0] = sint; TmOutput[1][1] = cost * cosa;  TmOutput[1][2] = -cost * sina; TmOutput[1][3] = a * sint;
+  TmOutput[2][0] = T(0); TmOutput[2][1] = sina;         TmOutput[2][2] = cosa;         TmOutput[2][3] = d;
+  TmOutput[3][0] = T(0); TmOutput[3][1] = T(0);         TmOutput[3][2] = T(0);         TmOutput[3][3] = T(1);
+}
+
+// Calculate the forward kinematics of a D-H serial chain for any scalar type T (e.g. float or Dual<N> for derivatives
+// w.r.t. the joint angles and/or D-H parameters). As the bottom row of every link matrix is (0, 0, 0, 1), only the top
+// 3 x 4 part of the products is calculated.
+// Inputs are 4 x 4 array to store output, no. of links, and arrays of joint angles in rad, link offsets, lengths and twists.
+// Array sizes must match number of links.
+// Output is transformation matrix (w.r.t. the D-H base frame).
+template <typename T>
+inline void dhFKine(T (&TmOutput)[4][4], int noOfLinks, const T q[], const T d[], const T a[], const T alpha[]) {
+  T Tm[4][4], TmLink[4][4];
+  dhLinkTm(Tm, q[0], d[0], a[0], alpha[0]);
+  for (int i = 1; i < noOfLinks; i++)
+  {
+    dhLinkTm(TmLink, q[i], d[i], a[i], alpha[i]);
+    for (int r = 0; r < 3; r++)
+    {
+      T row[4];
+      for (int c = 0; c < 4; c++)
+      {
+        row[c] = Tm[r][0] * TmLink[0][c] + Tm[r][1] * TmLink[1][c] + Tm[r][2] * TmLink[2][c];
+      }
+      row[3] = row[3] + Tm[r][3];
+      for (int c = 0; c < 4; c++) { Tm[r][c] = row[c]; }
+    }
+  }
+  matCopy(Tm, TmOutput);
+}
+
 // Class to encapsulate the robot link parameters and methods.
 class DhKinematicLink {
   
@@ -42,9 +88,21 @@ class DhKinematicLink {
 	// Output is link transformation matrix.
 	void get_Tm(float TmOutput[4][4], float qInput);
 
+	// Get link angle.
+	// Output is link angle in rad.
+	float get_theta();
+
+	// Get link offset.
+	// Output is link offset.
+	float get_d();
+
 	// Get link length.
 	// Output is link length.
 	float get_a();
+
+	// Get link twist.
+	// Output is link twist in rad.
+	float get_alpha();
 };
 
 } // namespace mt
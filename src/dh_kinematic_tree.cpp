@@ -0,0 +1,133 @@
+// Copyright (C) 2015 - 2020 Joseph Morgridge
+//
+// Licensed under GNU General Public License v3.0 (GPLv3) License.
+// See the LICENSE file in the project root for full license details.
+
+#include "dh_kinematic_tree.h"
+
+#include "dh_kinematic_link.h"
+#include "dh_mat.h"
+
+#if USING_ARDUINO
+#include <Arduino.h>
+#endif
+
+namespace mt {
+
+namespace {
+
+// View a (decayed) 4 x 4 array parameter as a 4 x 4 array for the fixed size matrix kernels.
+inline float (&asTm(float (*Tm)[4]))[4][4] { return *reinterpret_cast<float (*)[4][4]>(Tm); }
+
+} // namespace
+
+DhKinematicTree::DhKinematicTree(int noOfNodesInput, DhKinematicLink linksInput[], int parentsInput[]) {
+  for (int e = 0; e < maxEndEffectors; e++)
+  {
+    for (int r = 0; r < 4; r++)
+    {
+      for (int c = 0; c < 4; c++) { TmTools[e][r][c] = (r == c) ? 1 : 0; }
+    }
+  }
+  if (noOfNodesInput < 0 || noOfNodesInput > maxNodes) { return; }
+
+  bool hasChildren[maxNodes];
+  for (int i = 0; i < noOfNodesInput; i++)
+  {
+    if (parentsInput[i] < -1 || parentsInput[i] >= i) { return; } // Parents must come first.
+    hasChildren[i] = false;
+    if (parentsInput[i] >= 0) { hasChildren[parentsInput[i]] = true; }
+  }
+
+  int noOfLeaves = 0;
+  for (int i = 0; i < noOfNodesInput; i++)
+  {
+    if (hasChildren[i]) { continue; }
+    if (noOfLeaves == maxEndEffectors) { return; }
+    endEffectorNodes[noOfLeaves++] = i;
+  }
+
+  noOfNodes = noOfNodesInput;
+  noOfEndEffectors = noOfLeaves;
+  for (int i = 0; i < noOfNodes; i++)
+  {
+    links[i] = linksInput[i];
+    parents[i] = parentsInput[i];
+  }
+}
+
+int DhKinematicTree::get_noOfNodes() { return noOfNodes; }
+
+int DhKinematicTree::get_parent(int node) { return parents[node]; }
+
+int DhKinematicTree::get_noOfEndEffectors() { return noOfEndEffectors; }
+
+int DhKinematicTree::get_endEffectorNode(int endEffector) { return endEffectorNodes[endEffector]; }
+
+void DhKinematicTree::set_baseTransform(float TmBaseInput[4][4]) { matCopy(asTm(TmBaseInput), TmBase); }
+
+void DhKinematicTree::set_toolTransform(int endEffector, float TmToolInput[4][4]) {
+  matCopy(asTm(TmToolInput), TmTools[endEffector]);
+}
+
+void DhKinematicTree::fKineFrames(float TmFramesOutput[][4][4], float qInput[]) {
+  float TmLink[4][4];
+  for (int i = 0; i < noOfNodes; i++)
+  {
+    // Parents come first, so the parent frame is already calculated.
+    float (*TmParent)[4] = (parents[i] < 0) ? TmBase : TmFramesOutput[parents[i]];
+    links[i].get_Tm(TmLink, qInput[i]);
+    matMultiply(asTm(TmParent), TmLink, TmFramesOutput[i]);
+  }
+}
+
+void DhKinematicTree::fKine(float TmOutput[][4][4], float qInput[]) {
+  float TmFrames[maxNodes][4][4];
+  fKineFrames(TmFrames, qInput);
+  for (int e = 0; e < noOfEndEffectors; e++) { matMultiply(TmFrames[endEffectorNodes[e]], TmTools[e], TmOutput[e]); }
+}
+
+void DhKinematicTree::fKineBatch(float TmOutput[][4][4], float qPathInput[], int noOfPoints) {
+  for (int k = 0; k < noOfPoints; k++) { fKine(&TmOutput[k * noOfEndEffectors], &qPathInput[k * noOfNodes]); }
+}
+
+void DhKinematicTree::jacobian(float JOutput[][maxNodes], float qInput[]) {
+  float TmFrames[maxNodes][4][4];
+  fKineFrames(TmFrames, qInput);
+
+  for (int e = 0; e < noOfEndEffectors; e++)
+  {
+    float (*J)[maxNodes] = &JOutput[6 * e];
+    for (int r = 0; r < 6; r++)
+    {
+      for (int j = 0; j < maxNodes; j++) { J[r][j] = 0; }
+    }
+
+    // Tool-tip position (end-effector frame multiplied by the tool transformation matrix).
+    float (&TmEnd)[4][4] = TmFrames[endEffectorNodes[e]];
+    float pe[3];
+    for (int r = 0; r < 3; r++)
+    {
+      pe[r] = TmEnd[r][0] * TmTools[e][0][3] + TmEnd[r][1] * TmTools[e][1][3] + TmEnd[r][2] * TmTools[e][2][3] + TmEnd[r][3];
+    }
+
+    // Only the joints on the path from the end-effector to the base move the end-effector.
+    for (int j = endEffectorNodes[e]; j >= 0; j = parents[j])
+    {
+      // Joint j rotates about the z-axis of the parent frame (the base frame for a root node).
+      float (*TmParent)[4] = (parents[j] < 0) ? TmBase : TmFrames[parents[j]];
+      float z[3] = {TmParent[0][2], TmParent[1][2], TmParent[2][2]};
+      float dp[3] = {pe[0] - TmParent[0][3], pe[1] - TmParent[1][3], pe[2] - TmParent[2][3]};
+
+      // Linear velocity part is z x (pe - p), angular velocity part is z.
+      J[0][j] = z[1] * dp[2] - z[2] * dp[1];
+      J[1][j] = z[2] * dp[0] - z[0] * dp[2];
+      J[2][j] = z[0] * dp[1] - z[1] * dp[0];
+      J[3][j] = z[0];
+      J[4][j] = z[1];
+      J[5][j] = z[2];
+    }
+  }
+}
+
+} // namespace mt
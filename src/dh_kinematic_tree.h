@@ -0,0 +1,130 @@
+// Copyright (C) 2015 - 2020 Joseph Morgridge
+//
+// Licensed under GNU General Public License v3.0 (GPLv3) License.
+// See the LICENSE file in the project root for full license details.
+
+#ifndef DH_KINEMATIC_TREE_H_
+#define DH_KINEMATIC_TREE_H_
+
+#include "dh_kinematic_link.h"
+
+#if __has_include(<Arduino.h>)
+#include <Arduino.h>
+#define USING_ARDUINO 1
+#else
+#define USING_ARDUINO 0
+#endif
+
+// Capacity of the kinematic tree. It can be changed for the whole library by defining it in the build flags
+// e.g. -DDH_KINEMATIC_TREE_MAX_NODES=8 (each node adds 64 bytes of stack to the forward kinematics).
+#ifndef DH_KINEMATIC_TREE_MAX_NODES
+#define DH_KINEMATIC_TREE_MAX_NODES 16
+#endif
+#ifndef DH_KINEMATIC_TREE_MAX_END_EFFECTORS
+#define DH_KINEMATIC_TREE_MAX_END_EFFECTORS 4
+#endif
+
+namespace mt {
+
+// Class to encapsulate a tree of D-H links, e.g. a dual arm robot with a shared torso, or a hand with several fingers.
+// Each node is a revolute joint and its link, attached to the link frame of its parent node (or to the base frame).
+// Nodes must be ordered so that every parent comes before its children; a single forward pass then evaluates every
+// link frame once, so shared links (e.g. the torso) are calculated once for all branches. The leaf nodes are the
+// end-effectors, in node order, and each has its own tool transformation matrix.
+// Joint angle arrays have 1 angle per node, in node order.
+class DhKinematicTree {
+
+ public:
+
+  // General Constants
+  static const int maxNodes = DH_KINEMATIC_TREE_MAX_NODES;
+  static const int maxEndEffectors = DH_KINEMATIC_TREE_MAX_END_EFFECTORS;
+
+ private:
+
+  // Tree Parameters
+  int noOfNodes = 0;
+  DhKinematicLink links[maxNodes];
+  int parents[maxNodes]; // Parent node index (-1 for the base frame).
+  int noOfEndEffectors = 0;
+  int endEffectorNodes[maxEndEffectors];
+
+  // Base and Tool Parameters
+  float TmBase[4][4] = { {1, 0, 0, 0},
+                         {0, 1, 0, 0},
+                         {0, 0, 1, 0},
+                         {0, 0, 0, 1} }; // Base transformation matrix (pose of the D-H base frame w.r.t. the world frame).
+  float TmTools[maxEndEffectors][4][4]; // Tool transformation matrix of each end-effector.
+
+ public:
+
+  // Constructors
+
+  // Inputs are no. of nodes, array of links and array of parent node indexes (-1 for the base frame).
+  // Array sizes must match number of nodes.
+  // The tree is empty (no. of nodes is 0) if there are more than maxNodes nodes or maxEndEffectors leaves, or a parent
+  // index is not less than its node index.
+  DhKinematicTree(int noOfNodesInput, DhKinematicLink linksInput[], int parentsInput[]);
+
+  // Tree Methods
+
+  // Get number of nodes (joints) in the tree.
+  // Output is no. of nodes.
+  int get_noOfNodes();
+
+  // Get parent of a node.
+  // Input is node index.
+  // Output is parent node index (-1 for the base frame).
+  int get_parent(int node);
+
+  // Get number of end-effectors (leaf nodes) in the tree.
+  // Output is no. of end-effectors.
+  int get_noOfEndEffectors();
+
+  // Get node of an end-effector.
+  // Input is end-effector index.
+  // Output is node index.
+  int get_endEffectorNode(int endEffector);
+
+  // Base and Tool Methods
+
+  // Set base transformation matrix (pose of the D-H base frame w.r.t. the world frame).
+  // Input is transformation matrix in a 4 x 4 array.
+  void set_baseTransform(float TmBaseInput[4][4]);
+
+  // Set tool transformation matrix of an end-effector.
+  // Inputs are end-effector index and transformation matrix in a 4 x 4 array.
+  void set_toolTransform(int endEffector, float TmToolInput[4][4]);
+
+  // Kinematics Methods
+
+  // Calculate the forward kinematics of every node frame (transformation matrices) given the joint angles, in a single pass.
+  // Inputs are array of 4 x 4 arrays to store output and array of joint angles in rad.
+  // Output array size must match number of nodes.
+  // Output is the transformation matrix of each link frame w.r.t. the world frame (including the base transformation
+  // matrix but NOT the tool transformation matrices).
+  void fKineFrames(float TmFramesOutput[][4][4], float qInput[]);
+
+  // Calculate the forward kinematics of all end-effectors given the joint angles, in a single pass.
+  // Inputs are array of 4 x 4 arrays to store output and array of joint angles in rad.
+  // Output array size must match number of end-effectors.
+  // Output is the transformation matrix of each end-effector (or tool-tip) w.r.t. the world frame.
+  void fKine(float TmOutput[][4][4], float qInput[]);
+
+  // Calculate the forward kinematics of all end-effectors over a joint trajectory.
+  // Inputs are array of 4 x 4 arrays to store output (noOfPoints x no. of end-effectors, row-major),
+  // joint trajectory (noOfPoints x no. of nodes, row-major, rad) and no. of points.
+  // Output is the transformation matrix of each end-effector (or tool-tip) at each point w.r.t. the world frame.
+  void fKineBatch(float TmOutput[][4][4], float qPathInput[], int noOfPoints);
+
+  // Calculate the combined geometric Jacobian of all end-effectors (or tool-tips) given the joint angles, in a single pass.
+  // Inputs are (6 x no. of end-effectors) x maxNodes array to store output and array of joint angles in rad.
+  // Output is Jacobian w.r.t. the world frame. Rows 6e to 6e + 5 relate to end-effector e; linear velocity (x, y, z) then
+  // angular velocity (x, y, z). Column j relates to joint j, and is 0 for the end-effectors that are not downstream of
+  // node j (e.g. a joint of the other arm); columns beyond the number of nodes are set to 0.
+  void jacobian(float JOutput[][maxNodes], float qInput[]);
+};
+
+} // namespace mt
+
+#endif // DH_KINEMATIC_TREE_H_
@@ -0,0 +1,364 @@
+// Copyright (C) 2015 - 2020 Joseph Morgridge
+//
+// Licensed under GNU General Public License v3.0 (GPLv3) License.
+// See the LICENSE file in the project root for full license details.
+
+#include "dh_kinematics_server.h"
+
+#if !USING_ARDUINO && defined(__linux__)
+
+#include "dh_ik_cache.h"
+#include "dh_kinematic_chain.h"
+
+#include <climits>
+#include <cstring>
+#include <ctime>
+#include <new>
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+using namespace std;
+
+namespace mt {
+
+namespace {
+
+static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t) && std::atomic<uint32_t>::is_always_lock_free,
+              "futex words must be plain lock-free 32-bit atomics");
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "shared statistics must be lock-free");
+
+uint64_t monotonicTime() {
+  timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint64_t)now.tv_sec * 1000000000ull + (uint64_t)now.tv_nsec; // (ns).
+}
+
+// Sleep while the futex word equals the expected value (shared between processes), or until the timeout (ns).
+void futexWait(std::atomic<uint32_t>& word, uint32_t expected, uint64_t timeout) {
+  timespec relative = {(time_t)(timeout / 1000000000ull), (long)(timeout % 1000000000ull)};
+  syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAIT, expected, &relative, nullptr, 0);
+}
+
+void futexWake(std::atomic<uint32_t>& word) {
+  syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+}
+
+void readStats(DhKinematicsRegion& region, DhKinematicsStats& statsOutput) {
+  statsOutput.noOfRequests = region.noOfRequests.load(memory_order_relaxed);
+  statsOutput.noOfBatches = region.noOfBatches.load(memory_order_relaxed);
+  statsOutput.totalLatency = region.totalLatency.load(memory_order_relaxed);
+  statsOutput.maxLatency = region.maxLatency.load(memory_order_relaxed);
+  statsOutput.elapsedTime = monotonicTime() - region.startTime.load(memory_order_relaxed);
+  for (int b = 0; b < 16; b++) { statsOutput.latencyHistogram[b] = region.latencyHistogram[b].load(memory_order_relaxed); }
+}
+
+} // namespace
+
+// Shared Memory
+
+DhSharedMemory::~DhSharedMemory() { close(); }
+
+bool DhSharedMemory::create(const char* name, size_t size) {
+  close();
+  int fd = shm_open(name, O_CREAT | O_RDWR | O_TRUNC, 0600);
+  if (fd < 0) { return false; }
+  if (ftruncate(fd, (off_t)size) != 0) // Zero filled.
+  {
+    ::close(fd);
+    return false;
+  }
+
+  void* address = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  ::close(fd); // The mapping remains valid after the file descriptor is closed.
+  if (address == MAP_FAILED) { return false; }
+  mapping = address;
+  mappingSize = size;
+  return true;
+}
+
+bool DhSharedMemory::open(const char* name) {
+  close();
+  int fd = shm_open(name, O_RDWR, 0600);
+  if (fd < 0) { return false; }
+
+  struct stat objectStatus;
+  if (fstat(fd, &objectStatus) != 0 || objectStatus.st_size <= 0)
+  {
+    ::close(fd);
+    return false;
+  }
+
+  size_t size = (size_t)objectStatus.st_size;
+  void* address = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (address == MAP_FAILED) { return false; }
+  mapping = address;
+  mappingSize = size;
+  return true;
+}
+
+void DhSharedMemory::close() {
+  if (mapping != nullptr) { munmap(mapping, mappingSize); }
+  mapping = nullptr;
+  mappingSize = 0;
+}
+
+void DhSharedMemory::remove(const char* name) { shm_unlink(name); }
+
+void* DhSharedMemory::get_data() { return mapping; }
+
+size_t DhSharedMemory::get_size() { return mappingSize; }
+
+// Server
+
+DhKinematicsServer::DhKinematicsServer(DhKinematicChain& chainInput, DhInverseKinematicsCallback inverseKinematicsInput,
+                                       void* regionInput):
+chain(chainInput), ikCache(inverseKinematicsInput, ikCacheEntries, ikCacheCapacity), hasIk(inverseKinematicsInput != nullptr) {
+  memset(regionInput, 0, sizeof(DhKinematicsRegion));
+  region = new (regionInput) DhKinematicsRegion();
+  region->version = kDhKinematicsServerVersion;
+  region->noOfSlots = noOfSlots;
+  region->noOfLinks = chain.get_noOfLinks();
+  region->startTime = monotonicTime();
+  atomic_thread_fence(memory_order_seq_cst);
+  region->magic = kDhKinematicsServerMagic; // Last, so that clients only attach to an initialized region.
+}
+
+size_t DhKinematicsServer::get_regionSize() { return sizeof(DhKinematicsRegion); }
+
+int DhKinematicsServer::processBatch() {
+  // Take every submitted slot.
+  int noOfRequests = 0;
+  for (int i = 0; i < noOfSlots; i++)
+  {
+    uint32_t expected = kDhSlotSubmitted;
+    if (region->slots[i].state.load(memory_order_relaxed) == kDhSlotSubmitted &&
+        region->slots[i].state.compare_exchange_strong(expected, kDhSlotProcessing))
+    {
+      batchSlots[noOfRequests++] = i;
+    }
+  }
+  if (noOfRequests == 0) { return 0; }
+
+  // Forward kinematics of all FK and Jacobian requests in one batch.
+  int noOfLinks = chain.get_noOfLinks();
+  int noOfPoints = 0;
+  for (int k = 0; k < noOfRequests; k++)
+  {
+    DhKinematicsSlot& slot = region->slots[batchSlots[k]];
+    if (slot.type != kDhKinematicsRequestFk && slot.type != kDhKinematicsRequestJacobian) { continue; }
+    for (int i = 0; i < noOfLinks; i++) { batchQ[noOfPoints * noOfLinks + i] = slot.q[i]; }
+    noOfPoints++;
+  }
+  chain.fKineBatch(batchTm, batchQ, noOfPoints);
+
+  noOfPoints = 0;
+  for (int k = 0; k < noOfRequests; k++)
+  {
+    DhKinematicsSlot& slot = region->slots[batchSlots[k]];
+    switch (slot.type)
+    {
+      case kDhKinematicsRequestFk:
+      case kDhKinematicsRequestJacobian:
+      {
+        memcpy(slot.Tm, batchTm[noOfPoints++], sizeof(slot.Tm));
+        if (slot.type == kDhKinematicsRequestJacobian) { chain.jacobian(slot.J, slot.q); }
+        slot.status = kDhKinematicsOk;
+        break;
+      }
+
+      case kDhKinematicsRequestIk:
+      {
+        slot.status = kDhKinematicsErrorRequest;
+        if (!hasIk) { break; }
+        chain.set_TmCurrent(slot.Tm);
+        if (ikCache.solve(chain, slot.configuration))
+        {
+          chain.get_qCurrent(slot.q);
+          slot.status = kDhKinematicsOk;
+        }
+        else { slot.status = kDhKinematicsErrorIk; }
+        break;
+      }
+
+      default: { slot.status = kDhKinematicsErrorRequest; break; }
+    }
+
+    // Complete, or free the slot if the client has given up.
+    uint64_t latency = monotonicTime() - slot.submitTime;
+    uint32_t expected = kDhSlotProcessing;
+    if (!slot.state.compare_exchange_strong(expected, kDhSlotDone)) { slot.state.store(kDhSlotFree); }
+    else if (slot.clientWaiting.load()) { futexWake(slot.state); }
+
+    int bin = 0;
+    for (uint64_t us = latency / 1000; us >= 2 && bin < 15; us >>= 1) { bin++; }
+    region->latencyHistogram[bin].fetch_add(1, memory_order_relaxed);
+    region->totalLatency.fetch_add(latency, memory_order_relaxed);
+    if (latency > region->maxLatency.load(memory_order_relaxed)) { region->maxLatency.store(latency, memory_order_relaxed); }
+  }
+
+  region->noOfRequests.fetch_add(noOfRequests, memory_order_relaxed);
+  region->noOfBatches.fetch_add(1, memory_order_relaxed);
+  return noOfRequests;
+}
+
+int DhKinematicsServer::serviceOnce(int timeoutMs) {
+  uint32_t sequence = region->requestSequence.load();
+  int noOfRequests = processBatch();
+  if (noOfRequests > 0) { return noOfRequests; }
+
+  // Sleep until a submission. A client only makes the wake up call if it sees serverWaiting set, so the sequence is
+  // checked again after setting it.
+  region->serverWaiting.store(1);
+  if (region->requestSequence.load() == sequence) { futexWait(region->requestSequence, sequence, timeoutMs * 1000000ull); }
+  region->serverWaiting.store(0);
+  return processBatch();
+}
+
+void DhKinematicsServer::run() {
+  running = true;
+  while (running) { serviceOnce(100); }
+}
+
+void DhKinematicsServer::stop() { running = false; }
+
+DhIkCache& DhKinematicsServer::get_ikCache() { return ikCache; }
+
+void DhKinematicsServer::get_stats(DhKinematicsStats& statsOutput) { readStats(*region, statsOutput); }
+
+void DhKinematicsServer::reset_stats() {
+  region->noOfRequests = 0;
+  region->noOfBatches = 0;
+  region->totalLatency = 0;
+  region->maxLatency = 0;
+  for (int b = 0; b < 16; b++) { region->latencyHistogram[b] = 0; }
+  region->startTime = monotonicTime();
+}
+
+// Client
+
+bool DhKinematicsClient::attach(void* regionInput) {
+  region = nullptr;
+  DhKinematicsRegion* candidate = (DhKinematicsRegion*)regionInput;
+  if (candidate == nullptr || candidate->magic != kDhKinematicsServerMagic) { return false; }
+  atomic_thread_fence(memory_order_seq_cst);
+  if (candidate->version != kDhKinematicsServerVersion || candidate->noOfSlots != (uint32_t)DH_KINEMATICS_SERVER_SLOTS)
+  {
+    return false;
+  }
+  region = candidate;
+  return true;
+}
+
+void DhKinematicsClient::set_timeout(int timeoutMsInput) { timeoutMs = timeoutMsInput; }
+
+int DhKinematicsClient::get_noOfLinks() { return (region != nullptr) ? (int)region->noOfLinks : 0; }
+
+DhKinematicsSlot* DhKinematicsClient::acquireSlot() {
+  int noOfSlots = region->noOfSlots;
+  for (int attempt = 0; attempt < noOfSlots; attempt++)
+  {
+    DhKinematicsSlot& slot = region->slots[region->claimPosition.fetch_add(1, memory_order_relaxed) % noOfSlots];
+    uint32_t expected = kDhSlotFree;
+    if (slot.state.load(memory_order_relaxed) == kDhSlotFree && slot.state.compare_exchange_strong(expected, kDhSlotClaimed))
+    {
+      return &slot;
+    }
+  }
+  return nullptr;
+}
+
+void DhKinematicsClient::submit(DhKinematicsSlot* slot) {
+  slot->submitTime = monotonicTime();
+  slot->state.store(kDhSlotSubmitted);
+  region->requestSequence.fetch_add(1);
+  if (region->serverWaiting.load()) { futexWake(region->requestSequence); }
+}
+
+bool DhKinematicsClient::wait(DhKinematicsSlot* slot) {
+  uint64_t deadline = monotonicTime() + (uint64_t)timeoutMs * 1000000ull;
+
+  // Short spin first; a batch is usually served within microseconds.
+  for (int spin = 0; spin < 200; spin++)
+  {
+    if (slot->state.load(memory_order_acquire) == kDhSlotDone) { return true; }
+  }
+
+  while (true)
+  {
+    uint32_t state = slot->state.load(memory_order_acquire);
+    if (state == kDhSlotDone) { return true; }
+    uint64_t now = monotonicTime();
+    if (now >= deadline) { break; }
+
+    // The server only makes the wake up call if it sees clientWaiting set, so the state is checked again after setting it.
+    slot->clientWaiting.store(1);
+    state = slot->state.load();
+    if (state != kDhSlotDone) { futexWait(slot->state, state, deadline - now); }
+    slot->clientWaiting.store(0);
+  }
+
+  // Timeout; cancel the request if the server has not taken it, otherwise let the server free the slot.
+  uint32_t expected = kDhSlotSubmitted;
+  if (slot->state.compare_exchange_strong(expected, kDhSlotFree)) { return false; }
+  expected = kDhSlotProcessing;
+  if (slot->state.compare_exchange_strong(expected, kDhSlotAbandoned)) { return false; }
+  return true; // Completed meanwhile.
+}
+
+void DhKinematicsClient::release(DhKinematicsSlot* slot) { slot->state.store(kDhSlotFree, memory_order_release); }
+
+int DhKinematicsClient::fKine(float TmOutput[4][4], float qInput[]) {
+  DhKinematicsSlot* slot = acquireSlot();
+  if (slot == nullptr) { return kDhKinematicsErrorBusy; }
+  slot->type = kDhKinematicsRequestFk;
+  for (int i = 0; i < (int)region->noOfLinks; i++) { slot->q[i] = qInput[i]; }
+  submit(slot);
+  if (!wait(slot)) { return kDhKinematicsErrorTimeout; }
+
+  int status = slot->status;
+  memcpy(TmOutput, slot->Tm, sizeof(slot->Tm));
+  release(slot);
+  return status;
+}
+
+int DhKinematicsClient::jacobian(float JOutput[6][maxLinks], float qInput[]) {
+  DhKinematicsSlot* slot = acquireSlot();
+  if (slot == nullptr) { return kDhKinematicsErrorBusy; }
+  slot->type = kDhKinematicsRequestJacobian;
+  for (int i = 0; i < (int)region->noOfLinks; i++) { slot->q[i] = qInput[i]; }
+  submit(slot);
+  if (!wait(slot)) { return kDhKinematicsErrorTimeout; }
+
+  int status = slot->status;
+  memcpy(JOutput, slot->J, sizeof(slot->J));
+  release(slot);
+  return status;
+}
+
+int DhKinematicsClient::iKine(float qOutput[], float TmInput[4][4], int configuration) {
+  DhKinematicsSlot* slot = acquireSlot();
+  if (slot == nullptr) { return kDhKinematicsErrorBusy; }
+  slot->type = kDhKinematicsRequestIk;
+  slot->configuration = configuration;
+  memcpy(slot->Tm, TmInput, sizeof(slot->Tm));
+  submit(slot);
+  if (!wait(slot)) { return kDhKinematicsErrorTimeout; }
+
+  int status = slot->status;
+  if (status == kDhKinematicsOk)
+  {
+    for (int i = 0; i < (int)region->noOfLinks; i++) { qOutput[i] = slot->q[i]; }
+  }
+  release(slot);
+  return status;
+}
+
+void DhKinematicsClient::get_stats(DhKinematicsStats& statsOutput) { readStats(*region, statsOutput); }
+
+} // namespace mt
+
+#endif
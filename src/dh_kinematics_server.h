@@ -0,0 +1,287 @@
+// Copyright (C) 2015 - 2020 Joseph Morgridge
+//
+// Licensed under GNU General Public License v3.0 (GPLv3) License.
+// See the LICENSE file in the project root for full license details.
+
+#ifndef DH_KINEMATICS_SERVER_H_
+#define DH_KINEMATICS_SERVER_H_
+
+#include "dh_ik_cache.h"
+#include "dh_kinematic_chain.h"
+
+#if __has_include(<Arduino.h>)
+#include <Arduino.h>
+#define USING_ARDUINO 1
+#else
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#define USING_ARDUINO 0
+#endif
+
+// No. of request slots in the shared memory region. It can be changed for the whole library by defining it in the build
+// flags e.g. -DDH_KINEMATICS_SERVER_SLOTS=256 (it is also the max. batch size).
+#ifndef DH_KINEMATICS_SERVER_SLOTS
+#define DH_KINEMATICS_SERVER_SLOTS 64
+#endif
+
+// The kinematics server uses Linux shared memory and futexes.
+#if !USING_ARDUINO && defined(__linux__)
+
+namespace mt {
+
+// Shared memory kinematics service (version 1).
+// A server process owns a kinematic chain and serves forward kinematics, Jacobian and inverse kinematics requests from
+// client processes on the same machine through a shared memory region, so the clients do not each compute (or cache)
+// the same kinematics. The region holds a ring of request slots; a client claims the next free slot, writes its request
+// in place, submits it and waits on the slot (futex). The server wakes on submission (futex), takes every submitted
+// slot as one batch (batch forward kinematics, shared IK cache), writes the results in place and wakes the clients,
+// which read the results directly from the slot (zero copy) and release it. The server only makes a wake up system call
+// for a party that is actually sleeping. Request latency and throughput statistics are kept in the region, so they can
+// be read by any process.
+constexpr uint32_t kDhKinematicsServerMagic = 0x534B4844; // "DHKS".
+constexpr uint32_t kDhKinematicsServerVersion = 1;
+
+// Request types.
+constexpr uint32_t kDhKinematicsRequestFk = 1;       // q -> Tm.
+constexpr uint32_t kDhKinematicsRequestJacobian = 2; // q -> Tm and J.
+constexpr uint32_t kDhKinematicsRequestIk = 3;       // Tm and configuration -> q.
+
+// Request status codes.
+constexpr int kDhKinematicsOk = 0;
+constexpr int kDhKinematicsErrorRequest = 1; // Unknown request type.
+constexpr int kDhKinematicsErrorIk = 2;      // Inverse kinematics did not reach the target.
+constexpr int kDhKinematicsErrorBusy = 3;    // No free slot (client side).
+constexpr int kDhKinematicsErrorTimeout = 4; // No response from the server within the timeout (client side).
+
+// Slot states.
+constexpr uint32_t kDhSlotFree = 0;
+constexpr uint32_t kDhSlotClaimed = 1;    // Client is writing the request.
+constexpr uint32_t kDhSlotSubmitted = 2;  // Waiting for the server.
+constexpr uint32_t kDhSlotProcessing = 3; // Taken by the server.
+constexpr uint32_t kDhSlotDone = 4;       // Results ready for the client.
+constexpr uint32_t kDhSlotAbandoned = 5;  // Client timed out while processing; the server frees the slot.
+
+// Request slot in shared memory. Results are written in place of the request.
+struct DhKinematicsSlot {
+  std::atomic<uint32_t> state;         // Futex word of the client.
+  std::atomic<uint32_t> clientWaiting; // Client is sleeping on state.
+  uint32_t type;
+  int32_t configuration; // IK configuration number.
+  int32_t status;
+  uint32_t reserved;
+  uint64_t submitTime;   // CLOCK_MONOTONIC (ns).
+  float q[DhKinematicChain::maxLinks]; // Joint angles (rad); FK/Jacobian input, IK output.
+  float Tm[4][4];        // Transformation matrix w.r.t. the world frame; FK/Jacobian output, IK input.
+  float J[6][DhKinematicChain::maxLinks]; // Jacobian output. See DhKinematicChain::jacobian(...).
+};
+
+// Server statistics.
+struct DhKinematicsStats {
+  uint64_t noOfRequests;
+  uint64_t noOfBatches;
+  uint64_t totalLatency;  // Sum of the submit to completion latencies (ns).
+  uint64_t maxLatency;    // (ns).
+  uint64_t elapsedTime;   // Since the server started or the statistics were reset (ns); for throughput.
+  uint64_t latencyHistogram[16]; // Bin b counts latencies of [2^b, 2^(b+1)) us (bin 0 includes < 1 us, bin 15 >= 32 ms).
+};
+
+// Shared memory region of the kinematics service. Created by the server (DhKinematicsServer::get_regionSize()).
+struct DhKinematicsRegion {
+  uint32_t magic;   // kDhKinematicsServerMagic.
+  uint32_t version; // kDhKinematicsServerVersion.
+  uint32_t noOfSlots;
+  uint32_t noOfLinks;
+  std::atomic<uint32_t> requestSequence; // Futex word of the server; incremented on every submission.
+  std::atomic<uint32_t> serverWaiting;   // Server is sleeping on requestSequence.
+  std::atomic<uint32_t> claimPosition;   // Next slot to claim (ring position).
+  uint32_t reserved;
+
+  // Statistics (written by the server only).
+  std::atomic<uint64_t> noOfRequests;
+  std::atomic<uint64_t> noOfBatches;
+  std::atomic<uint64_t> totalLatency;
+  std::atomic<uint64_t> maxLatency;
+  std::atomic<uint64_t> startTime;
+  std::atomic<uint64_t> latencyHistogram[16];
+
+  DhKinematicsSlot slots[DH_KINEMATICS_SERVER_SLOTS];
+};
+
+// Class to encapsulate a POSIX shared memory object mapped into this process.
+class DhSharedMemory {
+
+  void* mapping = nullptr;
+  size_t mappingSize = 0;
+
+ public:
+
+  DhSharedMemory() = default;
+  DhSharedMemory(const DhSharedMemory&) = delete;
+  DhSharedMemory& operator=(const DhSharedMemory&) = delete;
+  ~DhSharedMemory();
+
+  // Create (or truncate) and map a shared memory object, initialized to zero.
+  // Inputs are name (e.g. "/dh_kinematics") and size in bytes.
+  // Output is true on success.
+  bool create(const char* name, size_t size);
+
+  // Map an existing shared memory object.
+  // Input is name.
+  // Output is true on success.
+  bool open(const char* name);
+
+  // Unmap the shared memory object (it exists until removed).
+  void close();
+
+  // Remove a shared memory object name (existing mappings remain valid).
+  // Input is name.
+  static void remove(const char* name);
+
+  // Get the mapped memory. Only valid while open.
+  void* get_data();
+
+  // Get the mapped size in bytes.
+  size_t get_size();
+};
+
+// Class to encapsulate the kinematics server.
+class DhKinematicsServer {
+
+ public:
+
+  // General Constants
+  static const int maxLinks = DhKinematicChain::maxLinks;
+  static const int noOfSlots = DH_KINEMATICS_SERVER_SLOTS;
+  static const int ikCacheCapacity = 256;
+
+ private:
+
+  // General Parameters
+  DhKinematicChain& chain;
+  DhKinematicsRegion* region;
+  DhIkCacheEntry ikCacheEntries[ikCacheCapacity];
+  DhIkCache ikCache;
+  bool hasIk;
+  std::atomic<bool> running{false};
+
+  // Batch Buffers
+  int batchSlots[noOfSlots];
+  float batchQ[noOfSlots * maxLinks];
+  float batchTm[noOfSlots][4][4];
+
+  // Take the submitted slots, solve them as a batch and complete them. Output is no. of requests.
+  int processBatch();
+
+ public:
+
+  // Constructors
+
+  // Inputs are the robots kinematic model, robot specific IK callback (nullptr if IK requests are not served) and
+  // shared memory of get_regionSize() bytes (e.g. DhSharedMemory::create(...)), which is initialized here.
+  DhKinematicsServer(DhKinematicChain& chainInput, DhInverseKinematicsCallback inverseKinematicsInput, void* regionInput);
+
+  // Server Methods
+
+  // Get the size of the shared memory region.
+  // Output is size in bytes.
+  static size_t get_regionSize();
+
+  // Wait for requests and serve one batch.
+  // Input is max. time to wait in ms.
+  // Output is no. of requests served (0 on timeout).
+  int serviceOnce(int timeoutMs);
+
+  // Serve requests until stop() is called.
+  void run();
+
+  // Stop run() (e.g. from another thread or a signal handler).
+  void stop();
+
+  // Get the IK cache, e.g. to set the tolerances. The cache is cleared automatically on base/tool changes.
+  DhIkCache& get_ikCache();
+
+  // Statistics Methods
+
+  // Get the server statistics.
+  // Input is statistics object to store output.
+  void get_stats(DhKinematicsStats& statsOutput);
+
+  // Reset the server statistics.
+  void reset_stats();
+};
+
+// Class to encapsulate a client of the kinematics server (any process with the shared memory region mapped).
+// Each client object may be used by one thread at a time; use one client object per thread.
+class DhKinematicsClient {
+
+ public:
+
+  // General Constants
+  static const int maxLinks = DhKinematicChain::maxLinks;
+
+ private:
+
+  DhKinematicsRegion* region = nullptr;
+  int timeoutMs = 1000;
+
+ public:
+
+  // Methods
+
+  // Attach to (and validate) a kinematics server region.
+  // Input is shared memory (e.g. DhSharedMemory::open(...)).
+  // Output is true if the region is valid.
+  bool attach(void* regionInput);
+
+  // Set the timeout of the request methods.
+  // Input is timeout in ms.
+  void set_timeout(int timeoutMsInput);
+
+  // Get no. of links of the server chain.
+  int get_noOfLinks();
+
+  // Zero Copy Methods
+
+  // Claim a free slot to write a request into (type, q or Tm and configuration).
+  // Output is slot, or nullptr if all slots are in use.
+  DhKinematicsSlot* acquireSlot();
+
+  // Submit a claimed slot to the server.
+  void submit(DhKinematicsSlot* slot);
+
+  // Wait for the results of a submitted slot, which can then be read in place (status, Tm, J or q).
+  // Output is true when the results are ready, false on timeout (the request is then cancelled and the slot must
+  // not be used again; it is released by the server if it was already being processed).
+  bool wait(DhKinematicsSlot* slot);
+
+  // Release a slot after reading the results.
+  void release(DhKinematicsSlot* slot);
+
+  // Request Methods (copying)
+
+  // Calculate the forward kinematics (with base and tool) given the joint angles.
+  // Inputs are 4 x 4 array to store output and array of joint angles in rad.
+  // Output is status code (kDhKinematicsOk on success).
+  int fKine(float TmOutput[4][4], float qInput[]);
+
+  // Calculate the geometric Jacobian given the joint angles. See DhKinematicChain::jacobian(...).
+  // Inputs are 6 x maxLinks array to store output and array of joint angles in rad.
+  // Output is status code (kDhKinematicsOk on success).
+  int jacobian(float JOutput[6][maxLinks], float qInput[]);
+
+  // Solve the inverse kinematics.
+  // Inputs are array to store output, target transformation matrix (w.r.t. the world frame) and configuration number.
+  // Output is status code (kDhKinematicsOk on success).
+  int iKine(float qOutput[], float TmInput[4][4], int configuration);
+
+  // Get the server statistics (from the shared memory region).
+  // Input is statistics object to store output.
+  void get_stats(DhKinematicsStats& statsOutput);
+};
+
+} // namespace mt
+
+#endif
+
+#endif // DH_KINEMATICS_SERVER_H_
@@ -0,0 +1,88 @@
+// Copyright (C) 2015 - 2020 Joseph Morgridge
+//
+// Licensed under GNU General Public License v3.0 (GPLv3) License.
+// See the LICENSE file in the project root for full license details.
+
+#include "dh_mapped_file.h"
+
+#if !USING_ARDUINO
+#include <cstdio>
+#include <cstdlib>
+#if __has_include(<sys/mman.h>)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define DH_HAS_MMAP 1
+#else
+#define DH_HAS_MMAP 0
+#endif
+using namespace std;
+#endif
+
+namespace mt {
+
+#if !USING_ARDUINO
+
+DhMappedFile::~DhMappedFile() { close(); }
+
+bool DhMappedFile::open(const char* path) {
+  close();
+
+#if DH_HAS_MMAP
+  int fd = ::open(path, O_RDONLY);
+  if (fd < 0) { return false; }
+
+  struct stat fileStatus;
+  if (fstat(fd, &fileStatus) != 0 || fileStatus.st_size <= 0)
+  {
+    ::close(fd);
+    return false;
+  }
+
+  mappingSize = (size_t)fileStatus.st_size;
+  void* address = mmap(nullptr, mappingSize, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd); // The mapping remains valid after the file descriptor is closed.
+  if (address == MAP_FAILED)
+  {
+    mappingSize = 0;
+    return false;
+  }
+  mapping = address;
+#else
+  // No memory mapping available; read the file into a heap buffer instead.
+  FILE* file = fopen(path, "rb");
+  if (file == nullptr) { return false; }
+  fseek(file, 0, SEEK_END);
+  long fileSize = ftell(file);
+  fseek(file, 0, SEEK_SET);
+  if (fileSize <= 0) { fclose(file); return false; }
+  mappingSize = (size_t)fileSize;
+  mapping = malloc(mappingSize);
+  bool readOk = (mapping != nullptr) && (fread(mapping, 1, mappingSize, file) == mappingSize);
+  fclose(file);
+  if (!readOk) { close(); return false; }
+#endif
+  return true;
+}
+
+void DhMappedFile::close() {
+  if (mapping != nullptr)
+  {
+#if DH_HAS_MMAP
+    munmap(mapping, mappingSize);
+#else
+    free(mapping);
+#endif
+  }
+  mapping = nullptr;
+  mappingSize = 0;
+}
+
+const void* DhMappedFile::get_data() { return mapping; }
+
+size_t DhMappedFile::get_size() { return mappingSize; }
+
+#endif
+
+} // namespace mt
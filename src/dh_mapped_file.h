@@ -0,0 +1,54 @@
+// Copyright (C) 2015 - 2020 Joseph Morgridge
+//
+// Licensed under GNU General Public License v3.0 (GPLv3) License.
+// See the LICENSE file in the project root for full license details.
+
+#ifndef DH_MAPPED_FILE_H_
+#define DH_MAPPED_FILE_H_
+
+#if __has_include(<Arduino.h>)
+#include <Arduino.h>
+#define USING_ARDUINO 1
+#else
+#include <cstddef>
+#define USING_ARDUINO 0
+#endif
+
+namespace mt {
+
+#if !USING_ARDUINO
+// Class to encapsulate a read only memory mapped file (desktop platforms). On platforms without POSIX memory mapping
+// the file is read into a heap buffer instead. Used by the binary file formats which are read directly from memory.
+class DhMappedFile {
+
+  void* mapping = nullptr;
+  size_t mappingSize = 0;
+
+ public:
+
+  DhMappedFile() = default;
+  DhMappedFile(const DhMappedFile&) = delete;
+  DhMappedFile& operator=(const DhMappedFile&) = delete;
+  ~DhMappedFile();
+
+  // Memory map a file (read only).
+  // Input is file path.
+  // Output is true on success (empty files are rejected).
+  bool open(const char* path);
+
+  // Unmap the file.
+  void close();
+
+  // Get the mapped file contents. Only valid while the file is open.
+  // Output is pointer to the contents (page aligned), or nullptr if not open.
+  const void* get_data();
+
+  // Get the mapped file size.
+  // Output is size in bytes, or 0 if not open.
+  size_t get_size();
+};
+#endif
+
+} // namespace mt
+
+#endif // DH_MAPPED_FILE_H_
@@ -0,0 +1,361 @@
+// Copyright (C) 2015 - 2020 Joseph Morgridge
+//
+// Licensed under GNU General Public License v3.0 (GPLv3) License.
+// See the LICENSE file in the project root for full license details.
+
+#ifndef DH_MAT_H_
+#define DH_MAT_H_
+
+#if __has_include(<Arduino.h>)
+#include <Arduino.h>
+#define USING_ARDUINO 1
+#else
+#include <cmath>
+#define USING_ARDUINO 0
+#endif
+
+// Fixed size matrix library with compile time dimensions.
+// This is intended to replace the global MatrixObj (MatrixMath) over time. All dimensions are template parameters,
+// so loops can be unrolled and inlined by the compiler, and there are no variable length arrays and no dynamic memory allocation.
+// The kernels operate directly on 2D arrays (e.g. the float[4][4] transformation matrices used throughout the library),
+// and the Mat<R, C, T> type wraps them with value semantics and operators.
+namespace mt {
+
+// Array Kernels
+
+// Matrix copy.
+// A = input matrix (R x C)
+// B = output matrix = A (R x C)
+template <int R, int C, typename T>
+inline void matCopy(const T (&A)[R][C], T (&BOutput)[R][C]) {
+  for (int i = 0; i < R; i++)
+    for (int j = 0; j < C; j++)
+      BOutput[i][j] = A[i][j];
+}
+
+// Matrix multiplication.
+// A = input matrix (R x P)
+// B = input matrix (P x C)
+// C = output matrix = A*B (R x C). Must not be the same array as A or B.
+template <int R, int P, int C, typename T>
+inline void matMultiply(const T (&A)[R][P], const T (&B)[P][C], T (&COutput)[R][C]) {
+  for (int i = 0; i < R; i++)
+    for (int j = 0; j < C; j++)
+    {
+      T sum = A[i][0] * B[0][j];
+      for (int k = 1; k < P; k++)
+        sum += A[i][k] * B[k][j];
+      COutput[i][j] = sum;
+    }
+}
+
+// Matrix addition.
+// C = output matrix = A+B (R x C)
+template <int R, int C, typename T>
+inline void matAdd(const T (&A)[R][C], const T (&B)[R][C], T (&COutput)[R][C]) {
+  for (int i = 0; i < R; i++)
+    for (int j = 0; j < C; j++)
+      COutput[i][j] = A[i][j] + B[i][j];
+}
+
+// Matrix subtraction.
+// C = output matrix = A-B (R x C)
+template <int R, int C, typename T>
+inline void matSubtract(const T (&A)[R][C], const T (&B)[R][C], T (&COutput)[R][C]) {
+  for (int i = 0; i < R; i++)
+    for (int j = 0; j < C; j++)
+      COutput[i][j] = A[i][j] - B[i][j];
+}
+
+// Matrix transpose.
+// C = output matrix = the transpose of A (C x R)
+template <int R, int C, typename T>
+inline void matTranspose(const T (&A)[R][C], T (&COutput)[C][R]) {
+  for (int i = 0; i < R; i++)
+    for (int j = 0; j < C; j++)
+      COutput[j][i] = A[i][j];
+}
+
+// Matrix scale (in place).
+// A = input matrix AND result matrix = k*A (R x C)
+template <int R, int C, typename T>
+inline void matScale(T (&A)[R][C], T k) {
+  for (int i = 0; i < R; i++)
+    for (int j = 0; j < C; j++)
+      A[i][j] = A[i][j] * k;
+}
+
+// LU decomposition with partial pivoting (in place).
+// A = input matrix AND result matrix; L (unit diagonal, not stored) below the diagonal and U on and above it (N x N)
+// pivot = output row permutation (N)
+// Returns true on success, false if the matrix is singular.
+template <int N, typename T>
+inline bool luDecompose(T (&A)[N][N], int (&pivotOutput)[N]) {
+  for (int k = 0; k < N; k++)
+  {
+    // Find pivot row, the row with biggest entry in current column.
+    int pivotRow = k;
+    T maxValue = (A[k][k] < 0) ? -A[k][k] : A[k][k];
+    for (int i = k + 1; i < N; i++)
+    {
+      T value = (A[i][k] < 0) ? -A[i][k] : A[i][k];
+      if (value > maxValue) { maxValue = value; pivotRow = i; }
+    }
+    pivotOutput[k] = pivotRow;
+    if (maxValue == T(0)) { return false; }
+
+    if (pivotRow != k)
+    {
+      for (int j = 0; j < N; j++)
+      {
+        T temp = A[k][j];
+        A[k][j] = A[pivotRow][j];
+        A[pivotRow][j] = temp;
+      }
+    }
+
+    for (int i = k + 1; i < N; i++)
+    {
+      A[i][k] = A[i][k] / A[k][k];
+      for (int j = k + 1; j < N; j++)
+        A[i][j] = A[i][j] - A[i][k] * A[k][j];
+    }
+  }
+  return true;
+}
+
+// Solve A x = b given the LU decomposition of A (in place).
+// LU = LU decomposition from luDecompose (N x N)
+// pivot = row permutation from luDecompose (N)
+// b = input right hand side AND result x (N)
+template <int N, typename T>
+inline void luSolve(const T (&LU)[N][N], const int (&pivot)[N], T (&b)[N]) {
+  for (int k = 0; k < N; k++)
+  {
+    if (pivot[k] != k) { T temp = b[k]; b[k] = b[pivot[k]]; b[pivot[k]] = temp; }
+  }
+  for (int i = 0; i < N; i++)
+    for (int k = 0; k < i; k++)
+      b[i] = b[i] - LU[i][k] * b[k];
+  for (int i = N - 1; i >= 0; i--)
+  {
+    for (int k = i + 1; k < N; k++)
+      b[i] = b[i] - LU[i][k] * b[k];
+    b[i] = b[i] / LU[i][i];
+  }
+}
+
+// Cholesky decomposition (in place) of a symmetric positive definite matrix; A = L L^T.
+// A = input matrix AND result matrix; L on and below the diagonal (N x N). Only the lower triangle of A is read.
+// Returns true on success, false if the matrix is not positive definite.
+template <int N, typename T>
+inline bool choleskyDecompose(T (&A)[N][N]) {
+  for (int j = 0; j < N; j++)
+  {
+    T diagonal = A[j][j];
+    for (int k = 0; k < j; k++)
+      diagonal = diagonal - A[j][k] * A[j][k];
+    if (!(diagonal > T(0))) { return false; }
+    using ::sqrt; // Plain scalars; other scalar types (e.g. Dual) are found by argument dependent lookup.
+    A[j][j] = sqrt(diagonal);
+
+    for (int i = j + 1; i < N; i++)
+    {
+      T value = A[i][j];
+      for (int k = 0; k < j; k++)
+        value = value - A[i][k] * A[j][k];
+      A[i][j] = value / A[j][j];
+    }
+  }
+  return true;
+}
+
+// Solve A x = b given the Cholesky decomposition of A (in place).
+// L = Cholesky decomposition from choleskyDecompose (N x N)
+// b = input right hand side AND result x (N)
+template <int N, typename T>
+inline void choleskySolve(const T (&L)[N][N], T (&b)[N]) {
+  for (int i = 0; i < N; i++)
+  {
+    for (int k = 0; k < i; k++)
+      b[i] = b[i] - L[i][k] * b[k];
+    b[i] = b[i] / L[i][i];
+  }
+  for (int i = N - 1; i >= 0; i--)
+  {
+    for (int k = i + 1; k < N; k++)
+      b[i] = b[i] - L[k][i] * b[k];
+    b[i] = b[i] / L[i][i];
+  }
+}
+
+// Eigenvalues of a symmetric matrix using the cyclic Jacobi method (in place).
+// A = input matrix AND result matrix; diagonalised on return (N x N)
+// eigenvalues = output eigenvalues, sorted in descending order (N)
+template <int N, typename T>
+inline void symmetricEigenvalues(T (&A)[N][N], T (&eigenvaluesOutput)[N]) {
+  const int maxSweeps = 16;
+  for (int sweep = 0; sweep < maxSweeps; sweep++)
+  {
+    T offDiagonal = T(0), total = T(0);
+    for (int i = 0; i < N; i++)
+      for (int j = 0; j < N; j++)
+      {
+        total = total + A[i][j] * A[i][j];
+        if (i != j) { offDiagonal = offDiagonal + A[i][j] * A[i][j]; }
+      }
+    if (!(offDiagonal > total * T(1e-14))) { break; }
+
+    for (int p = 0; p < N - 1; p++)
+      for (int q = p + 1; q < N; q++)
+      {
+        if (A[p][q] == T(0)) { continue; }
+
+        // Rotation which zeroes A[p][q].
+        using ::sqrt;
+        T theta = (A[q][q] - A[p][p]) / (A[p][q] * T(2));
+        T absTheta = (theta < 0) ? -theta : theta;
+        T t = T(1) / (absTheta + sqrt(theta * theta + T(1)));
+        if (theta < 0) { t = -t; }
+        T c = T(1) / sqrt(t * t + T(1));
+        T s = t * c;
+
+        for (int k = 0; k < N; k++)
+        {
+          T akp = A[k][p], akq = A[k][q];
+          A[k][p] = c * akp - s * akq;
+          A[k][q] = s * akp + c * akq;
+        }
+        for (int k = 0; k < N; k++)
+        {
+          T apk = A[p][k], aqk = A[q][k];
+          A[p][k] = c * apk - s * aqk;
+          A[q][k] = s * apk + c * aqk;
+        }
+      }
+  }
+
+  // Insertion sort (descending).
+  for (int i = 0; i < N; i++)
+  {
+    T value = A[i][i];
+    int j = i - 1;
+    for (; j >= 0 && eigenvaluesOutput[j] < value; j--)
+      eigenvaluesOutput[j + 1] = eigenvaluesOutput[j];
+    eigenvaluesOutput[j + 1] = value;
+  }
+}
+
+// Matrix Type
+
+// Fixed size matrix (R x C) with value semantics. Column vectors are Mat<N, 1, T>.
+template <int R, int C, typename T = float>
+struct Mat {
+  static const int rows = R;
+  static const int cols = C;
+
+  T data[R][C];
+
+  T& operator()(int r, int c) { return data[r][c]; }
+  const T& operator()(int r, int c) const { return data[r][c]; }
+
+  // Matrix of zeros.
+  static Mat zeros() {
+    Mat M;
+    for (int i = 0; i < R; i++)
+      for (int j = 0; j < C; j++)
+        M.data[i][j] = T(0);
+    return M;
+  }
+
+  // Identity matrix (ones on the main diagonal).
+  static Mat identity() {
+    Mat M = zeros();
+    for (int i = 0; i < R && i < C; i++)
+      M.data[i][i] = T(1);
+    return M;
+  }
+
+  // Matrix from a 2D array.
+  static Mat fromArray(const T (&A)[R][C]) {
+    Mat M;
+    matCopy(A, M.data);
+    return M;
+  }
+
+  // Copy matrix to a 2D array.
+  void toArray(T (&AOutput)[R][C]) const { matCopy(data, AOutput); }
+
+  // Matrix transpose.
+  Mat<C, R, T> transpose() const {
+    Mat<C, R, T> M;
+    matTranspose(data, M.data);
+    return M;
+  }
+};
+
+template <int R, int P, int C, typename T>
+inline Mat<R, C, T> operator*(const Mat<R, P, T>& A, const Mat<P, C, T>& B) {
+  Mat<R, C, T> M;
+  matMultiply(A.data, B.data, M.data);
+  return M;
+}
+
+template <int R, int C, typename T>
+inline Mat<R, C, T> operator+(const Mat<R, C, T>& A, const Mat<R, C, T>& B) {
+  Mat<R, C, T> M;
+  matAdd(A.data, B.data, M.data);
+  return M;
+}
+
+template <int R, int C, typename T>
+inline Mat<R, C, T> operator-(const Mat<R, C, T>& A, const Mat<R, C, T>& B) {
+  Mat<R, C, T> M;
+  matSubtract(A.data, B.data, M.data);
+  return M;
+}
+
+template <int R, int C, typename T>
+inline Mat<R, C, T> operator*(const Mat<R, C, T>& A, T k) {
+  Mat<R, C, T> M = A;
+  matScale(M.data, k);
+  return M;
+}
+
+template <int R, int C, typename T>
+inline Mat<R, C, T> operator*(T k, const Mat<R, C, T>& A) { return A * k; }
+
+// Solve A x = b using LU decomposition with partial pivoting.
+// Inputs are A (N x N), b (N x 1) and vector to store output.
+// Output is x. Returns true on success, false if A is singular.
+template <int N, typename T>
+inline bool solveLu(const Mat<N, N, T>& A, const Mat<N, 1, T>& b, Mat<N, 1, T>& xOutput) {
+  T LU[N][N];
+  int pivot[N];
+  T x[N];
+  matCopy(A.data, LU);
+  if (!luDecompose(LU, pivot)) { return false; }
+  for (int i = 0; i < N; i++) { x[i] = b.data[i][0]; }
+  luSolve(LU, pivot, x);
+  for (int i = 0; i < N; i++) { xOutput.data[i][0] = x[i]; }
+  return true;
+}
+
+// Solve A x = b using Cholesky decomposition (A symmetric positive definite).
+// Inputs are A (N x N), b (N x 1) and vector to store output.
+// Output is x. Returns true on success, false if A is not positive definite.
+template <int N, typename T>
+inline bool solveCholesky(const Mat<N, N, T>& A, const Mat<N, 1, T>& b, Mat<N, 1, T>& xOutput) {
+  T L[N][N];
+  T x[N];
+  matCopy(A.data, L);
+  if (!choleskyDecompose(L)) { return false; }
+  for (int i = 0; i < N; i++) { x[i] = b.data[i][0]; }
+  choleskySolve(L, x);
+  for (int i = 0; i < N; i++) { xOutput.data[i][0] = x[i]; }
+  return true;
+}
+
+} // namespace mt
+
+#endif // DH_MAT_H_
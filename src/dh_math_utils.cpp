@@ -9,6 +9,9 @@
 
 #if USING_ARDUINO
 #include <Arduino.h>
+#if defined(__AVR__)
+#include <avr/pgmspace.h>
+#endif
 #else
 #include <iostream>
 #include <cmath>
@@ -17,8 +20,118 @@ using namespace std;
 
 namespace mt::DhMathUtils {
 
+namespace {
+
+// Quarter wave sine table for sincosTable(...): sin(i * (pi / 2) / 256) for i = 0 to 256.
+#if USING_ARDUINO && defined(__AVR__)
+#define DH_SINE_TABLE_READ(index) pgm_read_float(&kSineTable[index])
+const float kSineTable[257] PROGMEM = {
+#else
+#define DH_SINE_TABLE_READ(index) kSineTable[index]
+const float kSineTable[257] = {
+#endif
+  0.0f, 6.135884649e-03f, 1.227153829e-02f, 1.840672991e-02f, 2.454122852e-02f, 3.067480318e-02f,
+  3.680722294e-02f, 4.293825693e-02f, 4.906767433e-02f, 5.519524435e-02f, 6.132073630e-02f, 6.744391956e-02f,
+  7.356456360e-02f, 7.968243797e-02f, 8.579731234e-02f, 9.190895650e-02f, 9.801714033e-02f, 1.041216339e-01f,
+  1.102222073e-01f, 1.163186309e-01f, 1.224106752e-01f, 1.284981108e-01f, 1.345807085e-01f, 1.406582393e-01f,
+  1.467304745e-01f, 1.527971853e-01f, 1.588581433e-01f, 1.649131205e-01f, 1.709618888e-01f, 1.770042204e-01f,
+  1.830398880e-01f, 1.890686641e-01f, 1.950903220e-01f, 2.011046348e-01f, 2.071113762e-01f, 2.131103199e-01f,
+  2.191012402e-01f, 2.250839114e-01f, 2.310581083e-01f, 2.370236060e-01f, 2.429801799e-01f, 2.489276057e-01f,
+  2.548656596e-01f, 2.607941179e-01f, 2.667127575e-01f, 2.726213554e-01f, 2.785196894e-01f, 2.844075372e-01f,
+  2.902846773e-01f, 2.961508882e-01f, 3.020059493e-01f, 3.078496400e-01f, 3.136817404e-01f, 3.195020308e-01f,
+  3.253102922e-01f, 3.311063058e-01f, 3.368898534e-01f, 3.426607173e-01f, 3.484186802e-01f, 3.541635254e-01f,
+  3.598950365e-01f, 3.656129978e-01f, 3.713171940e-01f, 3.770074102e-01f, 3.826834324e-01f, 3.883450467e-01f,
+  3.939920401e-01f, 3.996241998e-01f, 4.052413140e-01f, 4.108431711e-01f, 4.164295601e-01f, 4.220002708e-01f,
+  4.275550934e-01f, 4.330938189e-01f, 4.386162385e-01f, 4.441221446e-01f, 4.496113297e-01f, 4.550835871e-01f,
+  4.605387110e-01f, 4.659764958e-01f, 4.713967368e-01f, 4.767992301e-01f, 4.821837721e-01f, 4.875501601e-01f,
+  4.928981922e-01f, 4.982276670e-01f, 5.035383837e-01f, 5.088301425e-01f, 5.141027442e-01f, 5.193559902e-01f,
+  5.245896827e-01f, 5.298036247e-01f, 5.349976199e-01f, 5.401714727e-01f, 5.453249884e-01f, 5.504579729e-01f,
+  5.555702330e-01f, 5.606615762e-01f, 5.657318108e-01f, 5.707807459e-01f, 5.758081914e-01f, 5.808139581e-01f,
+  5.857978575e-01f, 5.907597019e-01f, 5.956993045e-01f, 6.006164794e-01f, 6.055110414e-01f, 6.103828063e-01f,
+  6.152315906e-01f, 6.200572118e-01f, 6.248594881e-01f, 6.296382389e-01f, 6.343932842e-01f, 6.391244449e-01f,
+  6.438315429e-01f, 6.485144010e-01f, 6.531728430e-01f, 6.578066933e-01f, 6.624157776e-01f, 6.669999223e-01f,
+  6.715589548e-01f, 6.760927036e-01f, 6.806009978e-01f, 6.850836678e-01f, 6.895405447e-01f, 6.939714609e-01f,
+  6.983762494e-01f, 7.027547445e-01f, 7.071067812e-01f, 7.114321957e-01f, 7.157308253e-01f, 7.200025080e-01f,
+  7.242470830e-01f, 7.284643904e-01f, 7.326542717e-01f, 7.368165689e-01f, 7.409511254e-01f, 7.450577854e-01f,
+  7.491363945e-01f, 7.531867990e-01f, 7.572088465e-01f, 7.612023855e-01f, 7.651672656e-01f, 7.691033376e-01f,
+  7.730104534e-01f, 7.768884657e-01f, 7.807372286e-01f, 7.845565972e-01f, 7.883464276e-01f, 7.921065773e-01f,
+  7.958369046e-01f, 7.995372691e-01f, 8.032075315e-01f, 8.068475535e-01f, 8.104571983e-01f, 8.140363297e-01f,
+  8.175848132e-01f, 8.211025150e-01f, 8.245893028e-01f, 8.280450453e-01f, 8.314696123e-01f, 8.348628750e-01f,
+  8.382247056e-01f, 8.415549774e-01f, 8.448535652e-01f, 8.481203448e-01f, 8.513551931e-01f, 8.545579884e-01f,
+  8.577286100e-01f, 8.608669386e-01f, 8.639728561e-01f, 8.670462455e-01f, 8.700869911e-01f, 8.730949784e-01f,
+  8.760700942e-01f, 8.790122264e-01f, 8.819212643e-01f, 8.847970984e-01f, 8.876396204e-01f, 8.904487232e-01f,
+  8.932243012e-01f, 8.959662498e-01f, 8.986744657e-01f, 9.013488470e-01f, 9.039892931e-01f, 9.065957045e-01f,
+  9.091679831e-01f, 9.117060320e-01f, 9.142097557e-01f, 9.166790599e-01f, 9.191138517e-01f, 9.215140393e-01f,
+  9.238795325e-01f, 9.262102421e-01f, 9.285060805e-01f, 9.307669611e-01f, 9.329927988e-01f, 9.351835099e-01f,
+  9.373390119e-01f, 9.394592236e-01f, 9.415440652e-01f, 9.435934582e-01f, 9.456073254e-01f, 9.475855910e-01f,
+  9.495281806e-01f, 9.514350210e-01f, 9.533060404e-01f, 9.551411683e-01f, 9.569403357e-01f, 9.587034749e-01f,
+  9.604305194e-01f, 9.621214043e-01f, 9.637760658e-01f, 9.653944417e-01f, 9.669764710e-01f, 9.685220943e-01f,
+  9.700312532e-01f, 9.715038910e-01f, 9.729399522e-01f, 9.743393828e-01f, 9.757021300e-01f, 9.770281427e-01f,
+  9.783173707e-01f, 9.795697657e-01f, 9.807852804e-01f, 9.819638691e-01f, 9.831054874e-01f, 9.842100924e-01f,
+  9.852776424e-01f, 9.863080972e-01f, 9.873014182e-01f, 9.882575677e-01f, 9.891765100e-01f, 9.900582103e-01f,
+  9.909026354e-01f, 9.917097537e-01f, 9.924795346e-01f, 9.932119492e-01f, 9.939069700e-01f, 9.945645707e-01f,
+  9.951847267e-01f, 9.957674145e-01f, 9.963126122e-01f, 9.968202993e-01f, 9.972904567e-01f, 9.977230666e-01f,
+  9.981181129e-01f, 9.984755806e-01f, 9.987954562e-01f, 9.990777278e-01f, 9.993223846e-01f, 9.995294175e-01f,
+  9.996988187e-01f, 9.998305818e-01f, 9.999247018e-01f, 9.999811753e-01f, 1.000000000e+00f
+};
+
+constexpr int kSineTableIntervals = 256;
+
+// Reduce an angle to r in [-pi/4, pi/4] and quadrant (0 to 3) such that theta = r + quadrant * pi/2 (modulo 2pi).
+// Cody-Waite reduction: pi/2 is split into 3 parts, the first two with few significant bits so their products with the
+// quadrant count are exact, to limit cancellation error (split from the Cephes Math Library).
+void reduceQuarterPi(float theta, float& rOutput, int& quadrantOutput) {
+  const float kTwoOverPi = 0.636619772367581343f;
+  const float kPiOverTwo1 = 1.5703125f;
+  const float kPiOverTwo2 = 4.837512969970703125e-4f;
+  const float kPiOverTwo3 = 7.54978995489188216e-8f;
+  float x = theta * kTwoOverPi;
+  long k = (long)(x + ((x >= 0) ? 0.5f : -0.5f));
+  float kf = (float)k;
+  rOutput = ((theta - kf * kPiOverTwo1) - kf * kPiOverTwo2) - kf * kPiOverTwo3;
+  quadrantOutput = (int)(k & 3);
+}
+
+// Map the sine and cosine of the reduced angle to the original quadrant.
+void applyQuadrant(int quadrant, float sinR, float cosR, float& sinOutput, float& cosOutput) {
+  switch (quadrant)
+  {
+    case 0: { sinOutput = sinR; cosOutput = cosR; break; }
+    case 1: { sinOutput = cosR; cosOutput = -sinR; break; }
+    case 2: { sinOutput = -sinR; cosOutput = -cosR; break; }
+    default: { sinOutput = -cosR; cosOutput = sinR; break; }
+  }
+}
+
+// Linearly interpolated quarter wave table lookup for an angle in [0, pi/2].
+float sineTableLookup(float theta) {
+  const float kIntervalsPerRad = kSineTableIntervals / (pi / 2);
+  float position = theta * kIntervalsPerRad;
+  int index = (int)position;
+  if (index >= kSineTableIntervals) { index = kSineTableIntervals - 1; }
+  float fraction = position - index;
+  float y0 = DH_SINE_TABLE_READ(index);
+  float y1 = DH_SINE_TABLE_READ(index + 1);
+  return y0 + fraction * (y1 - y0);
+}
+
+// Below this |cos(middle angle)| the decomposition is treated as gimbal lock. It balances the error from the noise in the
+// float matrix elements (about 1e-7 / |cos|) against the error from fixing the last angle (about |cos|).
+constexpr float kGimbalLockThreshold = 2.5e-4f;
+
+// Copy the rotation of pose i of a structure of arrays (SoA) pose buffer into a transformation matrix.
+void gatherRotation(const float* const R[3][3], int i, float TmOutput[4][4]) {
+  for (int r = 0; r < 3; r++)
+  {
+    for (int c = 0; c < 3; c++) { TmOutput[r][c] = R[r][c][i]; }
+  }
+}
+
+} // namespace
+
 void rotx(float ROutput[3][3], float theta) {
-  float sint = sin(theta), cost = cos(theta);
+  float sint, cost;
+  sincos(theta, sint, cost);
   float R[3][3] = { {1, 0,    0    },
                     {0, cost, -sint},
                     {0, sint, cost } };
@@ -26,7 +139,8 @@ void rotx(float ROutput[3][3], float theta) {
 }
 
 void trotx(float TmOutput[4][4], float theta) {
-  float sint = sin(theta), cost = cos(theta);
+  float sint, cost;
+  sincos(theta, sint, cost);
   float Tm[4][4] = { {1, 0,    0,     0},
                      {0, cost, -sint, 0},
                      {0, sint, cost,  0},
@@ -35,7 +149,8 @@ void trotx(float TmOutput[4][4], float theta) {
 }
 
 void roty(float ROutput[3][3], float theta) {
-  float sint = sin(theta), cost = cos(theta);
+  float sint, cost;
+  sincos(theta, sint, cost);
   float R[3][3] = { {cost,  0, sint},
                     {0,     1, 0   },
                     {-sint, 0, cost} };
@@ -43,7 +158,8 @@ void roty(float ROutput[3][3], float theta) {
 }
 
 void troty(float TmOutput[4][4], float theta) {
-  float sint = sin(theta), cost = cos(theta);
+  float sint, cost;
+  sincos(theta, sint, cost);
   float Tm[4][4] = { {cost,  0, sint, 0},
                      {0,     1, 0,    0},
                      {-sint, 0, cost, 0},
@@ -52,7 +168,8 @@ void troty(float TmOutput[4][4], float theta) {
 }
 
 void rotz(float ROutput[3][3], float theta) {
-  float sint = sin(theta), cost = cos(theta);
+  float sint, cost;
+  sincos(theta, sint, cost);
   float R[3][3] = { {cost,  -sint, 0},
                     {sint,  cost,  0},
                     {0,     0,     1} };
@@ -60,7 +177,8 @@ void rotz(float ROutput[3][3], float theta) {
 }
 
 void trotz(float TmOutput[4][4], float theta) {
-  float sint = sin(theta), cost = cos(theta);
+  float sint, cost;
+  sincos(theta, sint, cost);
   float Tm[4][4] = { {cost,  -sint, 0, 0},
                      {sint,  cost,  0, 0},
                      {0,     0,     1, 0},
@@ -69,8 +187,10 @@ void trotz(float TmOutput[4][4], float theta) {
 }
 
 void rotxyz(float ROutput[3][3], float thetaX, float thetaY, float thetaZ) {
-  float c1 = cos(thetaX), c2 = cos(thetaY), c3 = cos(thetaZ);
-  float s1 = sin(thetaX), s2 = sin(thetaY), s3 = sin(thetaZ);
+  float s1, s2, s3, c1, c2, c3;
+  sincos(thetaX, s1, c1);
+  sincos(thetaY, s2, c2);
+  sincos(thetaZ, s3, c3);
   float R[3][3] = { {c2 * c3,                    -c2 * s3,                   s2      },
                     {(c1 * s3) + (c3 * s1 * s2), (c1 * c3) - (s1 * s2 * s3), -c2 * s1},
                     {(s1 * s3) - (c1 * c3 * s2), (c3 * s1) + (c1 * s2 * s3), c1 * c2 } };
@@ -79,8 +199,10 @@ void rotxyz(float ROutput[3][3], float thetaX, float thetaY, float thetaZ) {
 }
 
 void trotxyz(float TmOutput[4][4], float thetaX, float thetaY, float thetaZ) {
-  float c1 = cos(thetaX), c2 = cos(thetaY), c3 = cos(thetaZ);
-  float s1 = sin(thetaX), s2 = sin(thetaY), s3 = sin(thetaZ);
+  float s1, s2, s3, c1, c2, c3;
+  sincos(thetaX, s1, c1);
+  sincos(thetaY, s2, c2);
+  sincos(thetaZ, s3, c3);
   float Tm[4][4] = { {c2 * c3,                    -c2 * s3,                   s2,       0},
                      {(c1 * s3) + (c3 * s1 * s2), (c1 * c3) - (s1 * s2 * s3), -c2 * s1, 0},
                      {(s1 * s3) - (c1 * c3 * s2), (c3 * s1) + (c1 * s2 * s3), c1 * c2,  0},
@@ -89,8 +211,10 @@ void trotxyz(float TmOutput[4][4], float thetaX, float thetaY, float thetaZ) {
 }
 
 void rotzyx(float ROutput[3][3], float thetaZ, float thetaY, float thetaX) {
-  float c1 = cos(thetaZ), c2 = cos(thetaY), c3 = cos(thetaX);
-  float s1 = sin(thetaZ), s2 = sin(thetaY), s3 = sin(thetaX);
+  float s1, s2, s3, c1, c2, c3;
+  sincos(thetaZ, s1, c1);
+  sincos(thetaY, s2, c2);
+  sincos(thetaX, s3, c3);
   float R[3][3] = { {c1 * c2, (c1 * s2 * s3) - (c3 * s1), (s1 * s3) + (c1 * c3 * s2)},
                     {c2 * s1, (c1 * c3) + (s1 * s2 * s3), (c3 * s1 * s2) - (c1 * s3)},
                     {-s2,     c2 * s3,                    c2 * c3                   } };
@@ -98,8 +222,10 @@ void rotzyx(float ROutput[3][3], float thetaZ, float thetaY, float thetaX) {
 }
 
 void trotzyx(float TmOutput[4][4], float thetaZ, float thetaY, float thetaX) {
-  float c1 = cos(thetaZ), c2 = cos(thetaY), c3 = cos(thetaX);
-  float s1 = sin(thetaZ), s2 = sin(thetaY), s3 = sin(thetaX);
+  float s1, s2, s3, c1, c2, c3;
+  sincos(thetaZ, s1, c1);
+  sincos(thetaY, s2, c2);
+  sincos(thetaX, s3, c3);
   float Tm[4][4] = { {c1 * c2, (c1 * s2 * s3) - (c3 * s1), (s1 * s3) + (c1 * c3 * s2), 0},
                      {c2 * s1, (c1 * c3) + (s1 * s2 * s3), (c3 * s1 * s2) - (c1 * s3), 0},
                      {-s2,     c2 * s3,                    c2 * c3,                    0},
@@ -115,12 +241,180 @@ void transl(float TmOutput[4][4], float x, float y, float z) {
   MatrixObj.Copy((float*)Tm, 4, 4, (float*)TmOutput);
 }
 
+bool tr2xyz(float Tm[4][4], float& thetaXOutput, float& thetaYOutput, float& thetaZOutput) {
+  // Tm[0][2] = sin(thetaY), and Tm[0][0], Tm[0][1], Tm[1][2], Tm[2][2] are multiples of cos(thetaY). See trotxyz(...).
+  float cosY = sqrt(Tm[0][0] * Tm[0][0] + Tm[0][1] * Tm[0][1]);
+  thetaYOutput = atan2(Tm[0][2], cosY);
+  if (cosY > kGimbalLockThreshold)
+  {
+    thetaXOutput = atan2(-Tm[1][2], Tm[2][2]);
+    thetaZOutput = atan2(-Tm[0][1], Tm[0][0]);
+    return false;
+  }
+
+  // Gimbal lock; with thetaZ = 0, Tm[1][0] = sin(thetaX) * sin(thetaY) and Tm[1][1] = cos(thetaX).
+  thetaXOutput = atan2((Tm[0][2] >= 0) ? Tm[1][0] : -Tm[1][0], Tm[1][1]);
+  thetaZOutput = 0;
+  return true;
+}
+
+bool tr2zyx(float Tm[4][4], float& thetaZOutput, float& thetaYOutput, float& thetaXOutput) {
+  // Tm[2][0] = -sin(thetaY), and Tm[0][0], Tm[1][0], Tm[2][1], Tm[2][2] are multiples of cos(thetaY). See trotzyx(...).
+  float cosY = sqrt(Tm[0][0] * Tm[0][0] + Tm[1][0] * Tm[1][0]);
+  thetaYOutput = atan2(-Tm[2][0], cosY);
+  if (cosY > kGimbalLockThreshold)
+  {
+    thetaZOutput = atan2(Tm[1][0], Tm[0][0]);
+    thetaXOutput = atan2(Tm[2][1], Tm[2][2]);
+    return false;
+  }
+
+  // Gimbal lock; with thetaX = 0, Tm[0][1] = -sin(thetaZ) and Tm[1][1] = cos(thetaZ).
+  thetaZOutput = atan2(-Tm[0][1], Tm[1][1]);
+  thetaXOutput = 0;
+  return true;
+}
+
+bool tr2rpy(float Tm[4][4], float& rollOutput, float& pitchOutput, float& yawOutput) {
+  return tr2zyx(Tm, yawOutput, pitchOutput, rollOutput);
+}
+
+void tr2quat(float Tm[4][4], float quatOutput[4]) {
+  // Shepperd's method: divide by the largest of 4w^2, 4x^2, 4y^2 and 4z^2 for accuracy.
+  float w, x, y, z;
+  float trace = Tm[0][0] + Tm[1][1] + Tm[2][2];
+  if (trace > 0)
+  {
+    float s = 2 * sqrt(1 + trace); // 4w.
+    w = 0.25 * s; x = (Tm[2][1] - Tm[1][2]) / s; y = (Tm[0][2] - Tm[2][0]) / s; z = (Tm[1][0] - Tm[0][1]) / s;
+  }
+  else if (Tm[0][0] > Tm[1][1] && Tm[0][0] > Tm[2][2])
+  {
+    float s = 2 * sqrt(1 + Tm[0][0] - Tm[1][1] - Tm[2][2]); // 4x.
+    w = (Tm[2][1] - Tm[1][2]) / s; x = 0.25 * s; y = (Tm[0][1] + Tm[1][0]) / s; z = (Tm[0][2] + Tm[2][0]) / s;
+  }
+  else if (Tm[1][1] > Tm[2][2])
+  {
+    float s = 2 * sqrt(1 + Tm[1][1] - Tm[0][0] - Tm[2][2]); // 4y.
+    w = (Tm[0][2] - Tm[2][0]) / s; x = (Tm[0][1] + Tm[1][0]) / s; y = 0.25 * s; z = (Tm[1][2] + Tm[2][1]) / s;
+  }
+  else
+  {
+    float s = 2 * sqrt(1 + Tm[2][2] - Tm[0][0] - Tm[1][1]); // 4z.
+    w = (Tm[1][0] - Tm[0][1]) / s; x = (Tm[0][2] + Tm[2][0]) / s; y = (Tm[1][2] + Tm[2][1]) / s; z = 0.25 * s;
+  }
+
+  // q and -q are the same rotation.
+  float sign = (w < 0) ? -1 : 1;
+  quatOutput[0] = sign * w;
+  quatOutput[1] = sign * x;
+  quatOutput[2] = sign * y;
+  quatOutput[3] = sign * z;
+}
+
+void tr2angvec(float Tm[4][4], float& thetaOutput, float axisOutput[3]) {
+  // From the quaternion, which is accurate for all angles (unlike acos((trace - 1) / 2) near 0 and pi).
+  float quat[4];
+  tr2quat(Tm, quat);
+  float sinHalfTheta = sqrt(quat[1] * quat[1] + quat[2] * quat[2] + quat[3] * quat[3]);
+  thetaOutput = 2 * atan2(sinHalfTheta, quat[0]); // (rad).
+  if (sinHalfTheta > 0)
+  {
+    for (int i = 0; i < 3; i++) { axisOutput[i] = quat[i + 1] / sinHalfTheta; }
+  }
+  else
+  {
+    axisOutput[0] = 0;
+    axisOutput[1] = 0;
+    axisOutput[2] = 1;
+  }
+}
+
+void tr2xyzBatch(const float* const R[3][3], float thetaXOutput[], float thetaYOutput[], float thetaZOutput[], int noOfPoses) {
+  float Tm[4][4];
+  for (int i = 0; i < noOfPoses; i++)
+  {
+    gatherRotation(R, i, Tm);
+    tr2xyz(Tm, thetaXOutput[i], thetaYOutput[i], thetaZOutput[i]);
+  }
+}
+
+void tr2zyxBatch(const float* const R[3][3], float thetaZOutput[], float thetaYOutput[], float thetaXOutput[], int noOfPoses) {
+  float Tm[4][4];
+  for (int i = 0; i < noOfPoses; i++)
+  {
+    gatherRotation(R, i, Tm);
+    tr2zyx(Tm, thetaZOutput[i], thetaYOutput[i], thetaXOutput[i]);
+  }
+}
+
+void tr2quatBatch(const float* const R[3][3], float* const quatOutput[4], int noOfPoses) {
+  float Tm[4][4], quat[4];
+  for (int i = 0; i < noOfPoses; i++)
+  {
+    gatherRotation(R, i, Tm);
+    tr2quat(Tm, quat);
+    for (int k = 0; k < 4; k++) { quatOutput[k][i] = quat[k]; }
+  }
+}
+
+void tr2angvecBatch(const float* const R[3][3], float thetaOutput[], float* const axisOutput[3], int noOfPoses) {
+  float Tm[4][4], axis[3];
+  for (int i = 0; i < noOfPoses; i++)
+  {
+    gatherRotation(R, i, Tm);
+    tr2angvec(Tm, thetaOutput[i], axis);
+    for (int k = 0; k < 3; k++) { axisOutput[k][i] = axis[k]; }
+  }
+}
+
+void sincosPrecise(float theta, float& sinOutput, float& cosOutput) {
+  sinOutput = sin(theta);
+  cosOutput = cos(theta);
+}
+
+void sincosPolynomial(float theta, float& sinOutput, float& cosOutput) {
+  float r;
+  int quadrant;
+  reduceQuarterPi(theta, r, quadrant);
+
+  // Minimax polynomial coefficients for [-pi/4, pi/4] from the Cephes Math Library (sinf.c and cosf.c), Stephen L. Moshier.
+  float z = r * r;
+  float sinR = r + r * z * (-1.6666654611e-1f + z * (8.3321608736e-3f + z * -1.9515295891e-4f));
+  float cosR = 1.0f - 0.5f * z + z * z * (4.166664568298827e-2f + z * (-1.388731625493765e-3f + z * 2.443315711809948e-5f));
+  applyQuadrant(quadrant, sinR, cosR, sinOutput, cosOutput);
+}
+
+void sincosTable(float theta, float& sinOutput, float& cosOutput) {
+  float r;
+  int quadrant;
+  reduceQuarterPi(theta, r, quadrant);
+
+  float rAbs = (r < 0) ? -r : r;
+  float sinR = sineTableLookup(rAbs);
+  float cosR = sineTableLookup((float)(pi / 2) - rAbs);
+  if (r < 0) { sinR = -sinR; }
+  applyQuadrant(quadrant, sinR, cosR, sinOutput, cosOutput);
+}
+
 float atan3(float num, float denom) {
   float theta = atan2(num, denom); // (rad).
   if (theta < 0) { theta = 2.0 * pi + theta; }
   return theta; // (rad).
 }
 
+float wrapToPi(float theta) {
+  float thetaWrapped = theta - 2.0 * pi * floor((theta + pi) / (2.0 * pi));
+  if (thetaWrapped >= pi) { thetaWrapped -= 2.0 * pi; } // Rounding.
+  return thetaWrapped; // (rad).
+}
+
+float wrapTo2Pi(float theta) {
+  float thetaWrapped = theta - 2.0 * pi * floor(theta / (2.0 * pi));
+  if (thetaWrapped >= 2.0 * pi) { thetaWrapped -= 2.0 * pi; } // Rounding.
+  return thetaWrapped; // (rad).
+}
+
 float rad2deg(float thetaRad) {
   return (thetaRad * 180.0) / pi; // (deg).
 }
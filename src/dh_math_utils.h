@@ -13,6 +13,17 @@
 #define USING_ARDUINO 0
 #endif
 
+// Accuracy tiers of the sincos(...) function used throughout the library.
+#define DH_SINCOS_TIER_PRECISE 0    // Standard library sin(...) and cos(...).
+#define DH_SINCOS_TIER_POLYNOMIAL 1 // Minimax polynomials. See sincosPolynomial(...).
+#define DH_SINCOS_TIER_TABLE 2      // Lookup table with linear interpolation. See sincosTable(...).
+
+// The sincos(...) tier is selected at compile time for the whole library by defining DH_SINCOS_TIER in the build flags
+// e.g. -DDH_SINCOS_TIER=1. The default is the precise tier.
+#ifndef DH_SINCOS_TIER
+#define DH_SINCOS_TIER DH_SINCOS_TIER_PRECISE
+#endif
+
 // Namespace to encapsulate math functions.
 namespace mt::DhMathUtils {
 
@@ -79,13 +90,94 @@ void trotzyx(float TmOutput[4][4], float thetaZ, float thetaY, float thetaX);
 // Output is transformation matrix with a unit/identity rotation matrix.
 void transl(float TmOutput[4][4], float x, float y, float z);
 
+// Pose Decomposition
+
+// The angles of the following functions are unique except in gimbal lock (middle rotation of +/-90 deg), where only the
+// sum or difference of the first and last angle is defined; the last angle of the sequence is then set to 0.
+// Max. error is about 5e-4 rad near gimbal lock and float round off elsewhere.
+
+// Extract the x, y and z rotation angles of trotxyz(...) from a transformation matrix.
+// Inputs are 4 x 4 transformation matrix and variables to store output.
+// Outputs are angles in rad; thetaX and thetaZ in [-pi, pi], thetaY in [-pi/2, pi/2]. Returns true if in gimbal lock.
+bool tr2xyz(float Tm[4][4], float& thetaXOutput, float& thetaYOutput, float& thetaZOutput);
+
+// Extract the z, y and x rotation angles of trotzyx(...) from a transformation matrix.
+// Inputs are 4 x 4 transformation matrix and variables to store output.
+// Outputs are angles in rad; thetaZ and thetaX in [-pi, pi], thetaY in [-pi/2, pi/2]. Returns true if in gimbal lock.
+bool tr2zyx(float Tm[4][4], float& thetaZOutput, float& thetaYOutput, float& thetaXOutput);
+
+// Extract the roll, pitch and yaw angles (rotations about the fixed x, y and z axes respectively, i.e. the same rotation
+// as trotzyx(yaw, pitch, roll)) from a transformation matrix.
+// Inputs are 4 x 4 transformation matrix and variables to store output.
+// Outputs are angles in rad; roll and yaw in [-pi, pi], pitch in [-pi/2, pi/2]. Returns true if in gimbal lock.
+bool tr2rpy(float Tm[4][4], float& rollOutput, float& pitchOutput, float& yawOutput);
+
+// Extract the unit quaternion of the rotation of a transformation matrix.
+// Inputs are 4 x 4 transformation matrix and array to store output.
+// Output is quaternion (w, x, y, z) with w >= 0.
+void tr2quat(float Tm[4][4], float quatOutput[4]);
+
+// Extract the axis-angle representation of the rotation of a transformation matrix.
+// Inputs are 4 x 4 transformation matrix, variable and array to store output.
+// Outputs are angle in rad in [0, pi] and unit axis (x, y, z); the axis is (0, 0, 1) if the angle is 0.
+void tr2angvec(float Tm[4][4], float& thetaOutput, float axisOutput[3]);
+
+// Batch versions of the pose decomposition functions for structure of arrays (SoA) pose buffers, e.g. in logging
+// pipelines. R[r][c] is the array of rotation matrix element (r, c) of all poses, and each output is an array over poses.
+// Inputs are rotation element arrays, arrays to store output and no. of poses.
+// Outputs are as the single pose versions. For roll, pitch and yaw use tr2zyxBatch(R, yaw, pitch, roll, noOfPoses).
+void tr2xyzBatch(const float* const R[3][3], float thetaXOutput[], float thetaYOutput[], float thetaZOutput[], int noOfPoses);
+void tr2zyxBatch(const float* const R[3][3], float thetaZOutput[], float thetaYOutput[], float thetaXOutput[], int noOfPoses);
+void tr2quatBatch(const float* const R[3][3], float* const quatOutput[4], int noOfPoses);
+void tr2angvecBatch(const float* const R[3][3], float thetaOutput[], float* const axisOutput[3], int noOfPoses);
+
 // Trigonometry
 
+// Calculate the sine and cosine of an angle using the standard library (precise tier).
+// Inputs are angle in rad and variables to store output.
+// Outputs are sine and cosine.
+void sincosPrecise(float theta, float& sinOutput, float& cosOutput);
+
+// Calculate the sine and cosine of an angle using minimax polynomials (polynomial tier).
+// Inputs are angle in rad and variables to store output.
+// Outputs are sine and cosine. Max absolute error is 1.2e-7 for |angle| <= 100 rad (grows slowly with |angle| beyond this
+// due to float range reduction).
+void sincosPolynomial(float theta, float& sinOutput, float& cosOutput);
+
+// Calculate the sine and cosine of an angle using a 257 entry quarter wave lookup table with linear interpolation (table tier).
+// The table (1 kB) is stored in flash (program) memory on AVR based Arduino boards.
+// Inputs are angle in rad and variables to store output.
+// Outputs are sine and cosine. Max absolute error is 4.8e-6 for |angle| <= 100 rad.
+void sincosTable(float theta, float& sinOutput, float& cosOutput);
+
+// Calculate the sine and cosine of an angle using the tier selected by DH_SINCOS_TIER.
+// Inputs are angle in rad and variables to store output.
+// Outputs are sine and cosine.
+inline void sincos(float theta, float& sinOutput, float& cosOutput) {
+#if DH_SINCOS_TIER == DH_SINCOS_TIER_POLYNOMIAL
+  sincosPolynomial(theta, sinOutput, cosOutput);
+#elif DH_SINCOS_TIER == DH_SINCOS_TIER_TABLE
+  sincosTable(theta, sinOutput, cosOutput);
+#else
+  sincosPrecise(theta, sinOutput, cosOutput);
+#endif
+}
+
 // Remap the value of atan2 from [-pi, +pi] to [0, 2pi] rad i.e. [-180, 180] to [0, 360] deg.
 // Inputs are atan2 numerator and denominator. 
 // Output is angle in rad.
 float atan3(float num, float denom);
 
+// Wrap an angle to [-pi, pi) rad i.e. [-180, 180) deg.
+// Input is angle in rad.
+// Output is angle in rad.
+float wrapToPi(float theta);
+
+// Wrap an angle to [0, 2pi) rad i.e. [0, 360) deg; the same range as atan3(...).
+// Input is angle in rad.
+// Output is angle in rad.
+float wrapTo2Pi(float theta);
+
 // Convert radians to degrees.
 // Input is angle in rad. 
 // Output is angle in deg.
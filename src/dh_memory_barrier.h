@@ -0,0 +1,32 @@
+// Copyright (C) 2015 - 2020 Joseph Morgridge
+//
+// Licensed under GNU General Public License v3.0 (GPLv3) License.
+// See the LICENSE file in the project root for full license details.
+
+#ifndef DH_MEMORY_BARRIER_H_
+#define DH_MEMORY_BARRIER_H_
+
+#if __has_include(<Arduino.h>)
+#include <Arduino.h>
+#define USING_ARDUINO 1
+#else
+#define USING_ARDUINO 0
+#endif
+
+namespace mt {
+
+// Full memory barrier between the plain (non-atomic) data accesses and the index/sequence accesses of the lock-free
+// buffers shared with an ISR or another core (pose snapshots, setpoint and sample ring buffers). Neither the compiler
+// nor the hardware moves memory accesses across it. AVR boards are single core, so a compiler barrier is sufficient
+// against ISRs there; multi-core boards (e.g. ESP32, RP2040) and desktop platforms need a hardware fence.
+inline void dhMemoryBarrier() {
+#if defined(__AVR__)
+  asm volatile("" ::: "memory");
+#else
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+#endif
+}
+
+} // namespace mt
+
+#endif // DH_MEMORY_BARRIER_H_
@@ -0,0 +1,417 @@
+// Copyright (C) 2015 - 2020 Joseph Morgridge
+//
+// Licensed under GNU General Public License v3.0 (GPLv3) License.
+// See the LICENSE file in the project root for full license details.
+
+#include "dh_motion_planner.h"
+
+#include "dh_kinematic_chain.h"
+#include "dh_collision.h"
+#include "dh_math_utils.h"
+
+#if USING_ARDUINO
+#include <Arduino.h>
+#else
+#include <cmath>
+#include <thread>
+using namespace std;
+#endif
+
+namespace mt {
+
+#if !USING_ARDUINO
+namespace {
+
+// No. of yields a shortcut worker spins for the next round before it sleeps.
+const int workerSpinCount = 20000;
+
+} // namespace
+#endif
+
+DhRrtConnectPlanner::DhRrtConnectPlanner(DhKinematicChain& chainInput, DhRrtNode nodeArenaInput[], int arenaCapacityInput):
+chain(chainInput), nodeArena(nodeArenaInput), arenaCapacity(arenaCapacityInput) {
+  noOfLinks = chain.get_noOfLinks();
+  for (int i = 0; i < maxLinks; i++)
+  {
+    qMin[i] = -DhMathUtils::pi;
+    qMax[i] = DhMathUtils::pi;
+  }
+}
+
+#if !USING_ARDUINO
+DhRrtConnectPlanner::~DhRrtConnectPlanner() { stopWorkers(); }
+#endif
+
+void DhRrtConnectPlanner::set_collisionCallback(DhCollisionCallback callback, void* context) {
+  collisionCallback = callback;
+  collisionContext = context;
+}
+
+void DhRrtConnectPlanner::set_samplingBounds(float qMinInput[], float qMaxInput[]) {
+  for (int i = 0; i < noOfLinks; i++)
+  {
+    qMin[i] = qMinInput[i]; // (rad).
+    qMax[i] = qMaxInput[i]; // (rad).
+  }
+}
+
+void DhRrtConnectPlanner::set_stepSize(float stepSizeInput) { stepSize = stepSizeInput; }
+
+void DhRrtConnectPlanner::set_edgeResolution(float edgeResolutionInput) { edgeResolution = edgeResolutionInput; }
+
+void DhRrtConnectPlanner::set_maxIterations(long maxIterationsInput) { maxIterations = maxIterationsInput; }
+
+void DhRrtConnectPlanner::set_shortcutIterations(int shortcutIterationsInput) { shortcutIterations = shortcutIterationsInput; }
+
+void DhRrtConnectPlanner::set_noOfShortcutThreads(int noOfThreadsInput) {
+  if (noOfThreadsInput < 1) { noOfThreadsInput = 1; }
+  if (noOfThreadsInput > maxShortcutThreads) { noOfThreadsInput = maxShortcutThreads; }
+
+#if !USING_ARDUINO
+  stopWorkers();
+  noOfShortcutThreads = noOfThreadsInput;
+  startWorkers();
+#else
+  noOfShortcutThreads = noOfThreadsInput;
+#endif
+}
+
+void DhRrtConnectPlanner::set_seed(unsigned long seedInput) { seed = seedInput; }
+
+int DhRrtConnectPlanner::get_noOfNodes() { return noOfNodes; }
+
+bool DhRrtConnectPlanner::collisionModelCallback(float qInput[], void* context) {
+  return static_cast<DhCollisionModel*>(context)->checkCollision(qInput);
+}
+
+float DhRrtConnectPlanner::randomUniform() {
+  // 32-bit xorshift (the state is masked since unsigned long may be wider than 32 bits).
+  unsigned long x = rngState;
+  x ^= (x << 13) & 0xFFFFFFFFUL;
+  x ^= x >> 17;
+  x ^= (x << 5) & 0xFFFFFFFFUL;
+  rngState = x;
+  return (float)(x >> 8) * (1.0f / 16777216.0f);
+}
+
+float DhRrtConnectPlanner::jointDistanceSquared(const float q1[], const float q2[]) {
+  float distanceSquared = 0;
+  for (int i = 0; i < noOfLinks; i++)
+  {
+    float dq = q1[i] - q2[i];
+    distanceSquared += dq * dq;
+  }
+  return distanceSquared;
+}
+
+int DhRrtConnectPlanner::addNode(int tree, const float qInput[], int parent) {
+  if (noOfNodes >= arenaCapacity) { return -1; }
+
+  // Bump allocate from the arena.
+  int nodeIndex = noOfNodes++;
+  DhRrtNode& node = nodeArena[nodeIndex];
+  for (int i = 0; i < noOfLinks; i++)
+  {
+    node.q[i] = qInput[i];
+  }
+  node.parent = parent;
+  node.left = -1;
+  node.right = -1;
+
+  // Insert into the trees k-d tree (split axis cycles through the joints with depth).
+  if (treeRoot[tree] < 0)
+  {
+    treeRoot[tree] = nodeIndex;
+    return nodeIndex;
+  }
+
+  int current = treeRoot[tree];
+  int depth = 0;
+  while (true)
+  {
+    int axis = depth % noOfLinks;
+    int& child = (qInput[axis] < nodeArena[current].q[axis]) ? nodeArena[current].left : nodeArena[current].right;
+    if (child < 0)
+    {
+      child = nodeIndex;
+      break;
+    }
+    current = child;
+    depth++;
+  }
+
+  return nodeIndex;
+}
+
+void DhRrtConnectPlanner::nearestNode(int nodeIndex, int depth, const float qInput[], int& bestIndex, float& bestDistanceSquared) {
+  if (nodeIndex < 0) { return; }
+
+  const DhRrtNode& node = nodeArena[nodeIndex];
+  float distanceSquared = jointDistanceSquared(node.q, qInput);
+  if (distanceSquared < bestDistanceSquared)
+  {
+    bestDistanceSquared = distanceSquared;
+    bestIndex = nodeIndex;
+  }
+
+  // Search the side containing the query first, then the other side only if it could hold a closer node.
+  int axis = depth % noOfLinks;
+  float dAxis = qInput[axis] - node.q[axis];
+  int nearSide = (dAxis < 0) ? node.left : node.right;
+  int farSide = (dAxis < 0) ? node.right : node.left;
+  nearestNode(nearSide, depth + 1, qInput, bestIndex, bestDistanceSquared);
+  if (dAxis * dAxis < bestDistanceSquared) { nearestNode(farSide, depth + 1, qInput, bestIndex, bestDistanceSquared); }
+}
+
+bool DhRrtConnectPlanner::edgeIsFree(const float qStart[], const float qEnd[]) {
+  float maxDelta = 0;
+  for (int i = 0; i < noOfLinks; i++)
+  {
+    float delta = fabs(qEnd[i] - qStart[i]);
+    if (delta > maxDelta) { maxDelta = delta; }
+  }
+
+  int noOfSteps = (int)ceil(maxDelta / edgeResolution);
+  if (noOfSteps < 1) { noOfSteps = 1; }
+
+  float q[maxLinks];
+  for (int step = 1; step <= noOfSteps; step++)
+  {
+    float s = (float)step / noOfSteps;
+    for (int i = 0; i < noOfLinks; i++)
+    {
+      q[i] = qStart[i] + s * (qEnd[i] - qStart[i]);
+    }
+    if (collisionCallback(q, collisionContext)) { return false; }
+  }
+
+  return true;
+}
+
+DhRrtConnectPlanner::ExtendResult DhRrtConnectPlanner::extend(int tree, const float qTarget[], int& newNodeOutput) {
+  int nearest = -1;
+  float nearestDistanceSquared = 3.4e38;
+  nearestNode(treeRoot[tree], 0, qTarget, nearest, nearestDistanceSquared);
+
+  const float* qNear = nodeArena[nearest].q;
+  float qNew[maxLinks];
+  ExtendResult result = kReached;
+
+  if (nearestDistanceSquared > stepSize * stepSize)
+  {
+    float scale = stepSize / sqrt(nearestDistanceSquared);
+    for (int i = 0; i < noOfLinks; i++)
+    {
+      qNew[i] = qNear[i] + scale * (qTarget[i] - qNear[i]);
+    }
+    result = kAdvanced;
+  }
+  else
+  {
+    for (int i = 0; i < noOfLinks; i++)
+    {
+      qNew[i] = qTarget[i];
+    }
+  }
+
+  if (!edgeIsFree(qNear, qNew)) { return kTrapped; }
+
+  newNodeOutput = addNode(tree, qNew, nearest);
+  if (newNodeOutput < 0) { return kTrapped; }
+  return result;
+}
+
+DhRrtConnectPlanner::ExtendResult DhRrtConnectPlanner::connect(int tree, const float qTarget[], int& newNodeOutput) {
+  ExtendResult result = kAdvanced;
+  while (result == kAdvanced)
+  {
+    result = extend(tree, qTarget, newNodeOutput);
+  }
+  return result;
+}
+
+int DhRrtConnectPlanner::plan(float qStartInput[], float qGoalInput[], float qPathOutput[], int maxPathPoints) {
+  noOfNodes = 0;
+  treeRoot[0] = -1;
+  treeRoot[1] = -1;
+  rngState = (seed & 0xFFFFFFFFUL) ? (seed & 0xFFFFFFFFUL) : 1;
+
+  if (collisionCallback == nullptr || maxPathPoints < 2) { return 0; }
+  if (collisionCallback(qStartInput, collisionContext) || collisionCallback(qGoalInput, collisionContext)) { return 0; }
+  if (addNode(0, qStartInput, -1) < 0 || addNode(1, qGoalInput, -1) < 0) { return 0; }
+
+  int treeA = 0; // Tree being extended towards the random sample.
+  float qRandom[maxLinks];
+
+  for (long iteration = 0; iteration < maxIterations && noOfNodes < arenaCapacity; iteration++)
+  {
+    for (int i = 0; i < noOfLinks; i++)
+    {
+      qRandom[i] = qMin[i] + randomUniform() * (qMax[i] - qMin[i]);
+    }
+
+    int newNodeA = -1;
+    if (extend(treeA, qRandom, newNodeA) != kTrapped)
+    {
+      int newNodeB = -1;
+      int treeB = 1 - treeA;
+      if (connect(treeB, nodeArena[newNodeA].q, newNodeB) == kReached)
+      {
+        // Trees are connected; walk both back to their roots.
+        int startSideNode = (treeA == 0) ? newNodeA : newNodeB;
+        int goalSideNode = (treeA == 0) ? newNodeB : newNodeA;
+
+        int noOfStartSidePoints = 0;
+        for (int n = startSideNode; n >= 0; n = nodeArena[n].parent) { noOfStartSidePoints++; }
+        int noOfPathPoints = noOfStartSidePoints;
+        for (int n = nodeArena[goalSideNode].parent; n >= 0; n = nodeArena[n].parent) { noOfPathPoints++; } // Skip the shared point.
+        if (noOfPathPoints > maxPathPoints) { return -1; } // Output array too small.
+
+        int point = noOfStartSidePoints - 1;
+        for (int n = startSideNode; n >= 0; n = nodeArena[n].parent, point--)
+        {
+          for (int i = 0; i < noOfLinks; i++) { qPathOutput[point * noOfLinks + i] = nodeArena[n].q[i]; }
+        }
+        point = noOfStartSidePoints;
+        for (int n = nodeArena[goalSideNode].parent; n >= 0; n = nodeArena[n].parent, point++)
+        {
+          for (int i = 0; i < noOfLinks; i++) { qPathOutput[point * noOfLinks + i] = nodeArena[n].q[i]; }
+        }
+
+        return shortcutPath(qPathOutput, noOfPathPoints);
+      }
+    }
+
+    treeA = 1 - treeA; // Swap trees.
+  }
+
+  return 0;
+}
+
+int DhRrtConnectPlanner::shortcutPath(float qPath[], int noOfPathPoints) {
+  // Each round draws a fixed batch of candidate shortcuts (independent of the no. of threads) and checks them concurrently.
+  // Successful, non-overlapping shortcuts are then applied in candidate order, so the result is deterministic.
+  const int batchSize = maxShortcutThreads;
+  roundPath = qPath;
+
+  for (int attempt = 0; attempt < shortcutIterations && noOfPathPoints > 2; attempt += batchSize)
+  {
+    for (int c = 0; c < batchSize; c++)
+    {
+      int i = (int)(randomUniform() * noOfPathPoints);
+      int j = (int)(randomUniform() * noOfPathPoints);
+      if (i > j) { int temp = i; i = j; j = temp; }
+      candidateStart[c] = i;
+      candidateEnd[c] = j;
+      candidateFree[c] = false;
+    }
+
+#if USING_ARDUINO
+    for (int c = 0; c < batchSize; c++) { checkCandidate(c); }
+#else
+    // Publish the round (the stores are ordered before the generation increment), work on it and wait for the workers.
+    noOfCandidatesDone.store(0);
+    nextCandidate.store(0);
+    if (noOfShortcutThreads > 1)
+    {
+      roundGeneration.fetch_add(1);
+      lock_guard<mutex> lock(poolMutex);
+      if (noOfSleepingWorkers > 0) { poolCondition.notify_all(); }
+    }
+    checkCandidates();
+    while (noOfCandidatesDone.load() < batchSize) { this_thread::yield(); }
+#endif
+
+    // Select non-overlapping shortcuts in candidate order.
+    bool accepted[batchSize];
+    for (int c = 0; c < batchSize; c++)
+    {
+      accepted[c] = candidateFree[c];
+      for (int a = 0; a < c && accepted[c]; a++)
+      {
+        if (accepted[a] && candidateStart[c] < candidateEnd[a] && candidateStart[a] < candidateEnd[c]) { accepted[c] = false; }
+      }
+    }
+
+    // Remove the bypassed points, starting from the end of the path so the remaining indexes stay valid.
+    while (true)
+    {
+      int last = -1;
+      for (int c = 0; c < batchSize; c++)
+      {
+        if (accepted[c] && (last < 0 || candidateStart[c] > candidateStart[last])) { last = c; }
+      }
+      if (last < 0) { break; }
+      accepted[last] = false;
+
+      int noOfRemoved = candidateEnd[last] - candidateStart[last] - 1;
+      for (int k = (candidateStart[last] + 1) * noOfLinks; k < (noOfPathPoints - noOfRemoved) * noOfLinks; k++)
+      {
+        qPath[k] = qPath[k + noOfRemoved * noOfLinks];
+      }
+      noOfPathPoints -= noOfRemoved;
+    }
+  }
+
+  return noOfPathPoints;
+}
+
+void DhRrtConnectPlanner::checkCandidate(int candidate) {
+  if (candidateEnd[candidate] - candidateStart[candidate] < 2) { return; }
+  candidateFree[candidate] = edgeIsFree(&roundPath[candidateStart[candidate] * noOfLinks], &roundPath[candidateEnd[candidate] * noOfLinks]);
+}
+
+#if !USING_ARDUINO
+void DhRrtConnectPlanner::checkCandidates() {
+  int candidate;
+  while ((candidate = nextCandidate.fetch_add(1)) < maxShortcutThreads)
+  {
+    checkCandidate(candidate);
+    noOfCandidatesDone.fetch_add(1);
+  }
+}
+
+void DhRrtConnectPlanner::workerLoop() {
+  uint32_t generation = roundGeneration.load();
+  while (true)
+  {
+    // Spin briefly (rounds normally follow each other closely), then sleep until the next round.
+    int spin = 0;
+    while (roundGeneration.load() == generation && !poolStopping.load() && spin < workerSpinCount)
+    {
+      this_thread::yield();
+      spin++;
+    }
+    if (roundGeneration.load() == generation && !poolStopping.load())
+    {
+      unique_lock<mutex> lock(poolMutex);
+      noOfSleepingWorkers++;
+      poolCondition.wait(lock, [&]() { return roundGeneration.load() != generation || poolStopping.load(); });
+      noOfSleepingWorkers--;
+    }
+
+    if (poolStopping.load()) { return; }
+    generation = roundGeneration.load();
+    checkCandidates();
+  }
+}
+
+void DhRrtConnectPlanner::startWorkers() {
+  for (int t = 1; t < noOfShortcutThreads; t++) { workers[t] = thread(&DhRrtConnectPlanner::workerLoop, this); }
+}
+
+void DhRrtConnectPlanner::stopWorkers() {
+  {
+    lock_guard<mutex> lock(poolMutex);
+    poolStopping.store(true);
+  }
+  poolCondition.notify_all();
+  for (int t = 1; t < noOfShortcutThreads; t++)
+  {
+    if (workers[t].joinable()) { workers[t].join(); }
+  }
+  poolStopping.store(false);
+}
+#endif
+
+} // namespace mt
@@ -0,0 +1,205 @@
+// Copyright (C) 2015 - 2020 Joseph Morgridge
+//
+// Licensed under GNU General Public License v3.0 (GPLv3) License.
+// See the LICENSE file in the project root for full license details.
+
+#ifndef DH_MOTION_PLANNER_H_
+#define DH_MOTION_PLANNER_H_
+
+#include "dh_kinematic_chain.h"
+
+#if __has_include(<Arduino.h>)
+#include <Arduino.h>
+#define USING_ARDUINO 1
+#else
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#define USING_ARDUINO 0
+#endif
+
+namespace mt {
+
+// Collision check callback.
+// Inputs are array of joint angles in rad and user context (e.g. a DhCollisionModel object).
+// Output must be true if the joint angles are in collision.
+typedef bool (*DhCollisionCallback)(float qInput[], void* context);
+
+// Tree node for the RRT-Connect planner.
+// Nodes are allocated from a caller supplied arena (array), so the planner performs no dynamic memory allocation.
+struct DhRrtNode {
+  float q[DhKinematicChain::maxLinks]; // Joint angles in rad.
+  int parent = -1; // Parent node index (-1 for a tree root).
+  int left = -1;   // Nearest neighbour (k-d tree) child node indexes.
+  int right = -1;
+};
+
+// Class to encapsulate a sampling-based joint space motion planner (RRT-Connect).
+// Reference:
+// Kuffner, J.J. and LaValle, S.M. (2000) RRT-Connect: An Efficient Approach to Single-Query Path Planning.
+// Proceedings of the IEEE International Conference on Robotics and Automation, pp. 995-1001.
+class DhRrtConnectPlanner {
+
+ public:
+
+  // General Constants
+  static const int maxLinks = DhKinematicChain::maxLinks;
+  static const int maxShortcutThreads = 8;
+
+ private:
+
+  // Extend operation results.
+  enum ExtendResult { kTrapped, kAdvanced, kReached };
+
+  // General Parameters
+  DhKinematicChain& chain;
+  int noOfLinks = 0;
+
+  // Node Arena Parameters
+  DhRrtNode* nodeArena;
+  int arenaCapacity = 0;
+  int noOfNodes = 0;
+  int treeRoot[2] = {-1, -1}; // Start tree and goal tree k-d tree roots.
+
+  // Planner Parameters
+  DhCollisionCallback collisionCallback = nullptr;
+  void* collisionContext = nullptr;
+  float qMin[maxLinks]; // Sampling bounds (rad).
+  float qMax[maxLinks];
+  float stepSize = 0.2;        // Maximum joint space distance of a single tree extension (rad).
+  float edgeResolution = 0.02; // Maximum joint angle change between collision checks along an edge (rad).
+  long maxIterations = 5000;
+  int shortcutIterations = 100;
+  int noOfShortcutThreads = 1;
+  unsigned long seed = 1;
+  unsigned long rngState = 1;
+
+  // Shortcut Round Parameters (see shortcutPath(...))
+  int candidateStart[maxShortcutThreads];
+  int candidateEnd[maxShortcutThreads];
+  bool candidateFree[maxShortcutThreads];
+  const float* roundPath = nullptr;
+
+#if !USING_ARDUINO
+  // Shortcut Thread Pool
+  std::thread workers[maxShortcutThreads];
+  std::mutex poolMutex;
+  std::condition_variable poolCondition;
+  int noOfSleepingWorkers = 0; // Workers spin on roundGeneration for a while after each round, then sleep.
+  std::atomic<bool> poolStopping{false};
+  std::atomic<uint32_t> roundGeneration{0};
+  std::atomic<int> nextCandidate{0};
+  std::atomic<int> noOfCandidatesDone{0};
+#endif
+
+  // Generate a uniformly distributed random number in the range [0, 1) (xorshift32; deterministic for a given seed).
+  float randomUniform();
+
+  // Calculate the square of the joint space distance between two sets of joint angles.
+  float jointDistanceSquared(const float q1[], const float q2[]);
+
+  // Allocate a node from the arena and insert it into a tree.
+  // Output is node index or -1 if the arena is full.
+  int addNode(int tree, const float qInput[], int parent);
+
+  // Find the nearest node in a tree.
+  void nearestNode(int nodeIndex, int depth, const float qInput[], int& bestIndex, float& bestDistanceSquared);
+
+  // Extend a tree one step towards the specified joint angles.
+  ExtendResult extend(int tree, const float qTarget[], int& newNodeOutput);
+
+  // Repeatedly extend a tree towards the specified joint angles until reached or trapped.
+  ExtendResult connect(int tree, const float qTarget[], int& newNodeOutput);
+
+  // Check whether the straight joint space edge between two sets of joint angles is collision free.
+  // The start joint angles are assumed to be collision free.
+  bool edgeIsFree(const float qStart[], const float qEnd[]);
+
+  // Check a candidate shortcut of the current round.
+  void checkCandidate(int candidate);
+
+#if !USING_ARDUINO
+  // Take and check candidate shortcuts until there are none left in the current round.
+  void checkCandidates();
+
+  // Shortcut worker thread main loop.
+  void workerLoop();
+
+  // Start or stop the shortcut worker threads.
+  void startWorkers();
+  void stopWorkers();
+#endif
+
+ public:
+
+  // Constructors
+
+  // Inputs are the robots kinematic model, array of nodes to use as the tree node arena, and the arena size.
+  // The arena size limits the number of nodes (samples) both trees can hold.
+  DhRrtConnectPlanner(DhKinematicChain& chainInput, DhRrtNode nodeArenaInput[], int arenaCapacityInput);
+
+#if !USING_ARDUINO
+  DhRrtConnectPlanner(const DhRrtConnectPlanner&) = delete;
+  DhRrtConnectPlanner& operator=(const DhRrtConnectPlanner&) = delete;
+  ~DhRrtConnectPlanner();
+#endif
+
+  // Configuration Methods
+
+  // Set collision check callback.
+  // Inputs are callback function and user context passed to every call.
+  // NOTE: The callback must be thread safe if more than 1 shortcut thread is used.
+  void set_collisionCallback(DhCollisionCallback callback, void* context);
+
+  // Set joint space sampling bounds.
+  // Inputs are arrays of minimum and maximum joint angles in rad.
+  // Array sizes must match number of links.
+  void set_samplingBounds(float qMinInput[], float qMaxInput[]);
+
+  // Set maximum joint space distance of a single tree extension (rad).
+  void set_stepSize(float stepSizeInput);
+
+  // Set maximum joint angle change between collision checks along an edge (rad).
+  void set_edgeResolution(float edgeResolutionInput);
+
+  // Set maximum number of planning iterations.
+  void set_maxIterations(long maxIterationsInput);
+
+  // Set number of path shortcutting attempts (0 to disable).
+  void set_shortcutIterations(int shortcutIterationsInput);
+
+  // Set number of threads used for path shortcutting (desktop platforms only, ignored on Arduino).
+  // The worker threads are persistent (started here and kept until the planner is destroyed or this is called again).
+  // Results are identical for any number of threads.
+  void set_noOfShortcutThreads(int noOfThreadsInput);
+
+  // Set random number generator seed. Plans are reproducible for a given seed.
+  void set_seed(unsigned long seedInput);
+
+  // Planning Methods
+
+  // Plan a collision free joint space path.
+  // Inputs are start and goal joint angles in rad, array to store output and maximum number of path points.
+  // Output array size must be (maximum no. of path points x no. of links), stored point by point.
+  // Output is no. of path points (including start and goal), 0 if no path was found, or -1 if a path was found but it
+  // has more points than the output array holds (before shortcutting). Plans are reproducible for a given seed, so the
+  // path can be recovered by planning again with a larger output array.
+  int plan(float qStartInput[], float qGoalInput[], float qPathOutput[], int maxPathPoints);
+
+  // Shortcut (simplify) a collision free joint space path.
+  // Inputs are path (stored point by point) and no. of path points. The path is modified in place.
+  // Output is the new no. of path points.
+  int shortcutPath(float qPath[], int noOfPathPoints);
+
+  // Get number of tree nodes used by the last plan.
+  int get_noOfNodes();
+
+  // Collision check callback adapter for a DhCollisionModel object (passed as the context).
+  static bool collisionModelCallback(float qInput[], void* context);
+};
+
+} // namespace mt
+
+#endif // DH_MOTION_PLANNER_H_
@@ -0,0 +1,162 @@
+// Copyright (C) 2015 - 2020 Joseph Morgridge
+//
+// Licensed under GNU General Public License v3.0 (GPLv3) License.
+// See the LICENSE file in the project root for full license details.
+
+#include "dh_pose_predictor.h"
+
+#include "dh_kinematic_chain.h"
+#include "dh_kinematic_link.h"
+#include "dh_mat.h"
+
+#if USING_ARDUINO
+#include <Arduino.h>
+#else
+#include <cmath>
+using namespace std;
+#endif
+
+namespace mt {
+
+namespace {
+
+const int i1 = 0, i2 = 1, i3 = 2, i4 = 3; // Convenience array access indexes.
+
+} // namespace
+
+DhPosePredictor::DhPosePredictor(DhKinematicChain& chainInput):
+chain(chainInput) {}
+
+void DhPosePredictor::set_order(int orderInput) { order = (orderInput >= 2) ? 2 : 1; }
+
+void DhPosePredictor::set_tolerance(float positionToleranceInput, float orientationToleranceInput) {
+  positionTolerance = positionToleranceInput;
+  orientationTolerance = orientationToleranceInput;
+}
+
+void DhPosePredictor::update(float qInput[]) {
+  int noOfLinks = chain.get_noOfLinks();
+  float TmFrames[maxLinks][4][4];
+  float TmTool[4][4];
+  chain.fKineFrames(TmFrames, qInput);
+  chain.get_TmTool(TmTool);
+  matMultiply(TmFrames[noOfLinks - 1], TmTool, TmReference);
+  chain.jacobianFromFrames(JReference, TmFrames);
+  for (int i = 0; i < noOfLinks; i++) { qReference[i] = qInput[i]; }
+
+  // The distance of the tool-tip from any joint axis is at most the sum of the link lengths and offsets (a, d) beyond
+  // the joint, plus the tool.
+  DhKinematicLink links[maxLinks];
+  chain.get_links(links);
+  float distance = sqrt(TmTool[i1][i4] * TmTool[i1][i4] + TmTool[i2][i4] * TmTool[i2][i4] + TmTool[i3][i4] * TmTool[i3][i4]);
+  for (int i = 0; i < noOfLinks; i++)
+  {
+    distance += sqrt(links[i].get_a() * links[i].get_a() + links[i].get_d() * links[i].get_d());
+  }
+  reach = distance;
+
+  transformRevision = chain.get_transformRevision();
+  valid = true;
+  noOfUpdates++;
+}
+
+bool DhPosePredictor::fKine(float TmOutput[4][4], float qInput[], float* positionErrorBoundOutput) {
+  int noOfLinks = chain.get_noOfLinks();
+  float dq[maxLinks];
+  float s = 0; // Sum of the absolute joint deltas.
+  if (valid && transformRevision == chain.get_transformRevision())
+  {
+    for (int i = 0; i < noOfLinks; i++)
+    {
+      dq[i] = qInput[i] - qReference[i];
+      s += fabs(dq[i]);
+    }
+
+    // Taylor remainder bounds: each derivative w.r.t. a joint angle is a cross product with a unit joint axis, so the
+    // (k + 1)th derivative along dq is at most s^(k + 1) times the reach (position) or 1 (orientation).
+    float orientationErrorBound = (order == 2) ? s * s * s / 6 : s * s / 2;
+    float positionErrorBound = reach * orientationErrorBound;
+    if (positionErrorBound <= positionTolerance && orientationErrorBound <= orientationTolerance)
+    {
+      // First order: dp = Jv dq, rotation vector phi = Jw dq (Jw columns are the joint axes z).
+      // Second order (product of exponentials): dp += sum_j dq_j (w_j + dq_j z_j / 2) x Jv_j and
+      // phi += sum_j dq_j (w_j x z_j) / 2, where w_j = sum_(i < j) dq_i z_i.
+      float dp[3] = {0, 0, 0};
+      float phi[3] = {0, 0, 0};
+      float w[3] = {0, 0, 0};
+      for (int j = 0; j < noOfLinks; j++)
+      {
+        float z[3] = {JReference[3][j], JReference[4][j], JReference[5][j]};
+        float Jv[3] = {JReference[0][j], JReference[1][j], JReference[2][j]};
+        for (int r = 0; r < 3; r++)
+        {
+          dp[r] += Jv[r] * dq[j];
+          phi[r] += z[r] * dq[j];
+        }
+
+        if (order == 2)
+        {
+          float u[3] = {w[i1] + 0.5f * dq[j] * z[i1], w[i2] + 0.5f * dq[j] * z[i2], w[i3] + 0.5f * dq[j] * z[i3]};
+          dp[i1] += dq[j] * (u[i2] * Jv[i3] - u[i3] * Jv[i2]);
+          dp[i2] += dq[j] * (u[i3] * Jv[i1] - u[i1] * Jv[i3]);
+          dp[i3] += dq[j] * (u[i1] * Jv[i2] - u[i2] * Jv[i1]);
+          phi[i1] += 0.5f * dq[j] * (w[i2] * z[i3] - w[i3] * z[i2]);
+          phi[i2] += 0.5f * dq[j] * (w[i3] * z[i1] - w[i1] * z[i3]);
+          phi[i3] += 0.5f * dq[j] * (w[i1] * z[i2] - w[i2] * z[i1]);
+        }
+        for (int r = 0; r < 3; r++) { w[r] += z[r] * dq[j]; }
+      }
+
+      // Rotation matrix of the rotation vector (Rodrigues), applied w.r.t. the world frame.
+      float theta2 = phi[i1] * phi[i1] + phi[i2] * phi[i2] + phi[i3] * phi[i3];
+      float a, b; // sin(theta) / theta and (1 - cos(theta)) / theta^2.
+      if (theta2 < 1e-6f)
+      {
+        a = 1 - theta2 / 6;
+        b = 0.5f - theta2 / 24;
+      }
+      else
+      {
+        float theta = sqrt(theta2);
+        a = sin(theta) / theta;
+        b = (1 - cos(theta)) / theta2;
+      }
+      float dR[3][3] = { {1 - b * (phi[i2] * phi[i2] + phi[i3] * phi[i3]), b * phi[i1] * phi[i2] - a * phi[i3], b * phi[i1] * phi[i3] + a * phi[i2]},
+                         {b * phi[i1] * phi[i2] + a * phi[i3], 1 - b * (phi[i1] * phi[i1] + phi[i3] * phi[i3]), b * phi[i2] * phi[i3] - a * phi[i1]},
+                         {b * phi[i1] * phi[i3] - a * phi[i2], b * phi[i2] * phi[i3] + a * phi[i1], 1 - b * (phi[i1] * phi[i1] + phi[i2] * phi[i2])} };
+
+      for (int r = 0; r < 3; r++)
+      {
+        for (int c = 0; c < 3; c++)
+        {
+          TmOutput[r][c] = dR[r][i1] * TmReference[i1][c] + dR[r][i2] * TmReference[i2][c] + dR[r][i3] * TmReference[i3][c];
+        }
+        TmOutput[r][i4] = TmReference[r][i4] + dp[r];
+      }
+      TmOutput[i4][i1] = 0;
+      TmOutput[i4][i2] = 0;
+      TmOutput[i4][i3] = 0;
+      TmOutput[i4][i4] = 1;
+
+      if (positionErrorBoundOutput != nullptr) { *positionErrorBoundOutput = positionErrorBound; }
+      noOfPredictions++;
+      return true;
+    }
+  }
+
+  // Full evaluation; the new reference is exact.
+  update(qInput);
+  for (int r = 0; r < 4; r++)
+  {
+    for (int c = 0; c < 4; c++) { TmOutput[r][c] = TmReference[r][c]; }
+  }
+  if (positionErrorBoundOutput != nullptr) { *positionErrorBoundOutput = 0; }
+  return false;
+}
+
+void DhPosePredictor::get_stats(uint32_t& noOfPredictionsOutput, uint32_t& noOfUpdatesOutput) {
+  noOfPredictionsOutput = noOfPredictions;
+  noOfUpdatesOutput = noOfUpdates;
+}
+
+} // namespace mt
@@ -0,0 +1,99 @@
+// Copyright (C) 2015 - 2020 Joseph Morgridge
+//
+// Licensed under GNU General Public License v3.0 (GPLv3) License.
+// See the LICENSE file in the project root for full license details.
+
+#ifndef DH_POSE_PREDICTOR_H_
+#define DH_POSE_PREDICTOR_H_
+
+#include "dh_kinematic_chain.h"
+
+#if __has_include(<Arduino.h>)
+#include <Arduino.h>
+#define USING_ARDUINO 1
+#else
+#include <cstdint>
+#define USING_ARDUINO 0
+#endif
+
+namespace mt {
+
+// Class to encapsulate a Jacobian-based pose predictor of a kinematic chain.
+// The predictor gives the pose at a high rate (e.g. sub-tick interpolation for visualisation or a safety monitor)
+// without a full forward kinematics evaluation per pose. After a full evaluation at a reference pose (transformation
+// matrix and Jacobian), poses of nearby joint angles are extrapolated from the Jacobian, to first order (O(n)) or
+// with the second order term (O(n); exact Hessian of the product of exponentials, no extra storage). The rotation is
+// applied as a rotation vector, so the predicted orientation is always orthonormal.
+// The error of each prediction is bounded from the joint deltas: with s = sum(|dq|) the position error is at most
+// R s^(k + 1) / (k + 1)! and the orientation error s^(k + 1) / (k + 1)! rad, where k is the order and R is the reach
+// of the chain (sum of the D-H link lengths and offsets, plus the tool). When a bound exceeds its tolerance, the
+// reference is re-evaluated at the new joint angles, so the tolerances trade accuracy for cost.
+// The reference is also re-evaluated when the base or tool of the chain change. The chain is only read.
+class DhPosePredictor {
+
+ public:
+
+  // General Constants
+  static const int maxLinks = DhKinematicChain::maxLinks;
+
+ private:
+
+  // General Parameters
+  DhKinematicChain& chain;
+  int order = 1;
+  float positionTolerance = 0.01;    // Max. position error bound of a prediction (length units).
+  float orientationTolerance = 1e-4; // Max. orientation error bound of a prediction (rad).
+
+  // Reference Pose
+  bool valid = false;
+  uint32_t transformRevision = 0; // Base and tool revision of the reference pose.
+  float qReference[maxLinks];     // (rad).
+  float TmReference[4][4];        // With base and tool.
+  float JReference[6][maxLinks];
+  float reach = 0;                // Upper bound of the distance of the tool-tip from any joint axis.
+
+  // Statistics
+  uint32_t noOfPredictions = 0;
+  uint32_t noOfUpdates = 0;
+
+ public:
+
+  // Constructors
+
+  // Input is the robots kinematic model. The chain is NOT copied and must outlive the predictor.
+  DhPosePredictor(DhKinematicChain& chainInput);
+
+  // Configuration Methods
+
+  // Set the predictor order. The reference pose is kept.
+  // Input is order (1 or 2).
+  void set_order(int orderInput);
+
+  // Set the prediction tolerances. The reference pose is kept.
+  // Inputs are position tolerance (length units e.g. mm) and orientation tolerance (rad).
+  void set_tolerance(float positionToleranceInput, float orientationToleranceInput);
+
+  // Prediction Methods
+
+  // Evaluate the reference pose (full forward kinematics and Jacobian).
+  // Input is array of joint angles in rad.
+  // Array size must match number of links.
+  void update(float qInput[]);
+
+  // Calculate the forward kinematics with the predictor. The reference pose is evaluated first if there is none, if the
+  // base or tool have changed, or if the error bound of the prediction exceeds the tolerances.
+  // Inputs are 4 x 4 array to store output, array of joint angles in rad and optional variable to store the position
+  // error bound (nullptr if not required).
+  // Output is the transformation matrix of the end-effector (or tool-tip if a tool is applied) w.r.t. the world frame.
+  // Returns true if predicted, false if fully evaluated (the error is then 0). The chain joint angles are unchanged.
+  bool fKine(float TmOutput[4][4], float qInput[], float* positionErrorBoundOutput = nullptr);
+
+  // Get the predictor statistics, e.g. to tune the tolerances.
+  // Inputs are variables to store output.
+  // Outputs are no. of predictions and no. of full evaluations (reference updates).
+  void get_stats(uint32_t& noOfPredictionsOutput, uint32_t& noOfUpdatesOutput);
+};
+
+} // namespace mt
+
+#endif // DH_POSE_PREDICTOR_H_
@@ -0,0 +1,241 @@
+// Copyright (C) 2015 - 2020 Joseph Morgridge
+//
+// Licensed under GNU General Public License v3.0 (GPLv3) License.
+// See the LICENSE file in the project root for full license details.
+
+#include "dh_robot_model.h"
+
+#include "dh_kinematic_link.h"
+#include "dh_kinematic_chain.h"
+
+#if USING_ARDUINO
+#include <Arduino.h>
+#else
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+using namespace std;
+#endif
+
+namespace mt {
+
+static_assert(sizeof(DhRobotModelHeader) == 112, "Unexpected binary robot model header size");
+static_assert(sizeof(DhRobotModelLink) == 40, "Unexpected binary robot model link size");
+static_assert(sizeof(DhRobotModelInertia) == 40, "Unexpected binary robot model inertia size");
+
+bool DhRobotModelView::attach(const void* buffer, size_t size) {
+  header = nullptr;
+  links = nullptr;
+  inertias = nullptr;
+
+  if (buffer == nullptr || size < sizeof(DhRobotModelHeader)) { return false; }
+
+  const DhRobotModelHeader* candidate = static_cast<const DhRobotModelHeader*>(buffer);
+  if (candidate->magic != kDhRobotModelMagic || candidate->version != kDhRobotModelVersion) { return false; }
+  if (candidate->noOfLinks < 1 || candidate->noOfLinks > (uint32_t)DhKinematicChain::maxLinks) { return false; }
+
+  size_t expectedSize = sizeof(DhRobotModelHeader) + candidate->noOfLinks * sizeof(DhRobotModelLink);
+  if (candidate->flags & kDhRobotModelHasInertia) { expectedSize += candidate->noOfLinks * sizeof(DhRobotModelInertia); }
+  if (candidate->totalSize != expectedSize || size < expectedSize) { return false; }
+
+  header = candidate;
+  links = reinterpret_cast<const DhRobotModelLink*>(header + 1);
+  if (header->flags & kDhRobotModelHasInertia) { inertias = reinterpret_cast<const DhRobotModelInertia*>(links + header->noOfLinks); }
+  return true;
+}
+
+bool DhRobotModelView::isValid() { return header != nullptr; }
+
+int DhRobotModelView::get_noOfLinks() { return (header != nullptr) ? (int)header->noOfLinks : 0; }
+
+bool DhRobotModelView::hasInertia() { return inertias != nullptr; }
+
+const DhRobotModelLink& DhRobotModelView::get_link(int index) { return links[index]; }
+
+const DhRobotModelInertia& DhRobotModelView::get_inertia(int index) { return inertias[index]; }
+
+const DhRobotModelHeader& DhRobotModelView::get_header() { return *header; }
+
+int DhRobotModelView::makeLinks(DhKinematicLink linksOutput[]) {
+  int noOfLinks = get_noOfLinks();
+  for (int i = 0; i < noOfLinks; i++)
+  {
+    if (links[i].jointType != kDhJointRevolute) { return 0; }
+  }
+
+  for (int i = 0; i < noOfLinks; i++)
+  {
+    linksOutput[i] = DhKinematicLink{links[i].theta, links[i].d, links[i].a, links[i].alpha};
+  }
+  return noOfLinks;
+}
+
+void DhRobotModelView::applyTo(DhKinematicChain& chain) {
+  float TmBase[4][4];
+  for (int r = 0; r < 4; r++)
+  {
+    for (int c = 0; c < 4; c++) { TmBase[r][c] = header->TmBase[r][c]; }
+  }
+  chain.setBaseTransform(TmBase);
+  chain.setToolTransformPosition(header->toolPosition[0], header->toolPosition[1], header->toolPosition[2], header->toolZOffset);
+
+  for (int i = 0; i < get_noOfLinks(); i++)
+  {
+    chain.set_jointLimits(i, links[i].qMin, links[i].qMax, links[i].qdMax, links[i].qddMax);
+  }
+}
+
+#if !USING_ARDUINO
+
+DhRobotModelFile::~DhRobotModelFile() { close(); }
+
+bool DhRobotModelFile::open(const char* path) {
+  close();
+  if (!file.open(path)) { return false; }
+  if (!view.attach(file.get_data(), file.get_size()))
+  {
+    close();
+    return false;
+  }
+  return true;
+}
+
+void DhRobotModelFile::close() {
+  file.close();
+  view = DhRobotModelView();
+}
+
+DhRobotModelView& DhRobotModelFile::get_view() { return view; }
+
+namespace {
+
+// Split a text line into comma separated fields (in place).
+// Output is no. of fields.
+int splitFields(char* line, char* fieldsOutput[], int maxFields) {
+  char* comment = strchr(line, '#');
+  if (comment != nullptr) { *comment = '\0'; }
+
+  int noOfFields = 0;
+  char* field = line;
+  while (noOfFields < maxFields)
+  {
+    char* separator = strchr(field, ',');
+    if (separator != nullptr) { *separator = '\0'; }
+
+    // Trim white space.
+    while (*field == ' ' || *field == '\t') { field++; }
+    char* end = field + strlen(field);
+    while (end > field && (end[-1] == ' ' || end[-1] == '\t' || end[-1] == '\r' || end[-1] == '\n')) { *--end = '\0'; }
+
+    fieldsOutput[noOfFields++] = field;
+    if (separator == nullptr) { break; }
+    field = separator + 1;
+  }
+
+  if (noOfFields == 1 && fieldsOutput[0][0] == '\0') { return 0; } // Blank line.
+  return noOfFields;
+}
+
+bool parseFloats(char* fields[], int noOfFields, float valuesOutput[]) {
+  for (int i = 0; i < noOfFields; i++)
+  {
+    char* end = nullptr;
+    valuesOutput[i] = strtof(fields[i], &end);
+    if (end == fields[i] || *end != '\0') { return false; }
+  }
+  return true;
+}
+
+} // namespace
+
+int convertRobotModelTextToBinary(const char* textPath, const char* binaryPath) {
+  const int maxLinks = DhKinematicChain::maxLinks;
+  const float unlimited = 3.4e38;
+
+  DhRobotModelHeader header;
+  DhRobotModelLink links[maxLinks];
+  DhRobotModelInertia inertias[maxLinks];
+  memset(&header, 0, sizeof(header));
+  memset(links, 0, sizeof(links));
+  memset(inertias, 0, sizeof(inertias));
+  for (int i = 0; i < 4; i++) { header.TmBase[i][i] = 1; }
+
+  FILE* textFile = fopen(textPath, "r");
+  if (textFile == nullptr) { return 0; }
+
+  char line[512];
+  char* fields[20];
+  int noOfLinks = 0;
+  bool hasInertia = false;
+  bool ok = true;
+
+  while (ok && fgets(line, sizeof(line), textFile) != nullptr)
+  {
+    int noOfFields = splitFields(line, fields, 20);
+    if (noOfFields == 0) { continue; }
+
+    float values[19];
+    int noOfValues = noOfFields - 1;
+    if (!parseFloats(&fields[1], noOfValues, values)) { ok = false; break; }
+
+    if (strcmp(fields[0], "base") == 0 && noOfValues == 16)
+    {
+      for (int k = 0; k < 16; k++) { header.TmBase[k / 4][k % 4] = values[k]; }
+    }
+    else if (strcmp(fields[0], "tool") == 0 && noOfValues == 4)
+    {
+      for (int k = 0; k < 3; k++) { header.toolPosition[k] = values[k]; }
+      header.toolZOffset = values[3];
+    }
+    else if (strcmp(fields[0], "link") == 0 && noOfValues >= 4 && noOfValues <= 9 && noOfLinks < maxLinks)
+    {
+      DhRobotModelLink& link = links[noOfLinks++];
+      float defaults[9] = {0, 0, 0, 0, -unlimited, unlimited, unlimited, unlimited, kDhJointRevolute};
+      for (int k = 0; k < noOfValues; k++) { defaults[k] = values[k]; }
+      link.theta = defaults[0];
+      link.d = defaults[1];
+      link.a = defaults[2];
+      link.alpha = defaults[3];
+      link.qMin = defaults[4];
+      link.qMax = defaults[5];
+      link.qdMax = defaults[6];
+      link.qddMax = defaults[7];
+      link.jointType = (uint32_t)defaults[8];
+    }
+    else if (strcmp(fields[0], "inertia") == 0 && noOfValues == 11 && values[0] >= 0 && values[0] < maxLinks)
+    {
+      DhRobotModelInertia& inertia = inertias[(int)values[0]];
+      inertia.mass = values[1];
+      for (int k = 0; k < 3; k++) { inertia.centreOfMass[k] = values[2 + k]; }
+      for (int k = 0; k < 6; k++) { inertia.inertia[k] = values[5 + k]; }
+      hasInertia = true;
+    }
+    else
+    {
+      ok = false;
+    }
+  }
+  fclose(textFile);
+
+  if (!ok || noOfLinks == 0) { return 0; }
+
+  header.magic = kDhRobotModelMagic;
+  header.version = kDhRobotModelVersion;
+  header.noOfLinks = noOfLinks;
+  header.flags = hasInertia ? kDhRobotModelHasInertia : 0;
+  header.totalSize = sizeof(DhRobotModelHeader) + noOfLinks * sizeof(DhRobotModelLink) +
+                     (hasInertia ? noOfLinks * sizeof(DhRobotModelInertia) : 0);
+
+  FILE* binaryFile = fopen(binaryPath, "wb");
+  if (binaryFile == nullptr) { return 0; }
+  ok = fwrite(&header, sizeof(header), 1, binaryFile) == 1 &&
+       fwrite(links, sizeof(DhRobotModelLink), noOfLinks, binaryFile) == (size_t)noOfLinks &&
+       (!hasInertia || fwrite(inertias, sizeof(DhRobotModelInertia), noOfLinks, binaryFile) == (size_t)noOfLinks);
+  ok = (fclose(binaryFile) == 0) && ok;
+
+  return ok ? 1 : 0;
+}
+
+#endif
+
+} // namespace mt
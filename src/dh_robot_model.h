@@ -0,0 +1,159 @@
+// Copyright (C) 2015 - 2020 Joseph Morgridge
+//
+// Licensed under GNU General Public License v3.0 (GPLv3) License.
+// See the LICENSE file in the project root for full license details.
+
+#ifndef DH_ROBOT_MODEL_H_
+#define DH_ROBOT_MODEL_H_
+
+#include "dh_kinematic_link.h"
+#include "dh_kinematic_chain.h"
+#include "dh_mapped_file.h"
+
+#if __has_include(<Arduino.h>)
+#include <Arduino.h>
+#define USING_ARDUINO 1
+#else
+#include <cstdint>
+#include <cstddef>
+#define USING_ARDUINO 0
+#endif
+
+namespace mt {
+
+// Binary robot model format (version 1).
+// A compact, versioned definition of a full DhKinematicChain, laid out so that it can be used directly from memory
+// (e.g. a memory mapped file) with zero parsing. All fields are 4-byte little-endian values (uint32_t or float):
+//   DhRobotModelHeader
+//   DhRobotModelLink x noOfLinks
+//   DhRobotModelInertia x noOfLinks (only if flags has kDhRobotModelHasInertia set)
+constexpr uint32_t kDhRobotModelMagic = 0x4D524844; // "DHRM".
+constexpr uint32_t kDhRobotModelVersion = 1;
+constexpr uint32_t kDhRobotModelHasInertia = 0x1; // Header flag.
+
+// Joint types.
+constexpr uint32_t kDhJointRevolute = 0;
+constexpr uint32_t kDhJointPrismatic = 1; // Reserved; DhKinematicChain currently supports revolute joints only.
+
+struct DhRobotModelHeader {
+  uint32_t magic;     // kDhRobotModelMagic.
+  uint32_t version;   // kDhRobotModelVersion.
+  uint32_t noOfLinks;
+  uint32_t flags;
+  uint32_t totalSize; // Total size of the model in bytes.
+  uint32_t reserved[3];
+  float TmBase[4][4]; // Base transformation matrix.
+  float toolPosition[3]; // Tool dimensions (x, y, z). See DhKinematicChain::setToolTransformPosition(...).
+  float toolZOffset;     // Tool z-offset.
+};
+
+struct DhRobotModelLink {
+  float theta; // D-H parameters (rad, mm, mm, rad).
+  float d;
+  float a;
+  float alpha;
+  float qMin;   // Joint position limits (rad).
+  float qMax;
+  float qdMax;  // Joint velocity limit (rad/s).
+  float qddMax; // Joint acceleration limit (rad/s^2).
+  uint32_t jointType;
+  uint32_t reserved;
+};
+
+struct DhRobotModelInertia {
+  float mass;              // (kg).
+  float centreOfMass[3];   // Centre of mass (x, y, z) w.r.t. the link frame.
+  float inertia[6];        // Inertia tensor about the centre of mass (Ixx, Iyy, Izz, Ixy, Ixz, Iyz).
+};
+
+// Class to encapsulate read only, zero copy access to a binary robot model held in memory.
+// NOTE: On AVR based Arduino boards the model must be in RAM (not PROGMEM).
+class DhRobotModelView {
+
+  const DhRobotModelHeader* header = nullptr;
+  const DhRobotModelLink* links = nullptr;
+  const DhRobotModelInertia* inertias = nullptr;
+
+ public:
+
+  // Methods
+
+  // Attach to (and validate) a binary robot model in memory. The memory is NOT copied and must outlive the view.
+  // Inputs are pointer to the model (4-byte aligned) and available size in bytes.
+  // Output is true if the model is valid.
+  bool attach(const void* buffer, size_t size);
+
+  // Get whether the view is attached to a valid model.
+  bool isValid();
+
+  // Get number of links.
+  int get_noOfLinks();
+
+  // Get whether the model includes inertia parameters.
+  bool hasInertia();
+
+  // Get model link record (D-H parameters, limits and joint type).
+  // Index must be in range 0 to (no. of links - 1).
+  const DhRobotModelLink& get_link(int index);
+
+  // Get model inertia record. Only valid if hasInertia() is true.
+  // Index must be in range 0 to (no. of links - 1).
+  const DhRobotModelInertia& get_inertia(int index);
+
+  // Get the model header (base and tool transformations).
+  const DhRobotModelHeader& get_header();
+
+  // Create the link objects for a DhKinematicChain.
+  // Input is array of link objects to store output (size must be at least the number of links).
+  // Output is no. of links, or 0 if the model contains joints that are not supported by DhKinematicChain.
+  int makeLinks(DhKinematicLink linksOutput[]);
+
+  // Apply the model base and tool transformations and joint limits to a chain created from makeLinks(...).
+  // Input is the robots kinematic model.
+  void applyTo(DhKinematicChain& chain);
+};
+
+#if !USING_ARDUINO
+
+// Class to encapsulate a memory mapped binary robot model file (desktop platforms with POSIX memory mapping only).
+// The file is mapped read only and validated on open; no parsing or copying is performed.
+class DhRobotModelFile {
+
+  DhMappedFile file;
+  DhRobotModelView view;
+
+ public:
+
+  DhRobotModelFile() = default;
+  DhRobotModelFile(const DhRobotModelFile&) = delete;
+  DhRobotModelFile& operator=(const DhRobotModelFile&) = delete;
+  ~DhRobotModelFile();
+
+  // Memory map and validate a binary robot model file.
+  // Input is file path.
+  // Output is true on success.
+  bool open(const char* path);
+
+  // Unmap the file.
+  void close();
+
+  // Get the model view. Only valid while the file is open.
+  DhRobotModelView& get_view();
+};
+
+// Convert a text (CSV) robot model definition to the binary robot model format.
+// Text format (one record per line, comma separated, '#' starts a comment):
+//   base, r11, r12, r13, px, r21, r22, r23, py, r31, r32, r33, pz, 0, 0, 0, 1
+//   tool, dx, dy, dz, zOffset
+//   link, theta, d, a, alpha, qMin, qMax, qdMax, qddMax[, jointType]   (one per link, in order)
+//   inertia, linkIndex, mass, cx, cy, cz, Ixx, Iyy, Izz, Ixy, Ixz, Iyz  (optional)
+// Missing base/tool records default to the identity/no tool, and missing limits default to unlimited.
+// Inputs are text file path and binary file path.
+// Output is 1 on success, 0 on failure.
+int convertRobotModelTextToBinary(const char* textPath, const char* binaryPath);
+
+#endif
+
+} // namespace mt
+
+#endif // DH_ROBOT_MODEL_H_
@@ -0,0 +1,239 @@
+// Copyright (C) 2015 - 2020 Joseph Morgridge
+//
+// Licensed under GNU General Public License v3.0 (GPLv3) License.
+// See the LICENSE file in the project root for full license details.
+
+#include "dh_time_parameterization.h"
+
+#include "dh_kinematic_chain.h"
+
+#if USING_ARDUINO
+#include <Arduino.h>
+#else
+#include <cmath>
+using namespace std;
+#endif
+
+namespace mt {
+
+DhTimeParameterizer::DhTimeParameterizer(DhKinematicChain& chainInput) {
+  noOfLinks = chainInput.get_noOfLinks();
+  for (int i = 0; i < maxLinks; i++)
+  {
+    qdMax[i] = 1.0;
+    qddMax[i] = 1.0;
+  }
+}
+
+void DhTimeParameterizer::set_velocityLimits(float qdMaxInput[]) {
+  for (int i = 0; i < noOfLinks; i++)
+  {
+    qdMax[i] = qdMaxInput[i]; // (rad/s).
+  }
+}
+
+void DhTimeParameterizer::set_accelerationLimits(float qddMaxInput[]) {
+  for (int i = 0; i < noOfLinks; i++)
+  {
+    qddMax[i] = qddMaxInput[i]; // (rad/s^2).
+  }
+}
+
+void DhTimeParameterizer::pathDerivatives(float qPathInput[], int noOfPoints, int index, float dqOutput[], float ddqOutput[]) {
+  // One-sided differences at the ends of the path.
+  int previous = (index > 0) ? index - 1 : index;
+  int next = (index < noOfPoints - 1) ? index + 1 : index;
+  int centre = (index == 0) ? 1 : ((index == noOfPoints - 1) ? noOfPoints - 2 : index);
+  float span = (float)(next - previous);
+
+  for (int j = 0; j < noOfLinks; j++)
+  {
+    dqOutput[j] = (qPathInput[next * noOfLinks + j] - qPathInput[previous * noOfLinks + j]) / span;
+    ddqOutput[j] = qPathInput[(centre + 1) * noOfLinks + j] - 2 * qPathInput[centre * noOfLinks + j] +
+                   qPathInput[(centre - 1) * noOfLinks + j];
+  }
+}
+
+float DhTimeParameterizer::velocityLimit(float dq[]) {
+  float xMax = 3.4e38;
+  for (int j = 0; j < noOfLinks; j++)
+  {
+    float dq2 = dq[j] * dq[j];
+    if (dq2 * xMax > qdMax[j] * qdMax[j]) { xMax = (qdMax[j] * qdMax[j]) / dq2; }
+  }
+  return xMax;
+}
+
+int DhTimeParameterizer::buildConstraints(float dq[], float ddq[], float xMax, float xNextMin, float xNextMax,
+                                          float a[], float b[], float c[]) {
+  int n = 0;
+
+  // 0 <= x <= xMax (velocity limits).
+  a[n] = -1; b[n] = 0; c[n] = 0; n++;
+  a[n] = 1;  b[n] = 0; c[n] = xMax; n++;
+
+  // -qddMax <= dq * u + ddq * x <= qddMax (acceleration limits).
+  for (int j = 0; j < noOfLinks; j++)
+  {
+    a[n] = ddq[j];  b[n] = dq[j];  c[n] = qddMax[j]; n++;
+    a[n] = -ddq[j]; b[n] = -dq[j]; c[n] = qddMax[j]; n++;
+  }
+
+  // xNextMin <= x + 2u <= xNextMax (next grid point reachable; unit grid spacing).
+  a[n] = 1;  b[n] = 2;  c[n] = xNextMax; n++;
+  a[n] = -1; b[n] = -2; c[n] = -xNextMin; n++;
+
+  return n;
+}
+
+bool DhTimeParameterizer::solveLp2(float a[], float b[], float c[], int noOfConstraints, bool maximise, float& xOutput) {
+  // The feasible set is a bounded polygon, so the optimum lies on a vertex; enumerate all constraint line intersections.
+  bool feasible = false;
+
+  for (int i = 0; i < noOfConstraints; i++)
+  {
+    for (int k = i + 1; k < noOfConstraints; k++)
+    {
+      float det = a[i] * b[k] - a[k] * b[i];
+      if (fabs(det) < 1e-12) { continue; }
+
+      float x = (c[i] * b[k] - c[k] * b[i]) / det;
+      float u = (a[i] * c[k] - a[k] * c[i]) / det;
+
+      bool vertexFeasible = true;
+      for (int m = 0; m < noOfConstraints && vertexFeasible; m++)
+      {
+        float tolerance = 1e-5 * (fabs(c[m]) + fabs(a[m] * x) + fabs(b[m] * u) + 1e-6);
+        if (a[m] * x + b[m] * u > c[m] + tolerance) { vertexFeasible = false; }
+      }
+
+      if (vertexFeasible && (!feasible || (maximise ? (x > xOutput) : (x < xOutput))))
+      {
+        xOutput = x;
+        feasible = true;
+      }
+    }
+  }
+
+  return feasible;
+}
+
+int DhTimeParameterizer::parameterize(float qPathInput[], int noOfPoints, float sdSquaredOutput[]) {
+  if (noOfPoints < 3) { return 0; }
+
+  float dq[maxLinks], ddq[maxLinks];
+  float a[maxConstraints], b[maxConstraints], c[maxConstraints];
+
+  // Backward pass: controllable sets. The upper bound of each set is stored in the output array,
+  // and only the lower bound of the next set is needed, so the workspace is O(1).
+  sdSquaredOutput[noOfPoints - 1] = 0; // End at rest.
+  float xNextMin = 0;
+
+  for (int i = noOfPoints - 2; i >= 0; i--)
+  {
+    pathDerivatives(qPathInput, noOfPoints, i, dq, ddq);
+    int n = buildConstraints(dq, ddq, velocityLimit(dq), xNextMin, sdSquaredOutput[i + 1], a, b, c);
+
+    float xUpper = 0, xLower = 0;
+    if (!solveLp2(a, b, c, n, true, xUpper) || !solveLp2(a, b, c, n, false, xLower)) { return 0; }
+    sdSquaredOutput[i] = (xUpper > 0) ? xUpper : 0;
+    xNextMin = (xLower > 0) ? xLower : 0;
+  }
+
+  if (xNextMin > 0) { return 0; } // Cannot start at rest.
+
+  // Forward pass: greedily choose the maximum path acceleration that stays within the next controllable set.
+  float x = 0; // Start at rest.
+  for (int i = 0; i < noOfPoints - 1; i++)
+  {
+    float xNextMax = sdSquaredOutput[i + 1]; // Read before being overwritten.
+    sdSquaredOutput[i] = x;
+    pathDerivatives(qPathInput, noOfPoints, i, dq, ddq);
+
+    float uMax = (xNextMax - x) / 2;
+    for (int j = 0; j < noOfLinks; j++)
+    {
+      // dq * u <= qddMax - ddq * x and -dq * u <= qddMax + ddq * x.
+      if (dq[j] > 1e-12) { float limit = (qddMax[j] - ddq[j] * x) / dq[j]; if (limit < uMax) { uMax = limit; } }
+      else if (dq[j] < -1e-12) { float limit = (-qddMax[j] - ddq[j] * x) / dq[j]; if (limit < uMax) { uMax = limit; } }
+    }
+
+    x = x + 2 * uMax;
+    if (x < 0) { x = 0; }
+  }
+  sdSquaredOutput[noOfPoints - 1] = 0;
+
+  return 1;
+}
+
+DhTrajectoryEvaluator::DhTrajectoryEvaluator(DhKinematicChain& chainInput, float qPathInput[], float sdSquaredInput[], int noOfPointsInput):
+noOfLinks(chainInput.get_noOfLinks()), qPath(qPathInput), sdSquared(sdSquaredInput), noOfPoints(noOfPointsInput) {
+  duration = 0;
+  for (int i = 0; i < noOfPoints - 1; i++)
+  {
+    duration += intervalDuration(i);
+  }
+  reset();
+}
+
+float DhTrajectoryEvaluator::intervalDuration(int index) {
+  float sdSum = sqrt(sdSquared[index]) + sqrt(sdSquared[index + 1]);
+  return (sdSum > 0) ? 2.0 / sdSum : 0; // Constant path acceleration over a unit grid interval.
+}
+
+void DhTrajectoryEvaluator::reset() {
+  interval = 0;
+  tau = 0;
+  time = 0;
+}
+
+float DhTrajectoryEvaluator::get_duration() { return duration; }
+
+float DhTrajectoryEvaluator::get_time() { return time; }
+
+bool DhTrajectoryEvaluator::next(float dt, float qOutput[], float qdOutput[]) {
+  time += dt;
+  tau += dt;
+
+  // Advance to the grid interval containing the new time.
+  while (interval < noOfPoints - 1 && tau >= intervalDuration(interval))
+  {
+    tau -= intervalDuration(interval);
+    interval++;
+  }
+
+  bool running = interval < noOfPoints - 1;
+  int i = running ? interval : noOfPoints - 2;
+  float sd0 = sqrt(sdSquared[i]);
+  float u = (sdSquared[i + 1] - sdSquared[i]) / 2; // Path acceleration (constant over the interval).
+  float ds = running ? (sd0 * tau + 0.5 * u * tau * tau) : 1; // Path parameter progress within the interval.
+  float sd = running ? (sd0 + u * tau) : 0;
+  if (ds > 1) { ds = 1; }
+  if (!running) { time = duration; }
+
+  for (int j = 0; j < noOfLinks; j++)
+  {
+    float q0 = qPath[i * noOfLinks + j];
+    float q1 = qPath[(i + 1) * noOfLinks + j];
+    qOutput[j] = q0 + ds * (q1 - q0); // (rad).
+    if (qdOutput != nullptr) { qdOutput[j] = (q1 - q0) * sd; } // (rad/s).
+  }
+
+  return running;
+}
+
+int DhTrajectoryEvaluator::sampleUniform(float dt, float qOutput[], int maxSamples) {
+  if (maxSamples < 1) { return 0; }
+
+  reset();
+  next(0, qOutput);
+  int noOfSamples = 1;
+  while (noOfSamples < maxSamples && next(dt, &qOutput[noOfSamples * noOfLinks]))
+  {
+    noOfSamples++;
+  }
+  if (noOfSamples < maxSamples && time >= duration) { noOfSamples++; } // Final point.
+  return noOfSamples;
+}
+
+} // namespace mt
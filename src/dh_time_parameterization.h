@@ -0,0 +1,144 @@
+// Copyright (C) 2015 - 2020 Joseph Morgridge
+//
+// Licensed under GNU General Public License v3.0 (GPLv3) License.
+// See the LICENSE file in the project root for full license details.
+
+#ifndef DH_TIME_PARAMETERIZATION_H_
+#define DH_TIME_PARAMETERIZATION_H_
+
+#include "dh_kinematic_chain.h"
+
+#if __has_include(<Arduino.h>)
+#include <Arduino.h>
+#define USING_ARDUINO 1
+#else
+#define USING_ARDUINO 0
+#endif
+
+namespace mt {
+
+// Class to encapsulate time-optimal path parameterization of a joint space path under joint velocity and acceleration limits.
+// The path is given as joint angle samples (grid points) at uniform intervals of the path parameter s (s = sample index).
+// The path should be smooth and densely sampled (e.g. sampled from a spline) since the path derivatives are
+// obtained by finite differences. The output is the squared path velocity (sd^2) at each grid point.
+// The algorithm is linear in the no. of grid points.
+// Reference:
+// Pham, H. and Pham, Q.C. (2018) A New Approach to Time-Optimal Path Parameterization Based on Reachability Analysis.
+// IEEE Transactions on Robotics, 34(3), pp. 645-659.
+class DhTimeParameterizer {
+
+ public:
+
+  // General Constants
+  static const int maxLinks = DhKinematicChain::maxLinks;
+
+ private:
+
+  static const int maxConstraints = 2 * maxLinks + 4;
+
+  // General Parameters
+  int noOfLinks = 0;
+  float qdMax[maxLinks]; // Joint velocity limits (rad/s).
+  float qddMax[maxLinks]; // Joint acceleration limits (rad/s^2).
+
+  // Path derivatives w.r.t. s at a grid point (central finite differences).
+  void pathDerivatives(float qPathInput[], int noOfPoints, int index, float dqOutput[], float ddqOutput[]);
+
+  // Maximum sd^2 allowed by the joint velocity limits at a grid point.
+  float velocityLimit(float dq[]);
+
+  // Build the linear constraints a * x + b * u <= c (x = sd^2, u = sdd) for a grid point,
+  // including the next grid point reachable set [xNextMin, xNextMax].
+  // Output is no. of constraints.
+  int buildConstraints(float dq[], float ddq[], float xMax, float xNextMin, float xNextMax,
+                       float a[], float b[], float c[]);
+
+ public:
+
+  // Constructors
+
+  DhTimeParameterizer(DhKinematicChain& chainInput);
+
+  // Configuration Methods
+
+  // Set joint velocity limits.
+  // Input is array of velocity limits in rad/s.
+  // Array size must match number of links.
+  void set_velocityLimits(float qdMaxInput[]);
+
+  // Set joint acceleration limits.
+  // Input is array of acceleration limits in rad/s^2.
+  // Array size must match number of links.
+  void set_accelerationLimits(float qddMaxInput[]);
+
+  // Parameterization Methods
+
+  // Compute the time-optimal path velocity profile. The path starts and ends at rest.
+  // Inputs are path (stored point by point), no. of grid points and array to store output.
+  // Output array size must match the no. of grid points.
+  // Output is the squared path velocity (sd^2) at each grid point. Returns 1 on success, 0 if no feasible profile exists.
+  int parameterize(float qPathInput[], int noOfPoints, float sdSquaredOutput[]);
+
+  // Solve the 2 variable linear program: maximise (or minimise) x subject to a * x + b * u <= c.
+  // Inputs are constraints, no. of constraints, maximise flag and variable to store output.
+  // Output is true if feasible.
+  static bool solveLp2(float a[], float b[], float c[], int noOfConstraints, bool maximise, float& xOutput);
+};
+
+// Class to encapsulate streaming evaluation of a time parameterized joint space path (DhTimeParameterizer output).
+// Successive evaluations move forward in time with O(1) cost per call.
+class DhTrajectoryEvaluator {
+
+  // General Parameters
+  int noOfLinks = 0;
+  float* qPath = nullptr;
+  float* sdSquared = nullptr;
+  int noOfPoints = 0;
+
+  // Evaluation State
+  int interval = 0;   // Current grid interval [interval, interval + 1].
+  float tau = 0;      // Time since the start of the current interval (s).
+  float time = 0;     // Time since the start of the trajectory (s).
+  float duration = 0; // Trajectory duration (s).
+
+  // Duration of a grid interval (s).
+  float intervalDuration(int index);
+
+ public:
+
+  // Constructors
+
+  // Inputs are the robots kinematic model, the path (stored point by point), the squared path velocity profile
+  // from DhTimeParameterizer::parameterize(...) and the no. of grid points. The arrays are NOT copied.
+  DhTrajectoryEvaluator(DhKinematicChain& chainInput, float qPathInput[], float sdSquaredInput[], int noOfPointsInput);
+
+  // Methods
+
+  // Restart evaluation from the start of the trajectory.
+  void reset();
+
+  // Get trajectory duration.
+  // Output is duration in s.
+  float get_duration();
+
+  // Get time of the last evaluation.
+  // Output is time in s.
+  float get_time();
+
+  // Advance the trajectory by a time step and evaluate it.
+  // Inputs are time step in s, array to store joint angles and optional array to store joint velocities (nullptr if not required).
+  // Array sizes must match number of links.
+  // Outputs are joint angles in rad and velocities in rad/s. Returns false once the end of the trajectory is reached
+  // (the outputs then hold the final point).
+  bool next(float dt, float qOutput[], float qdOutput[] = nullptr);
+
+  // Sample the whole trajectory on a uniform time grid.
+  // Inputs are time step in s, array to store output and maximum no. of samples.
+  // Output array size must be (maximum no. of samples x no. of links), stored sample by sample.
+  // Output is no. of samples written (the first sample is at t = 0 and the last at the end of the trajectory).
+  int sampleUniform(float dt, float qOutput[], int maxSamples);
+};
+
+} // namespace mt
+
+#endif // DH_TIME_PARAMETERIZATION_H_
@@ -0,0 +1,237 @@
+// Copyright (C) 2015 - 2020 Joseph Morgridge
+//
+// Licensed under GNU General Public License v3.0 (GPLv3) License.
+// See the LICENSE file in the project root for full license details.
+
+#include "dh_trajectory_compressor.h"
+
+#include "dh_kinematic_chain.h"
+
+#if USING_ARDUINO
+#include <Arduino.h>
+#else
+#include <cmath>
+using namespace std;
+#endif
+
+namespace mt {
+
+namespace {
+
+// Polynomial coefficients (in ticks since the segment start) of a cubic Hermite segment.
+// Inputs are start and end angles, start and end slopes (per tick), segment length in ticks and array to store output.
+void hermiteCoefficients(float q0, float m0, float q1, float m1, float h, float cOutput[4]) {
+  cOutput[0] = q0;
+  cOutput[1] = m0;
+  cOutput[2] = (3 * (q1 - q0) - (2 * m0 + m1) * h) / (h * h);
+  cOutput[3] = (2 * (q0 - q1) + (m0 + m1) * h) / (h * h * h);
+}
+
+// Evaluate a segment polynomial (Horner's method).
+inline float hermiteValue(const float c[4], float t) { return c[0] + t * (c[1] + t * (c[2] + t * c[3])); }
+
+} // namespace
+
+// Compressor
+
+DhTrajectoryCompressor::DhTrajectoryCompressor(DhKinematicChain& chainInput):
+chain(chainInput) {
+  noOfLinks = chain.get_noOfLinks();
+  for (int i = 0; i < maxLinks; i++) { jointTolerances[i] = 1e-4; }
+}
+
+void DhTrajectoryCompressor::set_jointTolerances(float tolerancesInput[]) {
+  for (int i = 0; i < noOfLinks; i++) { jointTolerances[i] = tolerancesInput[i]; }
+}
+
+void DhTrajectoryCompressor::set_cartesianTolerance(float toleranceInput) { cartesianTolerance = toleranceInput; }
+
+int DhTrajectoryCompressor::get_knotSize() { return 1 + 2 * noOfLinks; }
+
+void DhTrajectoryCompressor::slope(float qPathInput[], int noOfPoints, int index, float slopeOutput[]) {
+  int previous = (index > 0) ? index - 1 : index;
+  int next = (index < noOfPoints - 1) ? index + 1 : index;
+  for (int j = 0; j < noOfLinks; j++)
+  {
+    slopeOutput[j] = (next > previous) ?
+                     (qPathInput[next * noOfLinks + j] - qPathInput[previous * noOfLinks + j]) / (next - previous) : 0;
+  }
+}
+
+bool DhTrajectoryCompressor::segmentFits(float qPathInput[], int noOfPoints, int first, int last, float& jointDeviationOutput,
+                                         float& cartesianDeviationOutput) {
+  float slope0[maxLinks], slope1[maxLinks];
+  slope(qPathInput, noOfPoints, first, slope0);
+  slope(qPathInput, noOfPoints, last, slope1);
+
+  float c[maxLinks][4];
+  for (int j = 0; j < noOfLinks; j++)
+  {
+    hermiteCoefficients(qPathInput[first * noOfLinks + j], slope0[j], qPathInput[last * noOfLinks + j], slope1[j],
+                        (float)(last - first), c[j]);
+  }
+
+  // Joint check of every sample first (cheap), then the Cartesian check.
+  float jointDeviation = 0;
+  for (int k = first + 1; k < last; k++)
+  {
+    for (int j = 0; j < noOfLinks; j++)
+    {
+      float deviation = fabs(hermiteValue(c[j], (float)(k - first)) - qPathInput[k * noOfLinks + j]);
+      if (deviation > jointTolerances[j]) { return false; }
+      if (deviation > jointDeviation) { jointDeviation = deviation; }
+    }
+  }
+
+  float cartesianDeviation = 0;
+  if (cartesianTolerance > 0)
+  {
+    float q[maxLinks];
+    float TmOriginal[1][4][4], TmSpline[1][4][4];
+    for (int k = first + 1; k < last; k++)
+    {
+      for (int j = 0; j < noOfLinks; j++) { q[j] = hermiteValue(c[j], (float)(k - first)); }
+      chain.fKineBatch(TmOriginal, &qPathInput[k * noOfLinks], 1);
+      chain.fKineBatch(TmSpline, q, 1);
+
+      float dx = TmSpline[0][0][3] - TmOriginal[0][0][3];
+      float dy = TmSpline[0][1][3] - TmOriginal[0][1][3];
+      float dz = TmSpline[0][2][3] - TmOriginal[0][2][3];
+      float deviation = sqrt(dx * dx + dy * dy + dz * dz);
+      if (deviation > cartesianTolerance) { return false; }
+      if (deviation > cartesianDeviation) { cartesianDeviation = deviation; }
+    }
+  }
+
+  jointDeviationOutput = jointDeviation;
+  cartesianDeviationOutput = cartesianDeviation;
+  return true;
+}
+
+int DhTrajectoryCompressor::compress(float qPathInput[], int noOfPoints, float knotsOutput[], int maxKnots) {
+  maxJointDeviation = 0;
+  maxCartesianDeviation = 0;
+  if (noOfPoints < 1) { return 0; }
+
+  int knotSize = get_knotSize();
+  int noOfKnots = 0;
+  int first = 0;
+  while (true)
+  {
+    if (noOfKnots == maxKnots) { return -1; }
+
+    // Knot at the segment start.
+    float* knot = &knotsOutput[noOfKnots * knotSize];
+    knot[0] = (float)first;
+    for (int j = 0; j < noOfLinks; j++) { knot[1 + j] = qPathInput[first * noOfLinks + j]; }
+    slope(qPathInput, noOfPoints, first, &knot[1 + noOfLinks]);
+    noOfKnots++;
+    if (first == noOfPoints - 1) { break; }
+
+    // Longest segment within the tolerances: a segment to the next sample always fits (there are no samples in between),
+    // so grow the segment exponentially until it fails, then binary search between the longest fit and the failure.
+    int fit = first + 1;
+    int fail = -1;
+    float jointDeviation = 0, cartesianDeviation = 0;
+    float jointCandidate, cartesianCandidate;
+    for (int length = 2; fit < noOfPoints - 1; length *= 2)
+    {
+      int last = (first + length < noOfPoints - 1) ? first + length : noOfPoints - 1;
+      if (!segmentFits(qPathInput, noOfPoints, first, last, jointCandidate, cartesianCandidate))
+      {
+        fail = last;
+        break;
+      }
+      fit = last;
+      jointDeviation = jointCandidate;
+      cartesianDeviation = cartesianCandidate;
+    }
+
+    while (fail - fit > 1)
+    {
+      int middle = (fit + fail) / 2;
+      if (segmentFits(qPathInput, noOfPoints, first, middle, jointCandidate, cartesianCandidate))
+      {
+        fit = middle;
+        jointDeviation = jointCandidate;
+        cartesianDeviation = cartesianCandidate;
+      }
+      else
+      {
+        fail = middle;
+      }
+    }
+
+    if (jointDeviation > maxJointDeviation) { maxJointDeviation = jointDeviation; }
+    if (cartesianDeviation > maxCartesianDeviation) { maxCartesianDeviation = cartesianDeviation; }
+    first = fit;
+  }
+
+  return noOfKnots;
+}
+
+void DhTrajectoryCompressor::get_maxDeviations(float& jointDeviationOutput, float& cartesianDeviationOutput) {
+  jointDeviationOutput = maxJointDeviation;
+  cartesianDeviationOutput = maxCartesianDeviation;
+}
+
+// Evaluator
+
+DhSplineEvaluator::DhSplineEvaluator(int noOfLinksInput, const float knotsInput[], int noOfKnotsInput):
+noOfLinks(noOfLinksInput), knots(knotsInput), noOfKnots(noOfKnotsInput) {
+  reset();
+}
+
+void DhSplineEvaluator::reset() {
+  tick = -1;
+  if (noOfKnots > 0) { enterSegment(0); }
+}
+
+void DhSplineEvaluator::enterSegment(int index) {
+  int knotSize = 1 + 2 * noOfLinks;
+  const float* knot0 = &knots[index * knotSize];
+  segment = index;
+  segmentStart = (long)knot0[0];
+
+  if (index + 1 >= noOfKnots)
+  {
+    // Final point.
+    segmentEnd = segmentStart;
+    for (int j = 0; j < noOfLinks; j++)
+    {
+      coefficients[j][0] = knot0[1 + j];
+      coefficients[j][1] = coefficients[j][2] = coefficients[j][3] = 0;
+    }
+    return;
+  }
+
+  const float* knot1 = &knots[(index + 1) * knotSize];
+  segmentEnd = (long)knot1[0];
+  for (int j = 0; j < noOfLinks; j++)
+  {
+    hermiteCoefficients(knot0[1 + j], knot0[1 + noOfLinks + j], knot1[1 + j], knot1[1 + noOfLinks + j],
+                        (float)(segmentEnd - segmentStart), coefficients[j]);
+  }
+}
+
+long DhSplineEvaluator::get_noOfTicks() {
+  return (noOfKnots > 0) ? (long)knots[(noOfKnots - 1) * (1 + 2 * noOfLinks)] + 1 : 0;
+}
+
+long DhSplineEvaluator::get_tick() { return tick; }
+
+bool DhSplineEvaluator::next(float qOutput[]) {
+  if (noOfKnots == 0) { return false; }
+
+  bool running = tick + 1 < get_noOfTicks();
+  if (running) { tick++; }
+
+  // Move to the segment containing the tick (the end tick of a segment is the start of the next one).
+  while (tick >= segmentEnd && segment + 1 < noOfKnots) { enterSegment(segment + 1); }
+
+  float t = (float)(tick - segmentStart);
+  for (int j = 0; j < noOfLinks; j++) { qOutput[j] = hermiteValue(coefficients[j], t); } // (rad).
+  return running;
+}
+
+} // namespace mt
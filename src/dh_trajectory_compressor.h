@@ -0,0 +1,151 @@
+// Copyright (C) 2015 - 2020 Joseph Morgridge
+//
+// Licensed under GNU General Public License v3.0 (GPLv3) License.
+// See the LICENSE file in the project root for full license details.
+
+#ifndef DH_TRAJECTORY_COMPRESSOR_H_
+#define DH_TRAJECTORY_COMPRESSOR_H_
+
+#include "dh_kinematic_chain.h"
+
+#if __has_include(<Arduino.h>)
+#include <Arduino.h>
+#define USING_ARDUINO 1
+#else
+#define USING_ARDUINO 0
+#endif
+
+namespace mt {
+
+// Compressed joint trajectory format (piecewise cubic Hermite spline).
+// A densely sampled joint trajectory (one sample per controller tick) is replaced by knots at a subset of the samples.
+// Each knot is stored as (1 + 2 x no. of links) floats:
+//   tick (sample index; exact up to 2^24), joint angles (rad) x no. of links, joint slopes (rad per tick) x no. of links
+// Between two knots, each joint follows the cubic Hermite polynomial through the knot angles with the knot slopes, so
+// the trajectory is C1 continuous. The first and last knots are at the first and last samples.
+
+// Class to encapsulate adaptive compression of a joint trajectory into a cubic Hermite spline (e.g. for upload to a
+// controller with little RAM or a slow link).
+// Knots are placed greedily: each segment is extended (exponential then binary search) as far as the spline stays
+// within the per-joint tolerances at every sample, and the tool-tip stays within the Cartesian tolerance (verified
+// through the forward kinematics of the original and reconstructed joint angles). The knot slopes are the central
+// differences of the samples. Smooth trajectories (e.g. IK over Cartesian paths) typically need one knot per tens of
+// samples. There is no dynamic memory allocation.
+class DhTrajectoryCompressor {
+
+ public:
+
+  // General Constants
+  static const int maxLinks = DhKinematicChain::maxLinks;
+
+ private:
+
+  // General Parameters
+  DhKinematicChain& chain;
+  int noOfLinks = 0;
+  float jointTolerances[maxLinks]; // (rad).
+  float cartesianTolerance = 0;    // Tool-tip position tolerance (length units); 0 to skip the Cartesian check.
+
+  // Results
+  float maxJointDeviation = 0;
+  float maxCartesianDeviation = 0;
+
+  // Slope of the trajectory at a sample (rad per tick).
+  void slope(float qPathInput[], int noOfPoints, int index, float slopeOutput[]);
+
+  // Check whether a single segment between two samples is within the tolerances.
+  // Outputs are the max. joint and Cartesian deviations over the segment (if within the tolerances).
+  bool segmentFits(float qPathInput[], int noOfPoints, int first, int last, float& jointDeviationOutput,
+                   float& cartesianDeviationOutput);
+
+ public:
+
+  // Constructors
+
+  // Input is the robots kinematic model (for the Cartesian check; its base and tool are used).
+  DhTrajectoryCompressor(DhKinematicChain& chainInput);
+
+  // Configuration Methods
+
+  // Set joint tolerances.
+  // Input is array of max. joint angle deviations in rad.
+  // Array size must match number of links.
+  void set_jointTolerances(float tolerancesInput[]);
+
+  // Set Cartesian tolerance.
+  // Input is max. tool-tip position deviation in length units (e.g. mm), or 0 to skip the Cartesian check.
+  void set_cartesianTolerance(float toleranceInput);
+
+  // Compression Methods
+
+  // Get the size of a knot.
+  // Output is no. of floats per knot.
+  int get_knotSize();
+
+  // Compress a joint trajectory.
+  // Inputs are joint trajectory (noOfPoints x no. of links, row-major, rad; one sample per tick), no. of points, array
+  // to store output (maxKnots x get_knotSize() floats) and max. no. of knots.
+  // Output is no. of knots, or -1 if more than the max. no. of knots are required.
+  int compress(float qPathInput[], int noOfPoints, float knotsOutput[], int maxKnots);
+
+  // Get the max. deviations of the last compression.
+  // Inputs are variables to store output.
+  // Outputs are max. joint angle deviation in rad and max. tool-tip position deviation (0 if not checked).
+  void get_maxDeviations(float& jointDeviationOutput, float& cartesianDeviationOutput);
+};
+
+// Class to encapsulate streaming evaluation of a compressed joint trajectory, e.g. on the controller.
+// The polynomial coefficients of a segment are computed once on entry; each tick then costs 3 multiply-adds per joint
+// (Horner's method). The knots are NOT copied.
+class DhSplineEvaluator {
+
+ public:
+
+  // General Constants
+  static const int maxLinks = DhKinematicChain::maxLinks;
+
+ private:
+
+  // General Parameters
+  int noOfLinks = 0;
+  const float* knots = nullptr;
+  int noOfKnots = 0;
+
+  // Evaluation State
+  int segment = 0;  // Current segment [segment, segment + 1].
+  long tick = -1;   // Tick of the last evaluation.
+  long segmentStart = 0;
+  long segmentEnd = 0;
+  float coefficients[maxLinks][4]; // Polynomial of the current segment in ticks since the segment start.
+
+  // Compute the polynomial coefficients of a segment.
+  void enterSegment(int index);
+
+ public:
+
+  // Constructors
+
+  // Inputs are no. of links, knots (DhTrajectoryCompressor::compress(...) output) and no. of knots.
+  DhSplineEvaluator(int noOfLinksInput, const float knotsInput[], int noOfKnotsInput);
+
+  // Methods
+
+  // Restart evaluation from the first tick.
+  void reset();
+
+  // Get the no. of ticks of the trajectory.
+  long get_noOfTicks();
+
+  // Get the tick of the last evaluation.
+  long get_tick();
+
+  // Advance the trajectory by one tick and evaluate it.
+  // Input is array to store output.
+  // Array size must match number of links.
+  // Output is joint angles in rad. Returns false once past the last tick (the output then holds the final point).
+  bool next(float qOutput[]);
+};
+
+} // namespace mt
+
+#endif // DH_TRAJECTORY_COMPRESSOR_H_
@@ -0,0 +1,289 @@
+// Copyright (C) 2015 - 2020 Joseph Morgridge
+//
+// Licensed under GNU General Public License v3.0 (GPLv3) License.
+// See the LICENSE file in the project root for full license details.
+
+#include "dh_trajectory_recorder.h"
+
+#include "dh_kinematic_chain.h"
+#include "dh_memory_barrier.h"
+
+#if USING_ARDUINO
+#include <Arduino.h>
+#else
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+using namespace std;
+#endif
+
+namespace mt {
+
+namespace {
+
+// Write an unsigned LEB128 varint (7 bits per byte, least significant first).
+// Output is no. of bytes written (max. 5).
+int writeVarint(uint8_t* output, uint32_t value) {
+  int n = 0;
+  while (value >= 0x80)
+  {
+    output[n++] = (uint8_t)(value | 0x80);
+    value >>= 7;
+  }
+  output[n++] = (uint8_t)value;
+  return n;
+}
+
+// Read an unsigned LEB128 varint. Output is false if the varint is truncated or too long.
+bool readVarint(const uint8_t*& input, const uint8_t* end, uint32_t& valueOutput) {
+  uint32_t value = 0;
+  for (int shift = 0; shift < 35; shift += 7)
+  {
+    if (input >= end) { return false; }
+    uint8_t byte = *input++;
+    value |= (uint32_t)(byte & 0x7F) << shift;
+    if (!(byte & 0x80))
+    {
+      valueOutput = value;
+      return true;
+    }
+  }
+  return false;
+}
+
+// Zigzag mapping of signed to unsigned values, so that small negative deltas have short varints.
+inline uint32_t zigzagEncode(int32_t value) { return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31); }
+
+inline int32_t zigzagDecode(uint32_t value) { return (int32_t)(value >> 1) ^ -(int32_t)(value & 1); }
+
+} // namespace
+
+// Recorder
+
+DhTrajectoryRecorder::DhTrajectoryRecorder(int noOfLinksInput, float resolutionInput, DhTrajectoryWriteCallback writeInput,
+                                           void* contextInput):
+noOfLinks(noOfLinksInput), resolution(resolutionInput), write(writeInput), context(contextInput) {}
+
+bool DhTrajectoryRecorder::record(float qInput[], uint32_t timestamp) {
+  int head = ringHead;
+  int headNext = (head + 1) % ringSize;
+  if (headNext == ringTail)
+  {
+    noOfDropped = noOfDropped + 1; // Single writer (the hot side).
+    return false;
+  }
+
+  // The barriers keep the plain sample accesses between the index accesses (ISRs, multi-core boards).
+  dhMemoryBarrier(); // Write the slot after its release is seen.
+  ring[head].timestamp = timestamp;
+  for (int i = 0; i < noOfLinks; i++) { ring[head].q[i] = qInput[i]; } // (rad).
+  dhMemoryBarrier();
+  ringHead = headNext; // Publish after the sample is written.
+  return true;
+}
+
+bool DhTrajectoryRecorder::record(DhKinematicChain& chain, uint32_t timestamp) {
+  float q[maxLinks];
+  chain.get_qCurrent(q);
+  return record(q, timestamp);
+}
+
+void DhTrajectoryRecorder::encode(const DhTrajectorySample& sample) {
+  if (payloadSize + maxRecordSize > chunkSize) { writeChunk(); }
+
+  uint8_t* output = chunk + sizeof(DhTrajectoryChunkHeader) + payloadSize;
+  int n = 0;
+  if (noOfChunkRecords == 0)
+  {
+    // The first record of a chunk is w.r.t. the chunk timestamp and zero counts.
+    previousTimestamp = sample.timestamp;
+    for (int i = 0; i < noOfLinks; i++) { previousCounts[i] = 0; }
+    DhTrajectoryChunkHeader header = {kDhTrajectoryChunkMagic, 0, 0, sample.timestamp};
+    memcpy(chunk, &header, sizeof(header));
+  }
+
+  n += writeVarint(output + n, sample.timestamp - previousTimestamp); // Wraps around.
+  previousTimestamp = sample.timestamp;
+  for (int i = 0; i < noOfLinks; i++)
+  {
+    int32_t counts = (int32_t)floor(sample.q[i] / resolution + 0.5);
+    n += writeVarint(output + n, zigzagEncode(counts - previousCounts[i]));
+    previousCounts[i] = counts;
+  }
+
+  payloadSize += n;
+  noOfChunkRecords++;
+}
+
+void DhTrajectoryRecorder::service() {
+  if (!headerWritten)
+  {
+    DhTrajectoryHeader header = {kDhTrajectoryMagic, kDhTrajectoryVersion, (uint32_t)noOfLinks, resolution, {0, 0, 0, 0}};
+    write((const uint8_t*)&header, sizeof(header), context);
+    headerWritten = true;
+  }
+
+  int tail = ringTail;
+  while (tail != ringHead)
+  {
+    dhMemoryBarrier(); // Read the sample after its publication is seen.
+    encode(ring[tail]);
+    dhMemoryBarrier();
+    tail = (tail + 1) % ringSize;
+    ringTail = tail; // Release the slot after the sample is read.
+  }
+}
+
+void DhTrajectoryRecorder::writeChunk() {
+  if (noOfChunkRecords == 0) { return; }
+
+  DhTrajectoryChunkHeader header;
+  memcpy(&header, chunk, sizeof(header));
+  header.noOfRecords = noOfChunkRecords;
+  header.payloadSize = payloadSize;
+  memcpy(chunk, &header, sizeof(header));
+
+  int size = sizeof(DhTrajectoryChunkHeader) + payloadSize;
+  while (size % 4 != 0) { chunk[size++] = 0; } // Keep the next chunk header aligned.
+  write(chunk, size, context);
+
+  payloadSize = 0;
+  noOfChunkRecords = 0;
+}
+
+void DhTrajectoryRecorder::flush() {
+  service(); // Writes the header (if not written yet) and encodes the samples in the ring buffer.
+  writeChunk();
+}
+
+uint32_t DhTrajectoryRecorder::get_noOfDropped() {
+#if USING_ARDUINO
+  // The counter is written by the hot side (e.g. an ISR) and is not read atomically on 8-bit boards; read it until two
+  // reads agree.
+  uint32_t dropped;
+  do { dropped = noOfDropped; } while (dropped != noOfDropped);
+  return dropped;
+#else
+  return noOfDropped;
+#endif
+}
+
+// Reader
+
+bool DhTrajectoryReader::attach(const void* buffer, size_t size) {
+  header = nullptr;
+  data = (const uint8_t*)buffer;
+  dataSize = size;
+  if (buffer == nullptr || size < sizeof(DhTrajectoryHeader)) { return false; }
+
+  const DhTrajectoryHeader* candidate = (const DhTrajectoryHeader*)buffer;
+  if (candidate->magic != kDhTrajectoryMagic || candidate->version != kDhTrajectoryVersion) { return false; }
+  if (candidate->noOfLinks < 1 || candidate->noOfLinks > (uint32_t)maxLinks || !(candidate->resolution > 0)) { return false; }
+
+  header = candidate;
+  rewind();
+  return true;
+}
+
+int DhTrajectoryReader::get_noOfLinks() { return (header != nullptr) ? (int)header->noOfLinks : 0; }
+
+float DhTrajectoryReader::get_resolution() { return (header != nullptr) ? header->resolution : 0; }
+
+void DhTrajectoryReader::rewind() {
+  payload = payloadEnd = nullptr;
+  recordIndex = 0;
+  if (header != nullptr) { enterChunk(sizeof(DhTrajectoryHeader)); }
+}
+
+bool DhTrajectoryReader::enterChunk(size_t offset) {
+  chunkOffset = offset;
+  recordIndex = 0;
+  payload = payloadEnd = nullptr;
+  if (offset + sizeof(DhTrajectoryChunkHeader) > dataSize) { return false; }
+
+  const DhTrajectoryChunkHeader* chunk = (const DhTrajectoryChunkHeader*)(data + offset);
+  if (chunk->magic != kDhTrajectoryChunkMagic) { return false; }
+  if (chunk->payloadSize > dataSize - offset - sizeof(DhTrajectoryChunkHeader)) { return false; } // Cut short.
+
+  payload = data + offset + sizeof(DhTrajectoryChunkHeader);
+  payloadEnd = payload + chunk->payloadSize;
+  previousTimestamp = chunk->firstTimestamp;
+  for (int i = 0; i < maxLinks; i++) { previousCounts[i] = 0; }
+  return true;
+}
+
+bool DhTrajectoryReader::next(float qOutput[], uint32_t& timestampOutput) {
+  if (header == nullptr || payload == nullptr) { return false; }
+
+  const DhTrajectoryChunkHeader* chunk = (const DhTrajectoryChunkHeader*)(data + chunkOffset);
+  if (recordIndex == chunk->noOfRecords)
+  {
+    size_t size = sizeof(DhTrajectoryChunkHeader) + chunk->payloadSize;
+    size = (size + 3) & ~(size_t)3; // Padding.
+    if (!enterChunk(chunkOffset + size)) { return false; }
+    return next(qOutput, timestampOutput);
+  }
+
+  // Decode into temporaries so that a damaged record leaves the outputs unchanged.
+  uint32_t delta;
+  if (!readVarint(payload, payloadEnd, delta)) { payload = nullptr; return false; }
+  uint32_t timestamp = previousTimestamp + delta;
+  int32_t counts[maxLinks];
+  int noOfLinks = header->noOfLinks;
+  for (int i = 0; i < noOfLinks; i++)
+  {
+    if (!readVarint(payload, payloadEnd, delta)) { payload = nullptr; return false; }
+    counts[i] = previousCounts[i] + zigzagDecode(delta);
+  }
+
+  previousTimestamp = timestamp;
+  timestampOutput = timestamp;
+  for (int i = 0; i < noOfLinks; i++)
+  {
+    previousCounts[i] = counts[i];
+    qOutput[i] = counts[i] * header->resolution; // (rad).
+  }
+  recordIndex++;
+  return true;
+}
+
+bool DhTrajectoryReader::next(DhKinematicChain& chain, uint32_t& timestampOutput) {
+  float q[maxLinks];
+  if (!next(q, timestampOutput)) { return false; }
+  return chain.set_qCurrent(q);
+}
+
+int DhTrajectoryReader::nextBatch(float qPathOutput[], uint32_t timestampsOutput[], int maxPoints) {
+  int noOfLinks = get_noOfLinks();
+  int n = 0;
+  while (n < maxPoints && next(&qPathOutput[n * noOfLinks], timestampsOutput[n])) { n++; }
+  return n;
+}
+
+#if !USING_ARDUINO
+
+bool DhTrajectoryFile::open(const char* path) {
+  close();
+  if (!file.open(path)) { return false; }
+  if (!reader.attach(file.get_data(), file.get_size()))
+  {
+    close();
+    return false;
+  }
+  return true;
+}
+
+void DhTrajectoryFile::close() {
+  file.close();
+  reader = DhTrajectoryReader();
+}
+
+DhTrajectoryReader& DhTrajectoryFile::get_reader() { return reader; }
+
+void writeTrajectoryToFile(const uint8_t* data, int size, void* context) {
+  fwrite(data, 1, (size_t)size, (FILE*)context);
+}
+
+#endif
+
+} // namespace mt
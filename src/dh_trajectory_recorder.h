@@ -0,0 +1,249 @@
+// Copyright (C) 2015 - 2020 Joseph Morgridge
+//
+// Licensed under GNU General Public License v3.0 (GPLv3) License.
+// See the LICENSE file in the project root for full license details.
+
+#ifndef DH_TRAJECTORY_RECORDER_H_
+#define DH_TRAJECTORY_RECORDER_H_
+
+#include "dh_kinematic_chain.h"
+#include "dh_mapped_file.h"
+
+#if __has_include(<Arduino.h>)
+#include <Arduino.h>
+#define USING_ARDUINO 1
+#else
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#define USING_ARDUINO 0
+#endif
+
+// Buffer sizes of the trajectory recorder. They can be changed for the whole library by defining them in the build flags
+// e.g. -DDH_TRAJECTORY_RING_SIZE=64.
+#ifndef DH_TRAJECTORY_RING_SIZE
+#define DH_TRAJECTORY_RING_SIZE 16 // Samples between the hot (recording) side and the encoder (max. 255).
+#endif
+#ifndef DH_TRAJECTORY_CHUNK_SIZE
+#define DH_TRAJECTORY_CHUNK_SIZE 256 // Max. encoded record bytes per chunk.
+#endif
+
+namespace mt {
+
+// Binary trajectory format (version 1).
+// A stream of joint angle samples, e.g. recorded every control cycle. Only the joint angles are stored; the poses
+// (TmCurrent) are reconstructed on replay through the forward kinematics. All header fields are 4-byte little-endian
+// values (uint32_t or float):
+//   DhTrajectoryHeader
+//   Chunk x N: DhTrajectoryChunkHeader, encoded records (payloadSize bytes), zero padding to a multiple of 4 bytes
+// Joint angles are quantized to integer counts of the resolution. Each record is the timestamp delta (unsigned LEB128
+// varint) followed by the joint count deltas (zigzag LEB128 varints) w.r.t. the previous record of the chunk; the first
+// record of a chunk is w.r.t. the chunk timestamp and zero counts, so every chunk decodes on its own. The quantization
+// error is at most half the resolution, and deltas of the counts are exact, so there is no drift over long recordings.
+// A file that was cut short (e.g. power loss) is readable up to its last complete chunk.
+constexpr uint32_t kDhTrajectoryMagic = 0x52544844;      // "DHTR".
+constexpr uint32_t kDhTrajectoryChunkMagic = 0x43544844; // "DHTC".
+constexpr uint32_t kDhTrajectoryVersion = 1;
+
+struct DhTrajectoryHeader {
+  uint32_t magic;      // kDhTrajectoryMagic.
+  uint32_t version;    // kDhTrajectoryVersion.
+  uint32_t noOfLinks;
+  float resolution;    // Joint angle quantization step (rad).
+  uint32_t reserved[4];
+};
+
+struct DhTrajectoryChunkHeader {
+  uint32_t magic;          // kDhTrajectoryChunkMagic.
+  uint32_t noOfRecords;
+  uint32_t payloadSize;    // Encoded record bytes (excluding padding).
+  uint32_t firstTimestamp; // Timestamp of the first record.
+};
+
+// Output callback of the recorder, e.g. writing to a file, an SD card or a serial port.
+// Inputs are bytes, no. of bytes and the user context given to the recorder.
+typedef void (*DhTrajectoryWriteCallback)(const uint8_t* data, int size, void* context);
+
+// Joint angle sample in the recorder ring buffer.
+struct DhTrajectorySample {
+  uint32_t timestamp;
+  float q[DhKinematicChain::maxLinks];
+};
+
+// Class to encapsulate a binary trajectory recorder.
+// The hot side (record(...), e.g. at the end of a control ISR) only copies the joint angles into a fixed size lock-free
+// ring buffer. The encoder side (service(), e.g. from loop() or a logging thread) quantizes and delta encodes the
+// samples into chunks and passes each complete chunk (and the file header first) to the write callback.
+// record(...) and service() may be called from different contexts (single producer, single consumer).
+// There is no dynamic memory allocation.
+class DhTrajectoryRecorder {
+
+ public:
+
+  // General Constants
+  static const int maxLinks = DhKinematicChain::maxLinks;
+  static const int ringSize = DH_TRAJECTORY_RING_SIZE;
+  static const int chunkSize = DH_TRAJECTORY_CHUNK_SIZE;
+  static const int maxRecordSize = 5 * (1 + maxLinks); // Worst case varint encoding of a record (bytes).
+  static_assert(chunkSize >= maxRecordSize, "DH_TRAJECTORY_CHUNK_SIZE must hold at least one record");
+
+ private:
+
+  // General Parameters
+  int noOfLinks;
+  float resolution;
+  DhTrajectoryWriteCallback write;
+  void* context;
+
+  // Ring Buffer
+  DhTrajectorySample ring[ringSize];
+#if USING_ARDUINO
+  volatile uint8_t ringHead = 0, ringTail = 0; // Single byte indexes are atomic on AVR (ordered by dhMemoryBarrier()).
+  volatile uint32_t noOfDropped = 0; // Samples dropped because the ring buffer was full.
+#else
+  std::atomic<int> ringHead{0}, ringTail{0};
+  std::atomic<uint32_t> noOfDropped{0};
+#endif
+
+  // Encoder
+  bool headerWritten = false;
+  uint8_t chunk[sizeof(DhTrajectoryChunkHeader) + chunkSize + 3]; // Header, payload and padding.
+  int payloadSize = 0;
+  uint32_t noOfChunkRecords = 0;
+  uint32_t previousTimestamp = 0;
+  int32_t previousCounts[maxLinks];
+
+  // Append a sample to the current chunk.
+  void encode(const DhTrajectorySample& sample);
+
+  // Write the current chunk (if it holds any records) and start a new one.
+  void writeChunk();
+
+ public:
+
+  // Constructors
+
+  // Inputs are no. of links, joint angle resolution in rad (e.g. 1e-5), write callback and user context for the
+  // callback (e.g. a FILE*, or nullptr).
+  DhTrajectoryRecorder(int noOfLinksInput, float resolutionInput, DhTrajectoryWriteCallback writeInput, void* contextInput);
+
+  // Recording Methods (hot side)
+
+  // Record a joint angle sample.
+  // Inputs are array of joint angles in rad and timestamp (any unit, e.g. micros(); wraps around).
+  // Array size must match number of links.
+  // Output is true on success, false if the ring buffer is full (the sample is dropped and counted).
+  bool record(float qInput[], uint32_t timestamp);
+
+  // Record the current joint angles of a chain.
+  // Inputs are the robots kinematic model and timestamp.
+  // Output is true on success, false if the ring buffer is full (the sample is dropped and counted).
+  bool record(DhKinematicChain& chain, uint32_t timestamp);
+
+  // Encoder Methods
+
+  // Encode the recorded samples, writing every complete chunk. Call continuously (e.g. from loop()).
+  void service();
+
+  // Encode the recorded samples and write the current chunk even if it is not full (e.g. before closing the file).
+  void flush();
+
+  // Get no. of samples dropped because the ring buffer was full.
+  uint32_t get_noOfDropped();
+};
+
+// Class to encapsulate streaming, zero copy replay of a binary trajectory held in memory (e.g. a memory mapped file).
+// Records are decoded one at a time, so the whole trajectory is never expanded in memory.
+// NOTE: On AVR based Arduino boards the trajectory must be in RAM (not PROGMEM).
+class DhTrajectoryReader {
+
+ public:
+
+  // General Constants
+  static const int maxLinks = DhKinematicChain::maxLinks;
+
+ private:
+
+  const uint8_t* data = nullptr;
+  size_t dataSize = 0;
+  const DhTrajectoryHeader* header = nullptr;
+
+  // Cursor
+  size_t chunkOffset = 0; // Offset of the current chunk header.
+  uint32_t recordIndex = 0; // Next record in the current chunk.
+  const uint8_t* payload = nullptr; // Next byte of the current chunk payload.
+  const uint8_t* payloadEnd = nullptr;
+  uint32_t previousTimestamp = 0;
+  int32_t previousCounts[maxLinks];
+
+  // Move to the chunk at the specified offset. Output is true if it is a complete chunk.
+  bool enterChunk(size_t offset);
+
+ public:
+
+  // Methods
+
+  // Attach to (and validate the header of) a binary trajectory in memory. The memory is NOT copied and must outlive
+  // the reader. The reader is rewound.
+  // Inputs are pointer to the trajectory (4-byte aligned) and available size in bytes.
+  // Output is true if the header is valid.
+  bool attach(const void* buffer, size_t size);
+
+  // Get no. of links.
+  int get_noOfLinks();
+
+  // Get joint angle resolution.
+  // Output is resolution in rad.
+  float get_resolution();
+
+  // Restart reading from the first record.
+  void rewind();
+
+  // Read the next record.
+  // Inputs are array and variable to store output.
+  // Array size must match number of links.
+  // Outputs are joint angles in rad and timestamp. Returns false at the end of the trajectory (or at a damaged chunk).
+  bool next(float qOutput[], uint32_t& timestampOutput);
+
+  // Read the next record into a chain, i.e. set the current joint angles (this updates the transformation matrix).
+  // Inputs are the robots kinematic model and variable to store output.
+  // Output is timestamp. Returns false at the end of the trajectory, or if the joint angles are outside the chain
+  // joint position limits.
+  bool next(DhKinematicChain& chain, uint32_t& timestampOutput);
+
+  // Read up to the specified no. of records, e.g. to feed a batch pipeline (DhKinematicTree::fKineBatch(...),
+  // DhKinematicChain::singularityMetricsBatch(...)) in fixed size blocks.
+  // Inputs are arrays to store output (maxPoints x no. of links, row-major; and maxPoints) and max. no. of records.
+  // Outputs are joint angles in rad and timestamps. Returns no. of records read (0 at the end of the trajectory).
+  int nextBatch(float qPathOutput[], uint32_t timestampsOutput[], int maxPoints);
+};
+
+#if !USING_ARDUINO
+// Class to encapsulate a memory mapped binary trajectory file (desktop platforms).
+class DhTrajectoryFile {
+
+  DhMappedFile file;
+  DhTrajectoryReader reader;
+
+ public:
+
+  // Memory map a binary trajectory file and attach a reader.
+  // Input is file path.
+  // Output is true on success.
+  bool open(const char* path);
+
+  // Unmap the file.
+  void close();
+
+  // Get the reader. Only valid while the file is open.
+  DhTrajectoryReader& get_reader();
+};
+
+// Write callback for DhTrajectoryRecorder that writes to a stdio file.
+// Inputs are bytes, no. of bytes and the FILE* (opened in binary mode) as the context.
+void writeTrajectoryToFile(const uint8_t* data, int size, void* context);
+#endif
+
+} // namespace mt
+
+#endif // DH_TRAJECTORY_RECORDER_H_
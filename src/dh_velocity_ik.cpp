@@ -0,0 +1,129 @@
+// Copyright (C) 2015 - 2020 Joseph Morgridge
+//
+// Licensed under GNU General Public License v3.0 (GPLv3) License.
+// See the LICENSE file in the project root for full license details.
+
+#include "dh_velocity_ik.h"
+
+#include "dh_kinematic_chain.h"
+#include "dh_mat.h"
+
+#if USING_ARDUINO
+#include <Arduino.h>
+#else
+#include <cmath>
+using namespace std;
+#endif
+
+namespace mt {
+
+DhVelocityIkSolver::DhVelocityIkSolver(DhKinematicChain& chainInput):
+chain(chainInput) {
+  noOfLinks = chain.get_noOfLinks();
+}
+
+void DhVelocityIkSolver::set_dampingParameters(float lambdaMaxInput, float manipulabilityThresholdInput) {
+  lambdaMax = lambdaMaxInput;
+  manipulabilityThreshold = manipulabilityThresholdInput;
+}
+
+void DhVelocityIkSolver::set_taskMask(bool taskMaskInput[6]) {
+  for (int r = 0; r < maxTaskRows; r++)
+  {
+    taskMask[r] = taskMaskInput[r];
+  }
+}
+
+float DhVelocityIkSolver::get_manipulability() { return manipulability; }
+
+float DhVelocityIkSolver::get_damping() { return damping; }
+
+int DhVelocityIkSolver::solve(float qdOutput[], float twistInput[6], float qInput[], float qdNullInput[]) {
+  float J[6][maxLinks];
+  chain.jacobian(J, qInput);
+  return solveWithJacobian(qdOutput, twistInput, J, qdNullInput);
+}
+
+int DhVelocityIkSolver::solveWithJacobian(float qdOutput[], float twistInput[6], float JInput[6][maxLinks], float qdNullInput[]) {
+  // Task error after the null space motion: v - J qdNull. Untracked rows are zeroed.
+  float error[maxTaskRows];
+  for (int r = 0; r < maxTaskRows; r++)
+  {
+    error[r] = 0;
+    if (!taskMask[r]) { continue; }
+    error[r] = twistInput[r];
+    if (qdNullInput != nullptr)
+    {
+      for (int i = 0; i < noOfLinks; i++) { error[r] -= JInput[r][i] * qdNullInput[i]; }
+    }
+  }
+
+  // A = J J^T (6 x 6, symmetric). Untracked rows/columns are replaced by the identity, which decouples them
+  // (their solution is 0) while keeping the system size fixed at compile time.
+  float A[maxTaskRows][maxTaskRows];
+  for (int r = 0; r < maxTaskRows; r++)
+  {
+    for (int c = 0; c <= r; c++)
+    {
+      float value = 0;
+      if (taskMask[r] && taskMask[c])
+      {
+        for (int i = 0; i < noOfLinks; i++) { value += JInput[r][i] * JInput[c][i]; }
+      }
+      else if (r == c)
+      {
+        value = 1;
+      }
+      A[r][c] = value;
+      A[c][r] = value;
+    }
+  }
+
+  // Manipulability from the Cholesky factor of the undamped matrix (product of the diagonal = sqrt(det)).
+  float L[maxTaskRows][maxTaskRows];
+  matCopy(A, L);
+  manipulability = 0;
+  if (choleskyDecompose(L))
+  {
+    manipulability = 1;
+    for (int r = 0; r < maxTaskRows; r++) { manipulability *= L[r][r]; }
+  }
+
+  // Variable damping; zero away from singularities so the solution is exact there.
+  damping = 0;
+  if (manipulability < manipulabilityThreshold)
+  {
+    float ratio = manipulability / manipulabilityThreshold;
+    damping = lambdaMax * sqrt(1 - ratio * ratio);
+  }
+
+  if (damping > 0)
+  {
+    matCopy(A, L);
+    for (int r = 0; r < maxTaskRows; r++)
+    {
+      if (taskMask[r]) { L[r][r] += damping * damping; }
+    }
+    if (!choleskyDecompose(L)) { return 0; }
+  }
+  else if (manipulability == 0)
+  {
+    return 0; // Singular and no damping configured.
+  }
+
+  // qd = J^T (J J^T + lambda^2 I)^-1 (v - J qdNull) + qdNull.
+  choleskySolve(L, error);
+  for (int i = 0; i < noOfLinks; i++)
+  {
+    float value = (qdNullInput != nullptr) ? qdNullInput[i] : 0;
+    for (int r = 0; r < maxTaskRows; r++)
+    {
+      if (taskMask[r]) { value += JInput[r][i] * error[r]; }
+    }
+    qdOutput[i] = value; // (rad/s).
+  }
+
+  return 1;
+}
+
+} // namespace mt
@@ -0,0 +1,89 @@
+// Copyright (C) 2015 - 2020 Joseph Morgridge
+//
+// Licensed under GNU General Public License v3.0 (GPLv3) License.
+// See the LICENSE file in the project root for full license details.
+
+#ifndef DH_VELOCITY_IK_H_
+#define DH_VELOCITY_IK_H_
+
+#include "dh_kinematic_chain.h"
+
+#if __has_include(<Arduino.h>)
+#include <Arduino.h>
+#define USING_ARDUINO 1
+#else
+#define USING_ARDUINO 0
+#endif
+
+namespace mt {
+
+// Class to encapsulate resolved-rate (velocity) inverse kinematics for a DhKinematicChain.
+// Joint velocities are obtained from a commanded end-effector (or tool-tip) twist using the damped least squares
+// (singularity robust) pseudo-inverse of the Jacobian: qd = J^T (J J^T + lambda^2 I)^-1 (v - J qdNull) + qdNull.
+// The damping is only applied near singularities i.e. when the manipulability falls below a threshold.
+// For redundant chains (e.g. 7 links), a secondary joint velocity (qdNull) is projected into the null space.
+// All storage is fixed size (compile time dimensions), hence there is no dynamic memory allocation.
+// Reference:
+// Nakamura, Y. and Hanafusa, H. (1986) Inverse Kinematic Solutions With Singularity Robustness for Robot Manipulator Control.
+// Journal of Dynamic Systems, Measurement, and Control, 108(3), pp. 163-171.
+class DhVelocityIkSolver {
+
+ public:
+
+  // General Constants
+  static const int maxLinks = DhKinematicChain::maxLinks;
+  static const int maxTaskRows = 6;
+
+ private:
+
+  // General Parameters
+  DhKinematicChain& chain;
+  int noOfLinks = 0;
+
+  // Solver Parameters
+  bool taskMask[maxTaskRows] = {true, true, true, true, true, true}; // Twist components used (vx, vy, vz, wx, wy, wz).
+  float lambdaMax = 0.05; // Maximum damping factor.
+  float manipulabilityThreshold = 0.01; // Manipulability below which damping is applied.
+  float manipulability = 0; // Manipulability of the last solve.
+  float damping = 0; // Damping factor of the last solve.
+
+ public:
+
+  // Constructors
+
+  DhVelocityIkSolver(DhKinematicChain& chainInput);
+
+  // Configuration Methods
+
+  // Set damping parameters.
+  // Inputs are maximum damping factor and manipulability threshold below which damping is applied.
+  void set_dampingParameters(float lambdaMaxInput, float manipulabilityThresholdInput);
+
+  // Set the twist components to be tracked (e.g. only vx, vy and wz for a planar robot).
+  // Input is array of 6 flags (vx, vy, vz, wx, wy, wz).
+  void set_taskMask(bool taskMaskInput[6]);
+
+  // Solver Methods
+
+  // Solve joint velocities for a commanded twist.
+  // Inputs are array to store output, twist (vx, vy, vz, wx, wy, wz) w.r.t. the world frame,
+  // array of joint angles in rad and optional secondary joint velocities in rad/s to project into the null space
+  // (nullptr if not required).
+  // Array sizes (except the twist) must match number of links.
+  // Output is joint velocities in rad/s. Returns 1 on success, 0 on failure.
+  int solve(float qdOutput[], float twistInput[6], float qInput[], float qdNullInput[] = nullptr);
+
+  // Solve joint velocities for a commanded twist given the Jacobian (e.g. from DhKinematicChain::jacobian(...)).
+  // Inputs and output as solve(...), with the Jacobian in place of the joint angles.
+  int solveWithJacobian(float qdOutput[], float twistInput[6], float JInput[6][maxLinks], float qdNullInput[] = nullptr);
+
+  // Get manipulability (sqrt(det(J J^T)) of the tracked rows) of the last solve.
+  float get_manipulability();
+
+  // Get damping factor of the last solve.
+  float get_damping();
+};
+
+} // namespace mt
+
+#endif // DH_VELOCITY_IK_H_